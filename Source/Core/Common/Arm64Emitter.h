@@ -1138,7 +1138,7 @@ private:
 class ARM64CodeBlock : public CodeBlock<ARM64XEmitter>
 {
 private:
-  void PoisonMemory() override
+  void PoisonMemory(u8* start, size_t size) override
   {
     // If our memory isn't a multiple of u32 then this won't write the last remaining bytes with
     // anything
@@ -1146,9 +1146,9 @@ private:
     // AArch64: 0xD4200000 = BRK 0
     constexpr u32 brk_0 = 0xD4200000;
 
-    for (size_t i = 0; i < region_size; i += sizeof(u32))
+    for (size_t i = 0; i < size; i += sizeof(u32))
     {
-      std::memcpy(region + i, &brk_0, sizeof(u32));
+      std::memcpy(start + i, &brk_0, sizeof(u32));
     }
   }
 };
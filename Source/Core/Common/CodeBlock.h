@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <vector>
 
@@ -23,7 +24,7 @@ private:
   // A privately used function to set the executable RAM space to something invalid.
   // For debugging usefulness it should be used to set the RAM to a host specific breakpoint
   // instruction
-  virtual void PoisonMemory() = 0;
+  virtual void PoisonMemory(u8* start, size_t size) = 0;
 
 protected:
   u8* region = nullptr;
@@ -35,6 +36,12 @@ protected:
   bool m_is_child = false;
   std::vector<CodeBlock*> m_children;
 
+  // See SetNumRegions.
+  size_t m_num_regions = 1;
+  size_t m_current_region = 0;
+  // Write pointers of the regions, except for the current one, which uses the emitter's.
+  std::vector<u8*> m_region_ptrs;
+
 public:
   CodeBlock() = default;
   virtual ~CodeBlock()
@@ -53,14 +60,14 @@ public:
     region_size = size;
     total_region_size = size;
     region = static_cast<u8*>(Common::AllocateExecutableMemory(total_region_size));
-    T::SetCodePtr(region);
+    ResetCodePtr();
   }
 
   // Always clear code space with breakpoints, so that if someone accidentally executes
   // uninitialized, it just breaks into the debugger.
   void ClearCodeSpace()
   {
-    PoisonMemory();
+    PoisonMemory(region, region_size);
     ResetCodePtr();
   }
 
@@ -84,11 +91,60 @@ public:
   // Cannot currently be undone. Will write protect the entire code region.
   // Start over if you need to change the code (call FreeCodeSpace(), AllocCodeSpace()).
   void WriteProtect() { Common::WriteProtectMemory(region, region_size, true); }
-  void ResetCodePtr() { T::SetCodePtr(region); }
-  size_t GetSpaceLeft() const
+  void ResetCodePtr()
+  {
+    T::SetCodePtr(region);
+    m_current_region = 0;
+    m_region_ptrs.resize(m_num_regions);
+    for (size_t i = 0; i < m_num_regions; ++i)
+      m_region_ptrs[i] = GetRegionStart(i);
+  }
+  // Space left in the current region.
+  size_t GetSpaceLeft() const { return GetRegionSpaceLeft(m_current_region); }
+
+  // Splits the code space into equally sized regions, which are filled one at a time and can
+  // be reset independently. This lets a JIT recycle the code of its oldest blocks rather than
+  // clearing everything when it runs out of space. Call after all children have been added;
+  // resets the code pointer to the beginning of the first region.
+  void SetNumRegions(size_t num_regions)
+  {
+    _assert_(num_regions > 0);
+    m_num_regions = num_regions;
+    ResetCodePtr();
+  }
+  size_t GetNumRegions() const { return m_num_regions; }
+  size_t GetCurrentRegion() const { return m_current_region; }
+  u8* GetRegionStart(size_t index) const { return region + index * (region_size / m_num_regions); }
+  u8* GetRegionEnd(size_t index) const
+  {
+    return index + 1 == m_num_regions ? region + region_size : GetRegionStart(index + 1);
+  }
+  size_t GetRegionOf(const u8* ptr) const
+  {
+    return std::min<size_t>((ptr - region) / (region_size / m_num_regions), m_num_regions - 1);
+  }
+  size_t GetRegionSpaceLeft(size_t index) const
+  {
+    const u8* ptr = index == m_current_region ? T::GetCodePtr() : m_region_ptrs[index];
+    _assert_(ptr >= GetRegionStart(index) && ptr < GetRegionEnd(index));
+    return GetRegionEnd(index) - ptr;
+  }
+  // Continues emitting code where the given region was left off.
+  void SwitchToRegion(size_t index)
+  {
+    m_region_ptrs[m_current_region] = const_cast<u8*>(T::GetCodePtr());
+    m_current_region = index;
+    T::SetCodePtr(m_region_ptrs[index]);
+  }
+  // Makes the whole region available again, clearing it like ClearCodeSpace. The caller has to
+  // make sure that nothing refers to the code in it anymore.
+  void ResetRegion(size_t index)
   {
-    _assert_(static_cast<size_t>(T::GetCodePtr() - region) < region_size);
-    return region_size - (T::GetCodePtr() - region);
+    PoisonMemory(GetRegionStart(index), GetRegionEnd(index) - GetRegionStart(index));
+    if (index == m_current_region)
+      T::SetCodePtr(GetRegionStart(index));
+    else
+      m_region_ptrs[index] = GetRegionStart(index);
   }
 
   bool IsAlmostFull() const
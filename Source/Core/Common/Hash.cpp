@@ -11,6 +11,7 @@
 
 #ifdef _M_ARM_64
 #include <arm_acle.h>
+#include <arm_neon.h>
 #endif
 
 static u64 (*ptrHashFunction)(const u8* src, u32 len, u32 samples) = nullptr;
@@ -332,6 +333,280 @@ static u64 GetCRC32(const u8* src, u32 len, u32 samples)
 
 #endif
 
+// When enabled through SetHash64Function and AVX2 or NEON is available, unsampled hashes of larger
+// inputs use the long-input scheme of XXH3 instead of CRC32: eight 64-bit lanes are fed 64-byte
+// stripes mixed with a secret, which maps directly onto 32x32->64-bit vector multiplies. Every
+// implementation below gives exactly the same result, so the hash of a texture only depends on
+// whether this hash is in use.
+
+static constexpr u32 HASH_STRIPE_LEN = 64;
+static constexpr u32 HASH_SECRET_SIZE = 192;
+static constexpr u32 HASH_STRIPES_PER_BLOCK = (HASH_SECRET_SIZE - HASH_STRIPE_LEN) / 8;
+static constexpr u32 HASH_BLOCK_LEN = HASH_STRIPE_LEN * HASH_STRIPES_PER_BLOCK;
+static constexpr u32 HASH_MIN_VECTOR_LEN = 256;
+static constexpr u32 HASH_PRIME32 = 0x9E3779B1;
+
+alignas(64) static const u8 s_hash_secret[HASH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// Used for sampled hashes and small inputs when the vectorized hash is selected.
+static u64 (*ptrSampledHashFunction)(const u8* src, u32 len, u32 samples) = nullptr;
+
+static u64 ReadU64(const u8* ptr)
+{
+  u64 value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+static u64 MultiplyFold64(u64 a, u64 b)
+{
+#if defined(_MSC_VER) && defined(_M_X86_64)
+  u64 high;
+  const u64 low = _umul128(a, b, &high);
+  return low ^ high;
+#elif defined(_MSC_VER)
+  return (a * b) ^ __umulh(a, b);
+#else
+  const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  return static_cast<u64>(product) ^ static_cast<u64>(product >> 64);
+#endif
+}
+
+static bool IsSampledHash(u32 len, u32 samples)
+{
+  return samples != 0 && (len / 8) / samples > 1;
+}
+
+// All of the vector hash implementations accumulate the input the same way: blocks of 16 stripes,
+// with each stripe using the secret shifted by 8 bytes from the previous one and a scramble after
+// every block, then the remaining whole stripes, and finally a stripe covering the last 64 bytes.
+// That last stripe may overlap the previous one, so it uses a different part of the secret.
+static constexpr u32 HASH_SCRAMBLE_SECRET = HASH_SECRET_SIZE - HASH_STRIPE_LEN;
+static constexpr u32 HASH_LAST_STRIPE_SECRET = HASH_SCRAMBLE_SECRET - 7;
+
+static void AccumulateStripeGeneric(u64* acc, const u8* data, const u8* secret)
+{
+  for (u32 i = 0; i < 8; i++)
+  {
+    const u64 value = ReadU64(data + i * 8);
+    const u64 key = value ^ ReadU64(secret + i * 8);
+    acc[i ^ 1] += value;
+    acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+  }
+}
+
+static void ScrambleGeneric(u64* acc, const u8* secret)
+{
+  for (u32 i = 0; i < 8; i++)
+  {
+    u64 value = acc[i];
+    value ^= value >> 47;
+    value ^= ReadU64(secret + i * 8);
+    acc[i] = value * HASH_PRIME32;
+  }
+}
+
+static void AccumulateGeneric(u64* acc, const u8* src, u32 len)
+{
+  const u8* end = src + len;
+  const u32 blocks = (len - 1) / HASH_BLOCK_LEN;
+  for (u32 i = 0; i < blocks; i++, src += HASH_BLOCK_LEN)
+  {
+    for (u32 n = 0; n < HASH_STRIPES_PER_BLOCK; n++)
+      AccumulateStripeGeneric(acc, src + n * HASH_STRIPE_LEN, s_hash_secret + n * 8);
+    ScrambleGeneric(acc, s_hash_secret + HASH_SCRAMBLE_SECRET);
+  }
+
+  const u32 stripes = static_cast<u32>(end - 1 - src) / HASH_STRIPE_LEN;
+  for (u32 n = 0; n < stripes; n++)
+    AccumulateStripeGeneric(acc, src + n * HASH_STRIPE_LEN, s_hash_secret + n * 8);
+  AccumulateStripeGeneric(acc, end - HASH_STRIPE_LEN, s_hash_secret + HASH_LAST_STRIPE_SECRET);
+}
+
+#if defined(_M_X86_64)
+
+FUNCTION_TARGET_AVX2
+static inline void AccumulateStripeAVX2(__m256i* acc, const u8* data, const u8* secret)
+{
+  for (u32 i = 0; i < 2; i++)
+  {
+    const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i * 32));
+    const __m256i key = _mm256_xor_si256(
+        value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret + i * 32)));
+    acc[i] = _mm256_add_epi64(acc[i], _mm256_mul_epu32(key, _mm256_srli_epi64(key, 32)));
+    acc[i] = _mm256_add_epi64(acc[i], _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+  }
+}
+
+FUNCTION_TARGET_AVX2
+static inline void ScrambleAVX2(__m256i* acc, const u8* secret)
+{
+  const __m256i prime = _mm256_set1_epi32(static_cast<int>(HASH_PRIME32));
+  for (u32 i = 0; i < 2; i++)
+  {
+    __m256i value = _mm256_xor_si256(acc[i], _mm256_srli_epi64(acc[i], 47));
+    value = _mm256_xor_si256(
+        value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret + i * 32)));
+
+    // There is no 64-bit multiply, but the prime fits in 32 bits.
+    const __m256i low = _mm256_mul_epu32(value, prime);
+    const __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(value, 32), prime);
+    acc[i] = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+  }
+}
+
+FUNCTION_TARGET_AVX2
+static void AccumulateAVX2(u64* acc_out, const u8* src, u32 len)
+{
+  __m256i acc[2];
+  for (u32 i = 0; i < 2; i++)
+    acc[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc_out + i * 4));
+
+  const u8* end = src + len;
+  const u32 blocks = (len - 1) / HASH_BLOCK_LEN;
+  for (u32 i = 0; i < blocks; i++, src += HASH_BLOCK_LEN)
+  {
+    for (u32 n = 0; n < HASH_STRIPES_PER_BLOCK; n++)
+      AccumulateStripeAVX2(acc, src + n * HASH_STRIPE_LEN, s_hash_secret + n * 8);
+    ScrambleAVX2(acc, s_hash_secret + HASH_SCRAMBLE_SECRET);
+  }
+
+  const u32 stripes = static_cast<u32>(end - 1 - src) / HASH_STRIPE_LEN;
+  for (u32 n = 0; n < stripes; n++)
+    AccumulateStripeAVX2(acc, src + n * HASH_STRIPE_LEN, s_hash_secret + n * 8);
+  AccumulateStripeAVX2(acc, end - HASH_STRIPE_LEN, s_hash_secret + HASH_LAST_STRIPE_SECRET);
+
+  for (u32 i = 0; i < 2; i++)
+    _mm256_store_si256(reinterpret_cast<__m256i*>(acc_out + i * 4), acc[i]);
+}
+
+#elif defined(_M_ARM_64)
+
+static inline void AccumulateStripeNEON(uint64x2_t* acc, const u8* data, const u8* secret)
+{
+  for (u32 i = 0; i < 4; i++)
+  {
+    const uint64x2_t value = vreinterpretq_u64_u8(vld1q_u8(data + i * 16));
+    const uint64x2_t key = veorq_u64(value, vreinterpretq_u64_u8(vld1q_u8(secret + i * 16)));
+    acc[i] = vmlal_u32(acc[i], vmovn_u64(key), vshrn_n_u64(key, 32));
+    acc[i] = vaddq_u64(acc[i], vextq_u64(value, value, 1));
+  }
+}
+
+static inline void ScrambleNEON(uint64x2_t* acc, const u8* secret)
+{
+  const uint32x2_t prime = vdup_n_u32(HASH_PRIME32);
+  for (u32 i = 0; i < 4; i++)
+  {
+    uint64x2_t value = veorq_u64(acc[i], vshrq_n_u64(acc[i], 47));
+    value = veorq_u64(value, vreinterpretq_u64_u8(vld1q_u8(secret + i * 16)));
+
+    const uint64x2_t high = vshlq_n_u64(vmull_u32(vshrn_n_u64(value, 32), prime), 32);
+    acc[i] = vmlal_u32(high, vmovn_u64(value), prime);
+  }
+}
+
+static void AccumulateNEON(u64* acc_out, const u8* src, u32 len)
+{
+  uint64x2_t acc[4];
+  for (u32 i = 0; i < 4; i++)
+    acc[i] = vld1q_u64(acc_out + i * 2);
+
+  const u8* end = src + len;
+  const u32 blocks = (len - 1) / HASH_BLOCK_LEN;
+  for (u32 i = 0; i < blocks; i++, src += HASH_BLOCK_LEN)
+  {
+    for (u32 n = 0; n < HASH_STRIPES_PER_BLOCK; n++)
+      AccumulateStripeNEON(acc, src + n * HASH_STRIPE_LEN, s_hash_secret + n * 8);
+    ScrambleNEON(acc, s_hash_secret + HASH_SCRAMBLE_SECRET);
+  }
+
+  const u32 stripes = static_cast<u32>(end - 1 - src) / HASH_STRIPE_LEN;
+  for (u32 n = 0; n < stripes; n++)
+    AccumulateStripeNEON(acc, src + n * HASH_STRIPE_LEN, s_hash_secret + n * 8);
+  AccumulateStripeNEON(acc, end - HASH_STRIPE_LEN, s_hash_secret + HASH_LAST_STRIPE_SECRET);
+
+  for (u32 i = 0; i < 4; i++)
+    vst1q_u64(acc_out + i * 2, acc[i]);
+}
+
+#endif
+
+template <void (*Accumulate)(u64*, const u8*, u32)>
+static u64 GetVectorHash(const u8* src, u32 len)
+{
+  alignas(32) u64 acc[8] = {0x000000009E3779B1, 0x9E3779B185EBCA87, 0xC2B2AE3D27D4EB4F,
+                            0x165667B19E3779F9, 0x85EBCA77C2B2AE63, 0x0000000085EBCA77,
+                            0x27D4EB2F165667C5, 0x00000000C2B2AE3D};
+  Accumulate(acc, src, len);
+
+  u64 hash = len * 0x9E3779B185EBCA87;
+  for (u32 i = 0; i < 8; i += 2)
+  {
+    hash += MultiplyFold64(acc[i] ^ ReadU64(s_hash_secret + 11 + i * 8),
+                           acc[i + 1] ^ ReadU64(s_hash_secret + 19 + i * 8));
+  }
+
+  hash ^= hash >> 37;
+  hash *= 0x165667919E3779F9;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+#if defined(_M_X86_64)
+
+static u64 GetVectorHashAVX2(const u8* src, u32 len, u32 samples)
+{
+  if (len < HASH_MIN_VECTOR_LEN || IsSampledHash(len, samples))
+    return ptrSampledHashFunction(src, len, samples);
+
+  return GetVectorHash<AccumulateAVX2>(src, len);
+}
+
+#elif defined(_M_ARM_64)
+
+static u64 GetVectorHashNEON(const u8* src, u32 len, u32 samples)
+{
+  if (len < HASH_MIN_VECTOR_LEN || IsSampledHash(len, samples))
+    return ptrSampledHashFunction(src, len, samples);
+
+  return GetVectorHash<AccumulateNEON>(src, len);
+}
+
+#endif
+
+u64 GetVectorHash64Generic(const u8* src, u32 len)
+{
+  if (len < HASH_MIN_VECTOR_LEN)
+    return ptrSampledHashFunction(src, len, 0);
+
+  return GetVectorHash<AccumulateGeneric>(src, len);
+}
+
+bool IsHash64Vectorized()
+{
+#if defined(_M_X86_64)
+  return ptrHashFunction == &GetVectorHashAVX2;
+#elif defined(_M_ARM_64)
+  return ptrHashFunction == &GetVectorHashNEON;
+#else
+  return false;
+#endif
+}
+
 /*
  * NOTE: This hash function is used for custom texture loading/dumping, so
  * it should not be changed, which would require all custom textures to be
@@ -610,6 +885,17 @@ u64 GetHashHiresTexture(const u8* src, u32 len, u32 samples)
 
   return h;
 }
+
+u64 GetVectorHash64Generic(const u8* src, u32 len)
+{
+  // There is no vectorized hash on 32-bit builds.
+  return GetHash64(src, len, 0);
+}
+
+bool IsHash64Vectorized()
+{
+  return false;
+}
 #endif
 
 u64 GetHash64(const u8* src, u32 len, u32 samples)
@@ -618,16 +904,37 @@ u64 GetHash64(const u8* src, u32 len, u32 samples)
 }
 
 // sets the hash function used for the texture cache
-void SetHash64Function()
+void SetHash64Function(bool vector_hash)
 {
-#if defined(_M_X86_64) || defined(_M_X86)
+#if _ARCH_64
+  ptrSampledHashFunction = &GetMurmurHash3;
+#endif
+
+#if defined(_M_X86_64)
+  if (vector_hash && cpu_info.bAVX2)  // all CPUs with AVX2 also have SSE 4.2
+  {
+    ptrSampledHashFunction = &GetCRC32;
+    ptrHashFunction = &GetVectorHashAVX2;
+  }
+  else if (cpu_info.bSSE4_2)  // sse crc32 version
+  {
+    ptrHashFunction = &GetCRC32;
+  }
+  else
+#elif defined(_M_X86)
   if (cpu_info.bSSE4_2)  // sse crc32 version
   {
     ptrHashFunction = &GetCRC32;
   }
   else
 #elif defined(_M_ARM_64)
-  if (cpu_info.bCRC32)
+  if (vector_hash && cpu_info.bASIMD)
+  {
+    if (cpu_info.bCRC32)
+      ptrSampledHashFunction = &GetCRC32;
+    ptrHashFunction = &GetVectorHashNEON;
+  }
+  else if (cpu_info.bCRC32)
   {
     ptrHashFunction = &GetCRC32;
   }
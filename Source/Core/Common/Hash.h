@@ -13,4 +13,11 @@ u32 HashAdler32(const u8* data, size_t len);         // Fairly accurate, slightl
 u32 HashEctor(const u8* ptr, int length);            // JUNK. DO NOT USE FOR NEW THINGS
 u64 GetHashHiresTexture(const u8* src, u32 len, u32 samples = 0);
 u64 GetHash64(const u8* src, u32 len, u32 samples);
-void SetHash64Function();
+// CRC32 is used where available. With vector_hash, whole inputs are hashed with an AVX2 or NEON
+// hash instead, if the CPU supports it.
+void SetHash64Function(bool vector_hash = false);
+
+// The portable version of the hash GetHash64 uses for whole (unsampled) inputs when
+// IsHash64Vectorized, for testing the AVX2 and NEON versions against.
+u64 GetVectorHash64Generic(const u8* src, u32 len);
+bool IsHash64Vectorized();
@@ -2,13 +2,17 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <atomic>
 #include <cinttypes>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <vector>
 
+#include "Common/Align.h"
 #include "Common/CommonTypes.h"
 #include "Common/File.h"
 #include "Common/JitRegister.h"
@@ -20,6 +24,12 @@
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
 #if defined USE_OPROFILE && USE_OPROFILE
 #include <opagent.h>
 #endif
@@ -35,11 +45,201 @@ static op_agent_t s_agent = nullptr;
 
 static File::IOFile s_perf_map_file;
 
+#ifdef __linux__
+// The jitdump format is described in tools/perf/Documentation/jitdump-specification.txt in the
+// Linux sources. perf finds the file through an executable mapping of it, and the timestamps
+// are from CLOCK_MONOTONIC, so record with `perf record -k mono` and run `perf inject --jit`.
+namespace
+{
+constexpr u32 JITDUMP_MAGIC = 0x4A695444;
+constexpr u32 JITDUMP_VERSION = 1;
+#if defined(_M_X86_64)
+constexpr u32 JITDUMP_ELF_MACHINE = 62;  // EM_X86_64
+#elif defined(_M_ARM_64)
+constexpr u32 JITDUMP_ELF_MACHINE = 183;  // EM_AARCH64
+#else
+constexpr u32 JITDUMP_ELF_MACHINE = 0;
+#endif
+
+enum : u32
+{
+  JIT_CODE_LOAD = 0,
+  JIT_CODE_DEBUG_INFO = 2,
+};
+
+struct JitDumpHeader
+{
+  u32 magic;
+  u32 version;
+  u32 total_size;
+  u32 elf_mach;
+  u32 pad1;
+  u32 pid;
+  u64 timestamp;
+  u64 flags;
+};
+
+struct JitDumpRecordHeader
+{
+  u32 id;
+  u32 total_size;
+  u64 timestamp;
+};
+
+struct JitDumpCodeLoad
+{
+  JitDumpRecordHeader header;
+  u32 pid;
+  u32 tid;
+  u64 vma;
+  u64 code_addr;
+  u64 code_size;
+  u64 code_index;
+  // Followed by the null-terminated name and the code.
+};
+
+struct JitDumpDebugInfo
+{
+  JitDumpRecordHeader header;
+  u64 code_addr;
+  u64 nr_entry;
+  // Followed by nr_entry entries.
+};
+
+struct JitDumpDebugEntry
+{
+  u64 code_addr;
+  u32 line;
+  u32 discrim;
+  // Followed by the null-terminated file name.
+};
+}  // namespace
+
+static File::IOFile s_jitdump_file;
+static void* s_jitdump_marker = nullptr;
+static size_t s_jitdump_marker_size = 0;
+static std::atomic<u64> s_jitdump_code_index{0};
+
+static u64 JitDumpTimestamp()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<u64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+template <typename T>
+static void Append(std::vector<u8>* buffer, const T& value)
+{
+  const u8* bytes = reinterpret_cast<const u8*>(&value);
+  buffer->insert(buffer->end(), bytes, bytes + sizeof(T));
+}
+
+// perf's own JVMTI agent pads records to 8 bytes, so do the same.
+static void PadRecord(std::vector<u8>* buffer)
+{
+  buffer->resize(Common::AlignUp(buffer->size(), 8));
+}
+
+static void OpenJitDump(const std::string& dir)
+{
+  const std::string filename = StringFromFormat("%s/jit-%d.dump", dir.data(), getpid());
+  if (!s_jitdump_file.Open(filename, "w+b"))
+    return;
+  std::setvbuf(s_jitdump_file.GetHandle(), nullptr, _IONBF, 0);
+
+  JitDumpHeader header = {};
+  header.magic = JITDUMP_MAGIC;
+  header.version = JITDUMP_VERSION;
+  header.total_size = sizeof(header);
+  header.elf_mach = JITDUMP_ELF_MACHINE;
+  header.pid = static_cast<u32>(getpid());
+  header.timestamp = JitDumpTimestamp();
+  s_jitdump_file.WriteBytes(&header, sizeof(header));
+
+  s_jitdump_marker_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  s_jitdump_marker = mmap(nullptr, s_jitdump_marker_size, PROT_READ | PROT_EXEC, MAP_PRIVATE,
+                          fileno(s_jitdump_file.GetHandle()), 0);
+  if (s_jitdump_marker == MAP_FAILED)
+    s_jitdump_marker = nullptr;
+}
+
+static void CloseJitDump()
+{
+  if (s_jitdump_marker)
+    munmap(s_jitdump_marker, s_jitdump_marker_size);
+  s_jitdump_marker = nullptr;
+  s_jitdump_file.Close();
+}
+
+static void WriteJitDumpRecords(const void* base_address, u32 code_size,
+                                const std::vector<JitRegister::LineInfo>* lines,
+                                const std::string& symbol_name)
+{
+  // Each record is written with a single unbuffered write, so that records from different
+  // threads don't interleave.
+  std::vector<u8> buffer;
+  const u64 timestamp = JitDumpTimestamp();
+  const u64 code_addr = reinterpret_cast<u64>(base_address);
+
+  // Debug info has to come before the code it describes.
+  if (lines && !lines->empty())
+  {
+    JitDumpDebugInfo debug_info = {};
+    debug_info.header.id = JIT_CODE_DEBUG_INFO;
+    debug_info.header.timestamp = timestamp;
+    debug_info.code_addr = code_addr;
+    Append(&buffer, debug_info);
+    u64 entries = 0;
+    for (const JitRegister::LineInfo& line : *lines)
+    {
+      const u8* address = static_cast<const u8*>(line.code_address);
+      if (address < static_cast<const u8*>(base_address) ||
+          address >= static_cast<const u8*>(base_address) + code_size)
+      {
+        continue;
+      }
+      JitDumpDebugEntry entry = {};
+      entry.code_addr = reinterpret_cast<u64>(address);
+      entry.line = line.line;
+      Append(&buffer, entry);
+      buffer.insert(buffer.end(), symbol_name.begin(), symbol_name.end());
+      buffer.push_back(0);
+      ++entries;
+    }
+    PadRecord(&buffer);
+    JitDumpDebugInfo* header = reinterpret_cast<JitDumpDebugInfo*>(buffer.data());
+    header->header.total_size = static_cast<u32>(buffer.size());
+    header->nr_entry = entries;
+    s_jitdump_file.WriteBytes(buffer.data(), buffer.size());
+    buffer.clear();
+  }
+
+  JitDumpCodeLoad load = {};
+  load.header.id = JIT_CODE_LOAD;
+  load.header.timestamp = timestamp;
+  load.pid = static_cast<u32>(getpid());
+  load.tid = static_cast<u32>(syscall(SYS_gettid));
+  load.vma = code_addr;
+  load.code_addr = code_addr;
+  load.code_size = code_size;
+  load.code_index = s_jitdump_code_index++;
+  Append(&buffer, load);
+  buffer.insert(buffer.end(), symbol_name.begin(), symbol_name.end());
+  buffer.push_back(0);
+  const u8* code = static_cast<const u8*>(base_address);
+  buffer.insert(buffer.end(), code, code + code_size);
+  PadRecord(&buffer);
+  reinterpret_cast<JitDumpCodeLoad*>(buffer.data())->header.total_size =
+      static_cast<u32>(buffer.size());
+  s_jitdump_file.WriteBytes(buffer.data(), buffer.size());
+}
+#endif
+
 namespace JitRegister
 {
 static bool s_is_enabled = false;
 
-void Init(const std::string& perf_dir)
+void Init(const std::string& perf_dir, bool jitdump)
 {
 #if defined USE_OPROFILE && USE_OPROFILE
   s_agent = op_open_agent();
@@ -55,6 +255,11 @@ void Init(const std::string& perf_dir)
     // if the event of a crash:
     std::setvbuf(s_perf_map_file.GetHandle(), nullptr, _IONBF, 0);
     s_is_enabled = true;
+
+#ifdef __linux__
+    if (jitdump)
+      OpenJitDump(dir);
+#endif
   }
 }
 
@@ -72,6 +277,11 @@ void Shutdown()
   if (s_perf_map_file.IsOpen())
     s_perf_map_file.Close();
 
+#ifdef __linux__
+  if (s_jitdump_file.IsOpen())
+    CloseJitDump();
+#endif
+
   s_is_enabled = false;
 }
 
@@ -80,7 +290,8 @@ bool IsEnabled()
   return s_is_enabled;
 }
 
-void RegisterV(const void* base_address, u32 code_size, const char* format, va_list args)
+void RegisterV(const void* base_address, u32 code_size, const std::vector<LineInfo>* lines,
+               const char* format, va_list args)
 {
 #if !(defined USE_OPROFILE && USE_OPROFILE) && !defined(USE_VTUNE)
   if (!s_perf_map_file.IsOpen())
@@ -109,5 +320,10 @@ void RegisterV(const void* base_address, u32 code_size, const char* format, va_l
         StringFromFormat("%" PRIx64 " %x %s\n", (u64)base_address, code_size, symbol_name.data());
     s_perf_map_file.WriteBytes(entry.data(), entry.size());
   }
+
+#ifdef __linux__
+  if (s_jitdump_file.IsOpen())
+    WriteJitDumpRecords(base_address, code_size, lines, symbol_name);
+#endif
 }
 }
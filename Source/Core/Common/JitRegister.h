@@ -5,20 +5,29 @@
 #pragma once
 #include <stdarg.h>
 #include <string>
+#include <vector>
 #include "Common/CommonTypes.h"
 
 namespace JitRegister
 {
-void Init(const std::string& perf_dir);
+// Maps generated code to a line of its source, e.g. a guest instruction of a JIT block.
+struct LineInfo
+{
+  const void* code_address;
+  u32 line;
+};
+
+void Init(const std::string& perf_dir, bool jitdump = false);
 void Shutdown();
-void RegisterV(const void* base_address, u32 code_size, const char* format, va_list args);
+void RegisterV(const void* base_address, u32 code_size, const std::vector<LineInfo>* lines,
+               const char* format, va_list args);
 bool IsEnabled();
 
 inline void Register(const void* base_address, u32 code_size, const char* format, ...)
 {
   va_list args;
   va_start(args, format);
-  RegisterV(base_address, code_size, format, args);
+  RegisterV(base_address, code_size, nullptr, format, args);
   va_end(args);
 }
 
@@ -27,7 +36,17 @@ inline void Register(const void* start, const void* end, const char* format, ...
   va_list args;
   va_start(args, format);
   u32 code_size = (u32)((const char*)end - (const char*)start);
-  RegisterV(start, code_size, format, args);
+  RegisterV(start, code_size, nullptr, format, args);
+  va_end(args);
+}
+
+// The lines only end up in the jitdump file; the other formats have no use for them.
+inline void RegisterWithLines(const void* base_address, u32 code_size,
+                              const std::vector<LineInfo>& lines, const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  RegisterV(base_address, code_size, &lines, format, args);
   va_end(args);
 }
 }
@@ -1114,6 +1114,17 @@ public:
     ABI_CallFunction(func);
   }
 
+  template <typename FunctionPointer>
+  void ABI_CallFunctionPCA(int bits, FunctionPointer func, const void* param1, u32 param2,
+                           const Gen::OpArg& arg3)
+  {
+    if (!arg3.IsSimpleReg(ABI_PARAM3))
+      MOV(bits, R(ABI_PARAM3), arg3);
+    MOV(64, R(ABI_PARAM1), Imm64(reinterpret_cast<u64>(param1)));
+    MOV(32, R(ABI_PARAM2), Imm32(param2));
+    ABI_CallFunction(func);
+  }
+
   // Pass a register as a parameter.
   template <typename FunctionPointer>
   void ABI_CallFunctionR(FunctionPointer func, X64Reg reg1)
@@ -1176,15 +1187,22 @@ public:
     auto trampoline = &XEmitter::CallLambdaTrampoline<T, Args...>;
     ABI_CallFunctionPC(trampoline, reinterpret_cast<const void*>(f), p1);
   }
+
+  template <typename T, typename... Args>
+  void ABI_CallLambdaCA(int bits, const std::function<T(Args...)>* f, u32 p1, const Gen::OpArg& p2)
+  {
+    auto trampoline = &XEmitter::CallLambdaTrampoline<T, Args...>;
+    ABI_CallFunctionPCA(bits, trampoline, reinterpret_cast<const void*>(f), p1, p2);
+  }
 };  // class XEmitter
 
 class X64CodeBlock : public CodeBlock<XEmitter>
 {
 private:
-  void PoisonMemory() override
+  void PoisonMemory(u8* start, size_t size) override
   {
     // x86/64: 0xCC = breakpoint
-    memset(region, 0xCC, region_size);
+    memset(start, 0xCC, size);
   }
 };
 
@@ -28,6 +28,10 @@ const ConfigInfo<int> GFX_SUGGESTED_ASPECT_RATIO{{System::GFX, "Settings", "Sugg
 const ConfigInfo<bool> GFX_CROP{{System::GFX, "Settings", "Crop"}, false};
 const ConfigInfo<int> GFX_SAFE_TEXTURE_CACHE_COLOR_SAMPLES{
     {System::GFX, "Settings", "SafeTextureCacheColorSamples"}, 128};
+const ConfigInfo<bool> GFX_TEXTURE_WRITE_TRACKING{{System::GFX, "Settings", "TextureWriteTracking"},
+                                                  true};
+const ConfigInfo<bool> GFX_VECTOR_TEXTURE_HASH{{System::GFX, "Settings", "VectorTextureHash"},
+                                               false};
 const ConfigInfo<bool> GFX_SHOW_FPS{{System::GFX, "Settings", "ShowFPS"}, false};
 const ConfigInfo<bool> GFX_SHOW_NETPLAY_PING{{System::GFX, "Settings", "ShowNetPlayPing"}, false};
 const ConfigInfo<bool> GFX_SHOW_NETPLAY_MESSAGES{{System::GFX, "Settings", "ShowNetPlayMessages"},
@@ -87,6 +91,12 @@ const ConfigInfo<int> GFX_SHADER_COMPILER_THREADS{
     {System::GFX, "Settings", "ShaderCompilerThreads"}, 1};
 const ConfigInfo<int> GFX_SHADER_PRECOMPILER_THREADS{
     {System::GFX, "Settings", "ShaderPrecompilerThreads"}, 1};
+const ConfigInfo<int> GFX_VERTEX_LOADER_THREADS{
+    {System::GFX, "Settings", "VertexLoaderThreads"}, 0};
+const ConfigInfo<int> GFX_TEXTURE_DECODER_THREADS{
+    {System::GFX, "Settings", "TextureDecoderThreads"}, 0};
+const ConfigInfo<int> GFX_TEXTURE_PLACEHOLDER_FRAMES{
+    {System::GFX, "Settings", "TexturePlaceholderFrames"}, 2};
 
 const ConfigInfo<bool> GFX_SW_ZCOMPLOC{{System::GFX, "Settings", "SWZComploc"}, true};
 const ConfigInfo<bool> GFX_SW_ZFREEZE{{System::GFX, "Settings", "SWZFreeze"}, true};
@@ -24,6 +24,8 @@ extern const ConfigInfo<int> GFX_ASPECT_RATIO;
 extern const ConfigInfo<int> GFX_SUGGESTED_ASPECT_RATIO;
 extern const ConfigInfo<bool> GFX_CROP;
 extern const ConfigInfo<int> GFX_SAFE_TEXTURE_CACHE_COLOR_SAMPLES;
+extern const ConfigInfo<bool> GFX_TEXTURE_WRITE_TRACKING;
+extern const ConfigInfo<bool> GFX_VECTOR_TEXTURE_HASH;
 extern const ConfigInfo<bool> GFX_SHOW_FPS;
 extern const ConfigInfo<bool> GFX_SHOW_NETPLAY_PING;
 extern const ConfigInfo<bool> GFX_SHOW_NETPLAY_MESSAGES;
@@ -64,6 +66,9 @@ extern const ConfigInfo<bool> GFX_DISABLE_SPECIALIZED_SHADERS;
 extern const ConfigInfo<bool> GFX_PRECOMPILE_UBER_SHADERS;
 extern const ConfigInfo<int> GFX_SHADER_COMPILER_THREADS;
 extern const ConfigInfo<int> GFX_SHADER_PRECOMPILER_THREADS;
+extern const ConfigInfo<int> GFX_VERTEX_LOADER_THREADS;
+extern const ConfigInfo<int> GFX_TEXTURE_DECODER_THREADS;
+extern const ConfigInfo<int> GFX_TEXTURE_PLACEHOLDER_FRAMES;
 
 extern const ConfigInfo<bool> GFX_SW_ZCOMPLOC;
 extern const ConfigInfo<bool> GFX_SW_ZFREEZE;
@@ -89,11 +89,27 @@ const ConfigInfo<std::string> MAIN_GFX_BACKEND{{System::Main, "Core", "GFXBacken
 const ConfigInfo<std::string> MAIN_GPU_DETERMINISM_MODE{
     {System::Main, "Core", "GPUDeterminismMode"}, "auto"};
 const ConfigInfo<std::string> MAIN_PERF_MAP_DIR{{System::Main, "Core", "PerfMapDir"}, ""};
+const ConfigInfo<bool> MAIN_PERF_JIT_DUMP{{System::Main, "Core", "PerfJitDump"}, false};
 const ConfigInfo<bool> MAIN_CUSTOM_RTC_ENABLE{{System::Main, "Core", "EnableCustomRTC"}, false};
 // Default to seconds between 1.1.1970 and 1.1.2000
 const ConfigInfo<u32> MAIN_CUSTOM_RTC_VALUE{{System::Main, "Core", "CustomRTCValue"}, 946684800};
 const ConfigInfo<bool> MAIN_ENABLE_SIGNATURE_CHECKS{{System::Main, "Core", "EnableSignatureChecks"},
                                                     true};
+const ConfigInfo<bool> MAIN_JIT_DISK_BLOCK_CACHE{{System::Main, "Core", "JITDiskBlockCache"},
+                                                 false};
+const ConfigInfo<bool> MAIN_JIT_TIERED_COMPILATION{{System::Main, "Core", "JITTieredCompilation"},
+                                                   false};
+const ConfigInfo<bool> MAIN_JIT_BACKGROUND_COMPILATION{
+    {System::Main, "Core", "JITBackgroundCompilation"}, false};
+const ConfigInfo<bool> MAIN_JIT_TRACE_FORMATION{{System::Main, "Core", "JITTraceFormation"}, false};
+const ConfigInfo<bool> MAIN_JIT_REGISTER_PASSING{{System::Main, "Core", "JITRegisterPassing"},
+                                                 false};
+const ConfigInfo<bool> MAIN_JIT_RECYCLE_CODE_REGIONS{
+    {System::Main, "Core", "JITRecycleCodeRegions"}, true};
+const ConfigInfo<bool> MAIN_JIT_IDLE_LOOP_DETECTION{{System::Main, "Core", "JITIdleLoopDetection"},
+                                                    true};
+const ConfigInfo<bool> MAIN_JIT_CODE_PAGE_TRACKING{{System::Main, "Core", "JITCodePageTracking"},
+                                                   true};
 
 // Main.DSP
 
@@ -64,9 +64,18 @@ extern const ConfigInfo<bool> MAIN_OVERCLOCK_ENABLE;
 extern const ConfigInfo<std::string> MAIN_GFX_BACKEND;
 extern const ConfigInfo<std::string> MAIN_GPU_DETERMINISM_MODE;
 extern const ConfigInfo<std::string> MAIN_PERF_MAP_DIR;
+extern const ConfigInfo<bool> MAIN_PERF_JIT_DUMP;
 extern const ConfigInfo<bool> MAIN_CUSTOM_RTC_ENABLE;
 extern const ConfigInfo<u32> MAIN_CUSTOM_RTC_VALUE;
 extern const ConfigInfo<bool> MAIN_ENABLE_SIGNATURE_CHECKS;
+extern const ConfigInfo<bool> MAIN_JIT_DISK_BLOCK_CACHE;
+extern const ConfigInfo<bool> MAIN_JIT_TIERED_COMPILATION;
+extern const ConfigInfo<bool> MAIN_JIT_BACKGROUND_COMPILATION;
+extern const ConfigInfo<bool> MAIN_JIT_TRACE_FORMATION;
+extern const ConfigInfo<bool> MAIN_JIT_REGISTER_PASSING;
+extern const ConfigInfo<bool> MAIN_JIT_RECYCLE_CODE_REGIONS;
+extern const ConfigInfo<bool> MAIN_JIT_IDLE_LOOP_DETECTION;
+extern const ConfigInfo<bool> MAIN_JIT_CODE_PAGE_TRACKING;
 
 // Main.DSP
 
@@ -29,9 +29,11 @@ bool IsSettingSaveable(const Config::ConfigLocation& config_location)
 
       Config::GFX_WIDESCREEN_HACK.location, Config::GFX_ASPECT_RATIO.location,
       Config::GFX_CROP.location, Config::GFX_SAFE_TEXTURE_CACHE_COLOR_SAMPLES.location,
-      Config::GFX_SHOW_FPS.location, Config::GFX_SHOW_NETPLAY_PING.location,
-      Config::GFX_SHOW_NETPLAY_MESSAGES.location, Config::GFX_LOG_RENDER_TIME_TO_FILE.location,
-      Config::GFX_OVERLAY_STATS.location, Config::GFX_OVERLAY_PROJ_STATS.location,
+      Config::GFX_TEXTURE_WRITE_TRACKING.location, Config::GFX_VECTOR_TEXTURE_HASH.location,
+      Config::GFX_SHOW_FPS.location,
+      Config::GFX_SHOW_NETPLAY_PING.location, Config::GFX_SHOW_NETPLAY_MESSAGES.location,
+      Config::GFX_LOG_RENDER_TIME_TO_FILE.location, Config::GFX_OVERLAY_STATS.location,
+      Config::GFX_OVERLAY_PROJ_STATS.location,
       Config::GFX_DUMP_TEXTURES.location, Config::GFX_HIRES_TEXTURES.location,
       Config::GFX_CONVERT_HIRES_TEXTURES.location, Config::GFX_CACHE_HIRES_TEXTURES.location,
       Config::GFX_DUMP_EFB_TARGET.location, Config::GFX_DUMP_FRAMES_AS_IMAGES.location,
@@ -49,7 +51,8 @@ bool IsSettingSaveable(const Config::ConfigLocation& config_location)
       Config::GFX_BACKGROUND_SHADER_COMPILING.location,
       Config::GFX_DISABLE_SPECIALIZED_SHADERS.location,
       Config::GFX_PRECOMPILE_UBER_SHADERS.location, Config::GFX_SHADER_COMPILER_THREADS.location,
-      Config::GFX_SHADER_PRECOMPILER_THREADS.location,
+      Config::GFX_SHADER_PRECOMPILER_THREADS.location, Config::GFX_VERTEX_LOADER_THREADS.location,
+      Config::GFX_TEXTURE_DECODER_THREADS.location, Config::GFX_TEXTURE_PLACEHOLDER_FRAMES.location,
 
       Config::GFX_SW_ZCOMPLOC.location, Config::GFX_SW_ZFREEZE.location,
       Config::GFX_SW_DUMP_OBJECTS.location, Config::GFX_SW_DUMP_TEV_STAGES.location,
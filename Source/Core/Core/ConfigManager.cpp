@@ -282,9 +282,18 @@ void SConfig::SaveCoreSettings(IniFile& ini)
   core->Set("GFXBackend", m_strVideoBackend);
   core->Set("GPUDeterminismMode", m_strGPUDeterminismMode);
   core->Set("PerfMapDir", m_perfDir);
+  core->Set("PerfJitDump", bPerfJitDump);
   core->Set("EnableCustomRTC", bEnableCustomRTC);
   core->Set("CustomRTCValue", m_customRTCValue);
   core->Set("EnableSignatureChecks", m_enable_signature_checks);
+  core->Set("JITDiskBlockCache", bJITDiskBlockCache);
+  core->Set("JITTieredCompilation", bJITTieredCompilation);
+  core->Set("JITBackgroundCompilation", bJITBackgroundCompilation);
+  core->Set("JITTraceFormation", bJITTraceFormation);
+  core->Set("JITRegisterPassing", bJITRegisterPassing);
+  core->Set("JITRecycleCodeRegions", bJITRecycleCodeRegions);
+  core->Set("JITIdleLoopDetection", bJITIdleLoopDetection);
+  core->Set("JITCodePageTracking", bJITCodePageTracking);
 }
 
 void SConfig::SaveMovieSettings(IniFile& ini)
@@ -575,10 +584,19 @@ void SConfig::LoadCoreSettings(IniFile& ini)
   core->Get("GFXBackend", &m_strVideoBackend, "");
   core->Get("GPUDeterminismMode", &m_strGPUDeterminismMode, "auto");
   core->Get("PerfMapDir", &m_perfDir, "");
+  core->Get("PerfJitDump", &bPerfJitDump, false);
   core->Get("EnableCustomRTC", &bEnableCustomRTC, false);
   // Default to seconds between 1.1.1970 and 1.1.2000
   core->Get("CustomRTCValue", &m_customRTCValue, 946684800);
   core->Get("EnableSignatureChecks", &m_enable_signature_checks, true);
+  core->Get("JITDiskBlockCache", &bJITDiskBlockCache, false);
+  core->Get("JITTieredCompilation", &bJITTieredCompilation, false);
+  core->Get("JITBackgroundCompilation", &bJITBackgroundCompilation, false);
+  core->Get("JITTraceFormation", &bJITTraceFormation, false);
+  core->Get("JITRegisterPassing", &bJITRegisterPassing, false);
+  core->Get("JITRecycleCodeRegions", &bJITRecycleCodeRegions, true);
+  core->Get("JITIdleLoopDetection", &bJITIdleLoopDetection, true);
+  core->Get("JITCodePageTracking", &bJITCodePageTracking, true);
 }
 
 void SConfig::LoadMovieSettings(IniFile& ini)
@@ -90,6 +90,22 @@ struct SConfig
   bool bJITPairedOff = false;
   bool bJITSystemRegistersOff = false;
   bool bJITBranchOff = false;
+  // Remember compiled blocks between sessions and compile them again at boot.
+  bool bJITDiskBlockCache = false;
+  // Run blocks through the interpreter until they turn out to be hot, then compile them.
+  bool bJITTieredCompilation = false;
+  // Analyze hot blocks on a worker thread; implies tiered compilation.
+  bool bJITBackgroundCompilation = false;
+  // Re-form blocks along hot taken branches.
+  bool bJITTraceFormation = false;
+  // Keep guest registers in host registers across linked blocks (Jit64).
+  bool bJITRegisterPassing = false;
+  // Recycle the oldest part of the code space instead of clearing all of it when full (Jit64).
+  bool bJITRecycleCodeRegions = true;
+  // Skip ahead to the next event in polling loops found by the analyzer (Jit64).
+  bool bJITIdleLoopDetection = true;
+  // Catch writes to compiled code by write-protecting its pages, instead of relying on icbi.
+  bool bJITCodePageTracking = true;
 
   bool bFastmem;
   bool bFPRF = false;
@@ -188,6 +204,8 @@ struct SConfig
   std::string m_strWiiSDCardPath;
 
   std::string m_perfDir;
+  // Also write a perf jitdump file, which includes the compiled code, next to the perf map.
+  bool bPerfJitDump = false;
 
   std::string m_debugger_game_id;
   // TODO: remove this as soon as the ticket view hack in IOS/ES/Views is dropped.
@@ -60,6 +60,7 @@
 #include "Core/PatchEngine.h"
 #include "Core/PowerPC/JitInterface.h"
 #include "Core/PowerPC/PowerPC.h"
+#include "Core/PowerPC/Profiler.h"
 #include "Core/State.h"
 #include "Core/WiiRoot.h"
 
@@ -272,6 +273,9 @@ void Stop()  // - Hammertime!
 
   INFO_LOG(CONSOLE, "Stop [Main Thread]\t\t---- Shutting down ----");
 
+  // The samples are kept, so they can still be written after the game has stopped.
+  Profiler::StopSampling();
+
   // Stop the CPU
   INFO_LOG(CONSOLE, "%s", StopMessage(true, "Stop CPU").c_str());
   CPU::Stop();
@@ -5,15 +5,19 @@
 #include "Core/CoreTiming.h"
 
 #include <algorithm>
+#include <array>
 #include <cinttypes>
+#include <deque>
 #include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "Common/Assert.h"
+#include "Common/BitSet.h"
 #include "Common/ChunkFile.h"
 #include "Common/Logging/Log.h"
+#include "Common/MathUtil.h"
 #include "Common/SPSCQueue.h"
 #include "Common/StringUtil.h"
 #include "Common/Thread.h"
@@ -27,10 +31,14 @@
 
 namespace CoreTiming
 {
+struct EventNode;
+
 struct EventType
 {
   TimedCallback callback;
   const std::string* name;
+  // The pending events of this type, so that they can be removed without searching the queue.
+  EventNode* first_pending;
 };
 
 struct Event
@@ -51,16 +59,315 @@ static bool operator<(const Event& left, const Event& right)
   return std::tie(left.time, left.fifo_order) < std::tie(right.time, right.fifo_order);
 }
 
+struct EventNode
+{
+  Event event;
+  // Links within the queue bucket and within the list of pending events of the same type.
+  EventNode* prev;
+  EventNode* next;
+  EventNode* type_prev;
+  EventNode* type_next;
+  u32 bucket;
+};
+
+// A hierarchical timing wheel. Relative to the base time, an event goes to the level of the
+// highest byte in which its time differs from the base, and to the slot given by its time's
+// value in that byte. So every event of a level is due before every event of the levels above
+// it, and within a level the slots are in time order. Level 0 slots hold a single time each.
+// Scheduling and removing an event are O(1); moving the base forward moves the events of one
+// slot per level down the hierarchy.
+class EventQueue
+{
+public:
+  bool Empty() const { return m_size == 0; }
+
+  // Forgets all events and restarts the wheel at the given time.
+  void Clear(s64 base)
+  {
+    for (const Bucket& bucket : m_buckets)
+    {
+      for (EventNode* node = bucket.head; node; node = node->next)
+        node->event.type->first_pending = nullptr;
+    }
+    m_buckets.fill({});
+    for (auto& bitmap : m_bitmaps)
+      bitmap.fill(0);
+    m_nodes.clear();
+    m_free_nodes.clear();
+    m_size = 0;
+    m_base = base;
+  }
+
+  void Push(const Event& event)
+  {
+    EventNode* node;
+    if (!m_free_nodes.empty())
+    {
+      node = m_free_nodes.back();
+      m_free_nodes.pop_back();
+    }
+    else
+    {
+      m_nodes.emplace_back();
+      node = &m_nodes.back();
+    }
+    node->event = event;
+
+    EventType* type = event.type;
+    node->type_prev = nullptr;
+    node->type_next = type->first_pending;
+    if (type->first_pending)
+      type->first_pending->type_prev = node;
+    type->first_pending = node;
+
+    Insert(node);
+    ++m_size;
+  }
+
+  // Returns the event that is due first, or nullptr if there are no events.
+  EventNode* Front()
+  {
+    // Events that were scheduled behind the base are due before everything in the wheel.
+    if (m_buckets[OVERDUE_BUCKET].head)
+      return m_buckets[OVERDUE_BUCKET].head;
+
+    for (u32 level = 0; level < NUM_LEVELS; ++level)
+    {
+      for (u32 word = 0; word < BITMAP_WORDS; ++word)
+      {
+        if (m_bitmaps[level][word] == 0)
+          continue;
+        u32 slot = word * 64 + LeastSignificantSetBit(m_bitmaps[level][word]);
+        Bucket& bucket = m_buckets[level * SLOTS_PER_LEVEL + slot];
+        // Level 0 buckets are kept sorted.
+        return level == 0 ? bucket.head : FindEarliest(bucket);
+      }
+    }
+
+    return FindEarliest(m_buckets[OVERFLOW_BUCKET]);
+  }
+
+  // Takes the event that is due first out of the queue if it is due at the given time.
+  bool PopDue(s64 time, Event* event)
+  {
+    EventNode* node = Front();
+    if (!node || node->event.time > time)
+      return false;
+
+    // Moving the base to the event spreads out its slot, so that the events which are due next
+    // don't each have to be searched for.
+    AdvanceTo(node->event.time);
+    *event = node->event;
+    Remove(node);
+    return true;
+  }
+
+  void Remove(EventNode* node)
+  {
+    Unlink(node);
+
+    if (node->type_prev)
+      node->type_prev->type_next = node->type_next;
+    else
+      node->event.type->first_pending = node->type_next;
+    if (node->type_next)
+      node->type_next->type_prev = node->type_prev;
+
+    m_free_nodes.push_back(node);
+    --m_size;
+  }
+
+  void RemoveAll(EventType* type)
+  {
+    while (type->first_pending)
+      Remove(type->first_pending);
+  }
+
+  // Moves the base of the wheel forward. No event may be due before the new base.
+  void AdvanceTo(s64 base)
+  {
+    if (base <= m_base)
+      return;
+
+    u64 changed_bits = static_cast<u64>(m_base) ^ static_cast<u64>(base);
+    m_base = base;
+
+    // Events in the slots the base has now reached belong to lower levels. (Events in the slots
+    // the base has passed would be due, and there are none of those.)
+    if (changed_bits >> (NUM_LEVELS * SLOT_BITS))
+      Reinsert(OVERFLOW_BUCKET);
+    for (u32 level = NUM_LEVELS - 1; level > 0; --level)
+    {
+      if (changed_bits >> (level * SLOT_BITS))
+        Reinsert(level * SLOTS_PER_LEVEL + GetSlot(base, level));
+    }
+  }
+
+  // Returns a copy of all events, in no particular order.
+  std::vector<Event> GetEvents() const
+  {
+    std::vector<Event> events;
+    events.reserve(m_size);
+    for (const Bucket& bucket : m_buckets)
+    {
+      for (const EventNode* node = bucket.head; node; node = node->next)
+        events.push_back(node->event);
+    }
+    return events;
+  }
+
+private:
+  static constexpr u32 SLOT_BITS = 8;
+  static constexpr u32 SLOTS_PER_LEVEL = 1 << SLOT_BITS;
+  // Covers 2^32 cycles, a few seconds of emulated time. Later events go to the overflow bucket.
+  static constexpr u32 NUM_LEVELS = 4;
+  static constexpr u32 BITMAP_WORDS = SLOTS_PER_LEVEL / 64;
+  static constexpr u32 OVERDUE_BUCKET = NUM_LEVELS * SLOTS_PER_LEVEL;
+  static constexpr u32 OVERFLOW_BUCKET = OVERDUE_BUCKET + 1;
+  static constexpr u32 NUM_BUCKETS = OVERFLOW_BUCKET + 1;
+
+  struct Bucket
+  {
+    EventNode* head;
+    EventNode* tail;
+    // For unsorted buckets, the event that is due first, or nullptr if it has to be searched for.
+    EventNode* earliest;
+  };
+
+  static u32 GetSlot(s64 time, u32 level)
+  {
+    return static_cast<u32>(static_cast<u64>(time) >> (level * SLOT_BITS)) &
+           (SLOTS_PER_LEVEL - 1);
+  }
+
+  static EventNode* FindEarliest(Bucket& bucket)
+  {
+    if (bucket.earliest)
+      return bucket.earliest;
+
+    EventNode* earliest = bucket.head;
+    for (EventNode* node = bucket.head; node; node = node->next)
+    {
+      if (node->event < earliest->event)
+        earliest = node;
+    }
+    bucket.earliest = earliest;
+    return earliest;
+  }
+
+  void Insert(EventNode* node)
+  {
+    const s64 time = node->event.time;
+    u32 level = 0;
+    if (time < m_base)
+    {
+      node->bucket = OVERDUE_BUCKET;
+    }
+    else
+    {
+      u64 changed_bits = static_cast<u64>(time) ^ static_cast<u64>(m_base);
+      level = changed_bits ? IntLog2(changed_bits) / SLOT_BITS : 0;
+      node->bucket =
+          level < NUM_LEVELS ? level * SLOTS_PER_LEVEL + GetSlot(time, level) : OVERFLOW_BUCKET;
+    }
+
+    Bucket& bucket = m_buckets[node->bucket];
+    if (node->bucket < SLOTS_PER_LEVEL || node->bucket == OVERDUE_BUCKET)
+    {
+      // Keep the bucket sorted, so that the head is due first. Events are mostly scheduled in
+      // order, so this rarely has to walk far.
+      EventNode* prev = bucket.tail;
+      while (prev && node->event < prev->event)
+        prev = prev->prev;
+      LinkAfter(bucket, prev, node);
+    }
+    else
+    {
+      LinkAfter(bucket, bucket.tail, node);
+      if (bucket.head == node || (bucket.earliest && node->event < bucket.earliest->event))
+        bucket.earliest = node;
+    }
+
+    if (node->bucket < OVERDUE_BUCKET)
+    {
+      u32 slot = node->bucket % SLOTS_PER_LEVEL;
+      m_bitmaps[level][slot / 64] |= 1ULL << (slot % 64);
+    }
+  }
+
+  static void LinkAfter(Bucket& bucket, EventNode* prev, EventNode* node)
+  {
+    node->prev = prev;
+    node->next = prev ? prev->next : bucket.head;
+    if (node->next)
+      node->next->prev = node;
+    else
+      bucket.tail = node;
+    if (prev)
+      prev->next = node;
+    else
+      bucket.head = node;
+  }
+
+  void Unlink(EventNode* node)
+  {
+    Bucket& bucket = m_buckets[node->bucket];
+    if (node->prev)
+      node->prev->next = node->next;
+    else
+      bucket.head = node->next;
+    if (node->next)
+      node->next->prev = node->prev;
+    else
+      bucket.tail = node->prev;
+    if (bucket.earliest == node)
+      bucket.earliest = nullptr;
+
+    if (!bucket.head && node->bucket < OVERDUE_BUCKET)
+    {
+      u32 level = node->bucket / SLOTS_PER_LEVEL;
+      u32 slot = node->bucket % SLOTS_PER_LEVEL;
+      m_bitmaps[level][slot / 64] &= ~(1ULL << (slot % 64));
+    }
+  }
+
+  void Reinsert(u32 bucket_index)
+  {
+    // Detach the whole list first, as events may go back into the same (overflow) bucket.
+    Bucket& bucket = m_buckets[bucket_index];
+    EventNode* node = bucket.head;
+    if (!node)
+      return;
+    bucket = {};
+    if (bucket_index < OVERDUE_BUCKET)
+    {
+      u32 slot = bucket_index % SLOTS_PER_LEVEL;
+      m_bitmaps[bucket_index / SLOTS_PER_LEVEL][slot / 64] &= ~(1ULL << (slot % 64));
+    }
+
+    while (node)
+    {
+      EventNode* next = node->next;
+      Insert(node);
+      node = next;
+    }
+  }
+
+  std::array<Bucket, NUM_BUCKETS> m_buckets{};
+  std::array<std::array<u64, BITMAP_WORDS>, NUM_LEVELS> m_bitmaps{};
+  // Nodes are never freed before Clear(), so that pointers to them stay valid.
+  std::deque<EventNode> m_nodes;
+  std::vector<EventNode*> m_free_nodes;
+  size_t m_size = 0;
+  s64 m_base = 0;
+};
+
 // unordered_map stores each element separately as a linked list node so pointers to elements
 // remain stable regardless of rehashes/resizing.
 static std::unordered_map<std::string, EventType> s_event_types;
 
 // STATE_TO_SAVE
-// The queue is a min-heap using std::make_heap/push_heap/pop_heap.
-// We don't use std::priority_queue because we need to be able to serialize, unserialize and
-// erase arbitrary events (RemoveEvent()) regardless of the queue order. These aren't accomodated
-// by the standard adaptor class.
-static std::vector<Event> s_event_queue;
+static EventQueue s_event_queue;
 static u64 s_event_fifo_id;
 static std::mutex s_ts_write_lock;
 static Common::SPSCQueue<Event, false> s_ts_queue;
@@ -109,7 +416,7 @@ EventType* RegisterEvent(const std::string& name, TimedCallback callback)
                "during Init to avoid breaking save states.",
                name.c_str());
 
-  auto info = s_event_types.emplace(name, EventType{callback, nullptr});
+  auto info = s_event_types.emplace(name, EventType{callback, nullptr, nullptr});
   EventType* event_type = &info.first->second;
   event_type->name = &info.first->first;
   return event_type;
@@ -117,7 +424,7 @@ EventType* RegisterEvent(const std::string& name, TimedCallback callback)
 
 void UnregisterAllEvents()
 {
-  _assert_msg_(POWERPC, s_event_queue.empty(), "Cannot unregister events with events pending");
+  _assert_msg_(POWERPC, s_event_queue.Empty(), "Cannot unregister events with events pending");
   s_event_types.clear();
 }
 
@@ -129,6 +436,7 @@ void Init()
   g.slice_length = MAX_SLICE_LENGTH;
   g.global_timer = 0;
   s_idled_cycles = 0;
+  ClearPendingEvents();
 
   // The time between CoreTiming being intialized and the first call to Advance() is considered
   // the slice boundary between slice -1 and slice 0. Dispatcher loops must call Advance() before
@@ -165,7 +473,11 @@ void DoState(PointerWrap& p)
   p.DoMarker("CoreTimingData");
 
   MoveEvents();
-  p.DoEachElement(s_event_queue, [](PointerWrap& pw, Event& ev) {
+  // The events are saved as a plain list, which is what the old binary heap stored.
+  std::vector<Event> events;
+  if (p.GetMode() != PointerWrap::MODE_READ)
+    events = s_event_queue.GetEvents();
+  p.DoEachElement(events, [](PointerWrap& pw, Event& ev) {
     pw.Do(ev.time);
     pw.Do(ev.fifo_order);
 
@@ -202,7 +514,11 @@ void DoState(PointerWrap& p)
   // The exact layout of the heap in memory is implementation defined, therefore it is platform
   // and library version specific.
   if (p.GetMode() == PointerWrap::MODE_READ)
-    std::make_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+  {
+    s_event_queue.Clear(g.global_timer);
+    for (const Event& ev : events)
+      s_event_queue.Push(ev);
+  }
 }
 
 // This should only be called from the CPU thread. If you are calling
@@ -225,7 +541,7 @@ u64 GetIdleTicks()
 
 void ClearPendingEvents()
 {
-  s_event_queue.clear();
+  s_event_queue.Clear(g.global_timer);
 }
 
 void ScheduleEvent(s64 cycles_into_future, EventType* event_type, u64 userdata, FromThread from)
@@ -253,8 +569,7 @@ void ScheduleEvent(s64 cycles_into_future, EventType* event_type, u64 userdata,
     if (!s_is_global_timer_sane)
       ForceExceptionCheck(cycles_into_future);
 
-    s_event_queue.emplace_back(Event{timeout, s_event_fifo_id++, userdata, event_type});
-    std::push_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+    s_event_queue.Push(Event{timeout, s_event_fifo_id++, userdata, event_type});
   }
   else
   {
@@ -272,15 +587,7 @@ void ScheduleEvent(s64 cycles_into_future, EventType* event_type, u64 userdata,
 
 void RemoveEvent(EventType* event_type)
 {
-  auto itr = std::remove_if(s_event_queue.begin(), s_event_queue.end(),
-                            [&](const Event& e) { return e.type == event_type; });
-
-  // Removing random items breaks the invariant so we have to re-establish it.
-  if (itr != s_event_queue.end())
-  {
-    s_event_queue.erase(itr, s_event_queue.end());
-    std::make_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
-  }
+  s_event_queue.RemoveAll(event_type);
 }
 
 void RemoveAllEvents(EventType* event_type)
@@ -306,8 +613,7 @@ void MoveEvents()
   for (Event ev; s_ts_queue.Pop(ev);)
   {
     ev.fifo_order = s_event_fifo_id++;
-    s_event_queue.emplace_back(std::move(ev));
-    std::push_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+    s_event_queue.Push(ev);
   }
 }
 
@@ -323,23 +629,21 @@ void Advance()
 
   s_is_global_timer_sane = true;
 
-  while (!s_event_queue.empty() && s_event_queue.front().time <= g.global_timer)
+  for (Event evt; s_event_queue.PopDue(g.global_timer, &evt);)
   {
-    Event evt = std::move(s_event_queue.front());
-    std::pop_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
-    s_event_queue.pop_back();
     // NOTICE_LOG(POWERPC, "[Scheduler] %-20s (%lld, %lld)", evt.type->name->c_str(),
     //            g.global_timer, evt.time);
     evt.type->callback(evt.userdata, g.global_timer - evt.time);
   }
 
   s_is_global_timer_sane = false;
+  s_event_queue.AdvanceTo(g.global_timer);
 
   // Still events left (scheduled in the future)
-  if (!s_event_queue.empty())
+  if (const EventNode* next = s_event_queue.Front())
   {
-    g.slice_length = static_cast<int>(
-        std::min<s64>(s_event_queue.front().time - g.global_timer, MAX_SLICE_LENGTH));
+    g.slice_length =
+        static_cast<int>(std::min<s64>(next->event.time - g.global_timer, MAX_SLICE_LENGTH));
   }
 
   PowerPC::ppcState.downcount = CyclesToDowncount(g.slice_length);
@@ -353,7 +657,7 @@ void Advance()
 
 void LogPendingEvents()
 {
-  auto clone = s_event_queue;
+  auto clone = s_event_queue.GetEvents();
   std::sort(clone.begin(), clone.end());
   for (const Event& ev : clone)
   {
@@ -365,10 +669,13 @@ void LogPendingEvents()
 // Should only be called from the CPU thread after the PPC clock has changed
 void AdjustEventQueueTimes(u32 new_ppc_clock, u32 old_ppc_clock)
 {
-  for (Event& ev : s_event_queue)
+  std::vector<Event> events = s_event_queue.GetEvents();
+  s_event_queue.Clear(g.global_timer);
+  for (Event& ev : events)
   {
     const s64 ticks = (ev.time - g.global_timer) * new_ppc_clock / old_ppc_clock;
     ev.time = g.global_timer + ticks;
+    s_event_queue.Push(ev);
   }
 }
 
@@ -391,7 +698,7 @@ std::string GetScheduledEventsSummary()
   std::string text = "Scheduled events\n";
   text.reserve(1000);
 
-  auto clone = s_event_queue;
+  auto clone = s_event_queue.GetEvents();
   std::sort(clone.begin(), clone.end());
   for (const Event& ev : clone)
   {
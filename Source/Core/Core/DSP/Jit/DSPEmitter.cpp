@@ -12,6 +12,7 @@
 #include "Common/BitSet.h"
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
+#include "Common/JitRegister.h"
 #include "Common/Logging/Log.h"
 
 #include "Core/DSP/DSPAnalyzer.h"
@@ -376,6 +377,8 @@ void DSPEmitter::Compile(u16 start_addr)
     MOV(16, R(EAX), Imm16(m_block_size[start_addr]));
   }
   JMP(m_return_dispatcher, true);
+
+  JitRegister::Register(entryPoint, GetCodePtr(), "JIT_DSP_%04x", start_addr);
 }
 
 static void CompileCurrent()
@@ -406,6 +409,7 @@ const u8* DSPEmitter::CompileStub()
   ABI_CallFunction(CompileCurrent);
   XOR(32, R(EAX), R(EAX));  // Return 0 cycles executed
   JMP(m_return_dispatcher);
+  JitRegister::Register(entryPoint, GetCodePtr(), "JIT_DSP_CompileStub");
   return entryPoint;
 }
 
@@ -453,6 +457,7 @@ void DSPEmitter::CompileDispatcher()
   // MOV(32, M(&cyclesLeft), Imm32(0));
   ABI_PopRegistersAndAdjustStack(registers_used, 8);
   RET();
+  JitRegister::Register(m_enter_dispatcher, GetCodePtr(), "JIT_DSP_Dispatcher");
 }
 
 Gen::OpArg DSPEmitter::M_SDSP_pc()
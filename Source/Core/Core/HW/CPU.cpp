@@ -13,6 +13,7 @@
 #include "Core/Core.h"
 #include "Core/Host.h"
 #include "Core/PowerPC/PowerPC.h"
+#include "Core/PowerPC/Profiler.h"
 #include "VideoCommon/Fifo.h"
 
 namespace CPU
@@ -70,6 +71,7 @@ static void FlushStepSyncEventLocked()
 
 void Run()
 {
+  Profiler::RegisterCPUThread();
   std::unique_lock<std::mutex> state_lock(s_state_change_lock);
   while (s_state != State::PowerDown)
   {
@@ -139,6 +141,7 @@ void Run()
     }
   }
   state_lock.unlock();
+  Profiler::UnregisterCPUThread();
   Host_UpdateDisasmDialog();
 }
 
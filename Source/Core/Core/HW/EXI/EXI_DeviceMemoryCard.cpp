@@ -510,6 +510,7 @@ IEXIDevice* CEXIMemoryCard::FindDevice(TEXIDevices device_type, int customIndex)
 // read all at once instead of single byte at a time as done by IEXIDevice::DMARead
 void CEXIMemoryCard::DMARead(u32 _uAddr, u32 _uSize)
 {
+  Memory::NotifyPhysicalWrite(_uAddr, _uSize);
   memorycard->Read(address, _uSize, Memory::GetPointer(_uAddr));
 
   if ((address + _uSize) % BLOCK_SIZE == 0)
@@ -4,10 +4,15 @@
 
 #include "Core/HW/MMIO.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <numeric>
+#include <vector>
 
 #include "Common/Assert.h"
 #include "Common/CommonTypes.h"
+#include "Common/Logging/Log.h"
 #include "Core/HW/MMIOHandlers.h"
 
 namespace MMIO
@@ -229,45 +234,221 @@ struct LargerAccessSize<u16>
   typedef u32 value;
 };
 
+// Visitors used by the combined handling methods below to find out how the
+// handlers they combine are implemented.
+template <typename T>
+class ReadHandlerInspector : public ReadHandlingMethodVisitor<T>
+{
+public:
+  virtual ~ReadHandlerInspector() = default;
+
+  void VisitConstant(T value) override
+  {
+    is_constant = true;
+    constant_value = value;
+  }
+
+  void VisitDirect(const T* addr, u32 mask) override
+  {
+    direct_addr = addr;
+    direct_mask = mask;
+  }
+
+  void VisitComplex(const std::function<T(u32)>* lambda) override {}
+
+  bool is_constant = false;
+  T constant_value = 0;
+  const T* direct_addr = nullptr;
+  u32 direct_mask = 0;
+};
+
+template <typename T>
+class WriteHandlerInspector : public WriteHandlingMethodVisitor<T>
+{
+public:
+  virtual ~WriteHandlerInspector() = default;
+
+  void VisitNop() override { is_nop = true; }
+  void VisitDirect(T* addr, u32 mask) override
+  {
+    direct_addr = addr;
+    direct_mask = mask;
+  }
+
+  void VisitComplex(const std::function<void(u32, T)>* lambda) override {}
+
+  bool is_nop = false;
+  T* direct_addr = nullptr;
+  u32 direct_mask = 0;
+};
+
+// Returns whether the two halves of a larger value, each accessed through a
+// Direct handler, live next to each other in host memory in the layout of the
+// larger value. Dolphin only runs on little endian hosts, so the low half has
+// to come first.
+template <typename T, typename ST>
+bool AreAdjacentHalves(const ST* high_part, const ST* low_part)
+{
+  return high_part && low_part && high_part == low_part + 1 &&
+         reinterpret_cast<uintptr_t>(low_part) % sizeof(T) == 0;
+}
+
+template <typename ST>
+u32 CombineMasks(u32 high_mask, u32 low_mask)
+{
+  constexpr u32 part_bits = 8 * sizeof(ST);
+  constexpr u32 part_mask = (1U << part_bits) - 1;
+  return ((high_mask & part_mask) << part_bits) | (low_mask & part_mask);
+}
+
+// The combined handling methods look at the handlers they combine when they
+// are visited, and expose the combination as a single Constant or Direct
+// access whenever they can. This is what allows the JITs to inline most of the
+// 32 bit accesses to registers that are implemented as pairs of 16 bit
+// registers. Everything else falls back to a Complex access calling the
+// smaller/larger handlers.
+template <typename T>
+class ReadToSmallerHandlingMethod : public ReadHandlingMethod<T>
+{
+public:
+  using ST = typename SmallerAccessSize<T>::value;
+
+  ReadToSmallerHandlingMethod(ReadHandler<ST>* high_part, u32 high_part_addr,
+                              ReadHandler<ST>* low_part, u32 low_part_addr)
+      : high_part_(high_part), low_part_(low_part),
+        complex_([=](u32 addr) {
+          return ((T)high_part->Read(high_part_addr) << (8 * sizeof(ST))) |
+                 low_part->Read(low_part_addr);
+        })
+  {
+  }
+  virtual ~ReadToSmallerHandlingMethod() = default;
+
+  void AcceptReadVisitor(ReadHandlingMethodVisitor<T>& v) const override
+  {
+    ReadHandlerInspector<ST> high, low;
+    high_part_->Visit(high);
+    low_part_->Visit(low);
+
+    if (high.is_constant && low.is_constant)
+      v.VisitConstant(((T)high.constant_value << (8 * sizeof(ST))) | low.constant_value);
+    else if (AreAdjacentHalves<T>(high.direct_addr, low.direct_addr))
+      v.VisitDirect(reinterpret_cast<const T*>(low.direct_addr),
+                    CombineMasks<ST>(high.direct_mask, low.direct_mask));
+    else
+      v.VisitComplex(&complex_);
+  }
+
+private:
+  ReadHandler<ST>* high_part_;
+  ReadHandler<ST>* low_part_;
+  std::function<T(u32)> complex_;
+};
 template <typename T>
 ReadHandlingMethod<T>* ReadToSmaller(Mapping* mmio, u32 high_part_addr, u32 low_part_addr)
 {
   typedef typename SmallerAccessSize<T>::value ST;
 
-  ReadHandler<ST>* high_part = &mmio->GetHandlerForRead<ST>(high_part_addr);
-  ReadHandler<ST>* low_part = &mmio->GetHandlerForRead<ST>(low_part_addr);
-
-  // TODO(delroth): optimize
-  return ComplexRead<T>([=](u32 addr) {
-    return ((T)high_part->Read(high_part_addr) << (8 * sizeof(ST))) | low_part->Read(low_part_addr);
-  });
+  return new ReadToSmallerHandlingMethod<T>(&mmio->GetHandlerForRead<ST>(high_part_addr),
+                                            high_part_addr,
+                                            &mmio->GetHandlerForRead<ST>(low_part_addr),
+                                            low_part_addr);
 }
 
+template <typename T>
+class WriteToSmallerHandlingMethod : public WriteHandlingMethod<T>
+{
+public:
+  using ST = typename SmallerAccessSize<T>::value;
+
+  WriteToSmallerHandlingMethod(WriteHandler<ST>* high_part, u32 high_part_addr,
+                               WriteHandler<ST>* low_part, u32 low_part_addr)
+      : high_part_(high_part), low_part_(low_part), complex_([=](u32 addr, T val) {
+          high_part->Write(high_part_addr, val >> (8 * sizeof(ST)));
+          low_part->Write(low_part_addr, (ST)val);
+        })
+  {
+  }
+  virtual ~WriteToSmallerHandlingMethod() = default;
+
+  void AcceptWriteVisitor(WriteHandlingMethodVisitor<T>& v) const override
+  {
+    WriteHandlerInspector<ST> high, low;
+    high_part_->Visit(high);
+    low_part_->Visit(low);
+
+    if (high.is_nop && low.is_nop)
+      v.VisitNop();
+    else if (AreAdjacentHalves<T>(high.direct_addr, low.direct_addr))
+      v.VisitDirect(reinterpret_cast<T*>(low.direct_addr),
+                    CombineMasks<ST>(high.direct_mask, low.direct_mask));
+    else
+      v.VisitComplex(&complex_);
+  }
+
+private:
+  WriteHandler<ST>* high_part_;
+  WriteHandler<ST>* low_part_;
+  std::function<void(u32, T)> complex_;
+};
 template <typename T>
 WriteHandlingMethod<T>* WriteToSmaller(Mapping* mmio, u32 high_part_addr, u32 low_part_addr)
 {
   typedef typename SmallerAccessSize<T>::value ST;
 
-  WriteHandler<ST>* high_part = &mmio->GetHandlerForWrite<ST>(high_part_addr);
-  WriteHandler<ST>* low_part = &mmio->GetHandlerForWrite<ST>(low_part_addr);
-
-  // TODO(delroth): optimize
-  return ComplexWrite<T>([=](u32 addr, T val) {
-    high_part->Write(high_part_addr, val >> (8 * sizeof(ST)));
-    low_part->Write(low_part_addr, (ST)val);
-  });
+  return new WriteToSmallerHandlingMethod<T>(&mmio->GetHandlerForWrite<ST>(high_part_addr),
+                                             high_part_addr,
+                                             &mmio->GetHandlerForWrite<ST>(low_part_addr),
+                                             low_part_addr);
 }
 
+template <typename T>
+class ReadToLargerHandlingMethod : public ReadHandlingMethod<T>
+{
+public:
+  using LT = typename LargerAccessSize<T>::value;
+
+  ReadToLargerHandlingMethod(ReadHandler<LT>* large, u32 shift)
+      : large_(large), shift_(shift), complex_([large, shift](u32 addr) {
+          return large->Read(addr & ~(sizeof(LT) - 1)) >> shift;
+        })
+  {
+  }
+  virtual ~ReadToLargerHandlingMethod() = default;
+
+  void AcceptReadVisitor(ReadHandlingMethodVisitor<T>& v) const override
+  {
+    ReadHandlerInspector<LT> large;
+    large_->Visit(large);
+
+    constexpr u32 all_ones = (1U << (8 * sizeof(T))) - 1;
+    if (large.is_constant)
+    {
+      v.VisitConstant((T)(large.constant_value >> shift_));
+    }
+    else if (large.direct_addr && shift_ % 8 == 0)
+    {
+      // Little endian host: the bits starting at shift_ are shift_ / 8 bytes in.
+      const u8* bytes = reinterpret_cast<const u8*>(large.direct_addr) + shift_ / 8;
+      v.VisitDirect(reinterpret_cast<const T*>(bytes), (large.direct_mask >> shift_) & all_ones);
+    }
+    else
+    {
+      v.VisitComplex(&complex_);
+    }
+  }
+
+private:
+  ReadHandler<LT>* large_;
+  u32 shift_;
+  std::function<T(u32)> complex_;
+};
 template <typename T>
 ReadHandlingMethod<T>* ReadToLarger(Mapping* mmio, u32 larger_addr, u32 shift)
 {
   typedef typename LargerAccessSize<T>::value LT;
 
-  ReadHandler<LT>* large = &mmio->GetHandlerForRead<LT>(larger_addr);
-
-  // TODO(delroth): optimize
-  return ComplexRead<T>(
-      [large, shift](u32 addr) { return large->Read(addr & ~(sizeof(LT) - 1)) >> shift; });
+  return new ReadToLargerHandlingMethod<T>(&mmio->GetHandlerForRead<LT>(larger_addr), shift);
 }
 
 // Inplementation of the ReadHandler and WriteHandler class. There is a lot of
@@ -381,6 +562,27 @@ void WriteHandler<T>::ResetMethod(WriteHandlingMethod<T>* method)
   m_WriteFunc = v.ret;
 }
 
+void Mapping::LogHottestSlowAccesses(size_t count) const
+{
+  auto total = [this](u32 index) {
+    return static_cast<u64>(m_slow_read_counts[index]) + m_slow_write_counts[index];
+  };
+
+  std::vector<u32> indices(m_slow_read_counts.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  count = std::min(count, indices.size());
+  std::partial_sort(indices.begin(), indices.begin() + count, indices.end(),
+                    [&](u32 a, u32 b) { return total(a) > total(b); });
+
+  for (size_t i = 0; i < count && total(indices[i]) != 0; ++i)
+  {
+    const u32 unique_id = indices[i] * sizeof(u32);
+    const u32 address = ((unique_id >> 16) ? 0x0D000000 : 0x0C000000) | (unique_id & 0xFFFF);
+    INFO_LOG(MEMMAP, "MMIO %08x: %u slow reads, %u slow writes", address,
+             m_slow_read_counts[indices[i]], m_slow_write_counts[indices[i]]);
+  }
+}
+
 // Define all the public specializations that are exported in MMIOHandlers.h.
 #define MaybeExtern
 MMIO_PUBLIC_SPECIALIZATIONS()
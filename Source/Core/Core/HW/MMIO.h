@@ -127,15 +127,39 @@ public:
   template <typename Unit>
   Unit Read(u32 addr)
   {
+    ++m_num_slow_reads;
+    ++m_slow_read_counts[UniqueID(addr) / sizeof(u32)];
     return GetHandlerForRead<Unit>(addr).Read(addr);
   }
 
   template <typename Unit>
   void Write(u32 addr, Unit val)
   {
+    ++m_num_slow_writes;
+    ++m_slow_write_counts[UniqueID(addr) / sizeof(u32)];
     GetHandlerForWrite<Unit>(addr).Write(addr, val);
   }
 
+  // Access statistics.
+  //
+  // Accesses the JITs inline never go through Read/Write, so these count how
+  // often each 32 bit register was accessed in a way that could not be
+  // specialized: from the interpreter, or from JIT'd code that did not know
+  // the address at compile time. The counters are not synchronized and are
+  // only meant as a profiling aid. The totals are shown in the statistics
+  // overlay.
+  u64 GetNumSlowReads() const { return m_num_slow_reads; }
+  u64 GetNumSlowWrites() const { return m_num_slow_writes; }
+  u32 GetSlowReadCount(u32 addr) const { return m_slow_read_counts[UniqueID(addr) / sizeof(u32)]; }
+  u32 GetSlowWriteCount(u32 addr) const
+  {
+    return m_slow_write_counts[UniqueID(addr) / sizeof(u32)];
+  }
+
+  // Logs the registers with the most slow accesses, along with how they are
+  // handled.
+  void LogHottestSlowAccesses(size_t count) const;
+
   // Handlers access interface.
   //
   // Use when you care more about how to access the MMIO register for an
@@ -177,6 +201,11 @@ private:
   HandlerArray<u16>::Write m_write_handlers16;
   HandlerArray<u32>::Write m_write_handlers32;
 
+  u64 m_num_slow_reads = 0;
+  u64 m_num_slow_writes = 0;
+  std::array<u32, NUM_MMIOS / sizeof(u32)> m_slow_read_counts{};
+  std::array<u32, NUM_MMIOS / sizeof(u32)> m_slow_write_counts{};
+
   // Getter functions for the handler arrays.
   template <typename Unit>
   ReadHandler<Unit>& GetReadHandler(size_t index)
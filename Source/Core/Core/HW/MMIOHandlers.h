@@ -81,7 +81,9 @@ WriteHandlingMethod<T>* InvalidWrite();
 // Internally, these size conversion functions have some magic to make the
 // combined handlers as fast as possible. For example, if the two underlying
 // u16 handlers for a u32 reads are Direct to consecutive memory addresses,
-// they can be transformed into a Direct u32 access.
+// they can be transformed into a Direct u32 access. Since this is decided
+// when the combined handler is visited, the handlers being combined have to be
+// registered before the combined one.
 //
 // Warning: unlike the other handling methods, *ToSmaller are obviously not
 // available for u8, and *ToLarger are not available for u32.
@@ -10,15 +10,28 @@
 #include "Core/HW/Memmap.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemArena.h"
+#include "Common/MemoryUtil.h"
 #include "Common/Swap.h"
 #include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
 #include "Core/HW/AudioInterface.h"
 #include "Core/HW/DSP.h"
 #include "Core/HW/DVD/DVDInterface.h"
@@ -30,6 +43,7 @@
 #include "Core/HW/VideoInterface.h"
 #include "Core/HW/WII_IPC.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/JitInterface.h"
 #include "Core/PowerPC/PowerPC.h"
 #include "VideoCommon/CommandProcessor.h"
 #include "VideoCommon/PixelEngine.h"
@@ -113,8 +127,15 @@ struct LogicalMemoryView
 {
   void* mapped_pointer;
   u32 mapped_size;
+  u32 shm_position;
 };
 
+static bool operator<(const LogicalMemoryView& a, const LogicalMemoryView& b)
+{
+  return std::tie(a.mapped_pointer, a.mapped_size, a.shm_position) <
+         std::tie(b.mapped_pointer, b.mapped_size, b.shm_position);
+}
+
 // Dolphin allocates memory to represent four regions:
 // - 32MB RAM (actually 24MB on hardware), available on Gamecube and Wii
 // - 64MB "EXRAM", RAM only available on Wii
@@ -164,6 +185,52 @@ static PhysicalMemoryRegion physical_regions[] = {
 
 static std::vector<LogicalMemoryView> logical_mapped_entries;
 
+// Physical addresses of the write-protected pages, and the WriteProtectOwners that want them
+// protected. The lock also protects logical_mapped_entries and the write tracking fault counts.
+static std::mutex s_write_protection_lock;
+static std::map<u32, u32> s_write_protected_pages;
+static std::atomic<u32> s_num_write_protected_pages{0};
+static bool s_can_write_protect = false;
+
+// The fault handler runs in a signal handler, where it can't take the lock. It looks at these
+// copies instead: the owners of every page of the shared memory segment, and the physical page
+// each BAT page of the logical address space maps (or 0). Faults are recorded per page of the
+// segment, as the WriteProtectOwners the page had plus PENDING_FAULT_ON_CPU_THREAD, and handled
+// by ProcessWriteProtectionFaults.
+constexpr u8 PENDING_FAULT_ON_CPU_THREAD = 1 << 7;
+constexpr u32 NUM_BAT_PAGES = static_cast<u32>(std::tuple_size<PowerPC::BatTable>::value);
+static std::unique_ptr<std::atomic<u32>[]> s_page_owners;
+static std::unique_ptr<std::atomic<u8>[]> s_page_pending_faults;
+static std::unique_ptr<std::atomic<u32>[]> s_logical_bat_pages;
+static std::atomic<bool> s_has_pending_faults{false};
+
+// Write tracking gives up on pages after this many faults, since rehashing whatever is in them is
+// cheaper than faulting on every write.
+constexpr u8 MAX_WRITE_TRACKING_FAULTS = 16;
+// Every protected page can split the host's mappings of the views it is in, and the number of
+// mappings a process can have is limited.
+constexpr u32 MAX_WRITE_TRACKED_PAGES = 4096;
+
+// A page's stamp is set to the next value of s_write_stamp whenever it stops being protected for
+// write tracking, which is what happens when it is written. They are read without the lock.
+static bool s_can_track_writes = false;
+static std::atomic<u64> s_write_stamp{1};
+static std::unique_ptr<std::atomic<u64>[]> s_page_write_stamps;
+static std::unique_ptr<u8[]> s_page_write_faults;
+static std::atomic<u32> s_num_write_tracked_pages{0};
+
+static bool CanWriteProtectPages()
+{
+#if defined(__APPLE__) && !defined(USE_SIGACTION_ON_APPLE)
+  // The Mach exception handler only catches faults on the thread that installed it.
+  return false;
+#elif defined(_WIN32)
+  return true;
+#else
+  return sysconf(_SC_PAGESIZE) == WRITE_PROTECT_PAGE_SIZE;
+#endif
+}
+
 void Init()
 {
   bool wii = SConfig::GetInstance().bWii;
@@ -211,6 +278,34 @@ void Init()
   logical_base = physical_base + 0x200000000;
 #endif
 
+  s_can_write_protect = CanWriteProtectPages();
+  if (s_can_write_protect)
+  {
+    const u32 num_pages = mem_size / WRITE_PROTECT_PAGE_SIZE;
+    s_page_owners = std::make_unique<std::atomic<u32>[]>(num_pages);
+    s_page_pending_faults = std::make_unique<std::atomic<u8>[]>(num_pages);
+    for (u32 i = 0; i < num_pages; ++i)
+    {
+      s_page_owners[i] = 0;
+      s_page_pending_faults[i] = 0;
+    }
+    s_logical_bat_pages = std::make_unique<std::atomic<u32>[]>(NUM_BAT_PAGES);
+    for (u32 i = 0; i < NUM_BAT_PAGES; ++i)
+      s_logical_bat_pages[i] = 0;
+  }
+
+  // Write tracking needs the fault handler, which is only installed with fastmem.
+  s_can_track_writes = s_can_write_protect && SConfig::GetInstance().bFastmem;
+  if (s_can_track_writes)
+  {
+    const u32 num_pages = (RAM_SIZE + (wii ? EXRAM_SIZE : 0)) / WRITE_PROTECT_PAGE_SIZE;
+    s_page_write_stamps = std::make_unique<std::atomic<u64>[]>(num_pages);
+    for (u32 i = 0; i < num_pages; ++i)
+      s_page_write_stamps[i] = 0;
+    s_page_write_faults = std::make_unique<u8[]>(num_pages);
+    std::fill_n(s_page_write_faults.get(), num_pages, 0);
+  }
+
   if (wii)
     mmio_mapping = InitMMIOWii();
   else
@@ -222,19 +317,378 @@ void Init()
   m_IsInitialized = true;
 }
 
-void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
+static const PhysicalMemoryRegion* FindPhysicalRegion(u32 physical_address)
 {
-  for (auto& entry : logical_mapped_entries)
+  for (const PhysicalMemoryRegion& region : physical_regions)
   {
-    g_arena.ReleaseView(entry.mapped_pointer, entry.mapped_size);
+    if (*region.out_pointer && physical_address - region.physical_address < region.size)
+      return &region;
   }
-  logical_mapped_entries.clear();
+  return nullptr;
+}
+
+// Applies the protection of the page at shm_position to the part of view that maps it, if any.
+static void ApplyPageProtection(const LogicalMemoryView& view, u32 shm_position, bool protect)
+{
+  if (shm_position - view.shm_position >= view.mapped_size)
+    return;
+
+  u8* page = static_cast<u8*>(view.mapped_pointer) + (shm_position - view.shm_position);
+  if (protect)
+    Common::WriteProtectMemory(page, WRITE_PROTECT_PAGE_SIZE);
+  else
+    Common::UnWriteProtectMemory(page, WRITE_PROTECT_PAGE_SIZE);
+}
+
+static u32 GetSHMPageIndex(u32 physical_address, const PhysicalMemoryRegion& region)
+{
+  return (region.shm_position + physical_address - region.physical_address) /
+         WRITE_PROTECT_PAGE_SIZE;
+}
+
+static void SetPageProtection(u32 physical_address, const PhysicalMemoryRegion& region,
+                              bool protect)
+{
+  const u32 shm_position = region.shm_position + physical_address - region.physical_address;
+  ApplyPageProtection({physical_base + physical_address, WRITE_PROTECT_PAGE_SIZE, shm_position},
+                      shm_position, protect);
+  for (const LogicalMemoryView& entry : logical_mapped_entries)
+    ApplyPageProtection(entry, shm_position, protect);
+}
+
+// Returns the index of the page at physical_address for the write tracking arrays, or -1 if writes
+// to it aren't tracked.
+static s32 GetWriteTrackingIndex(u32 physical_address)
+{
+  if (!s_can_track_writes)
+    return -1;
+
+  if (physical_address < RAM_SIZE)
+    return static_cast<s32>(physical_address / WRITE_PROTECT_PAGE_SIZE);
+
+  if (m_pEXRAM && physical_address - 0x10000000 < EXRAM_SIZE)
+    return static_cast<s32>((RAM_SIZE + physical_address - 0x10000000) / WRITE_PROTECT_PAGE_SIZE);
+
+  return -1;
+}
+
+// The caller must hold s_write_protection_lock.
+static void AddPageProtection(u32 physical_address, const PhysicalMemoryRegion& region,
+                              WriteProtectOwner owner)
+{
+  u32& owners = s_write_protected_pages[physical_address];
+  const bool was_protected = owners != 0;
+  if (owner == WRITE_PROTECT_WRITE_TRACKING && !(owners & WRITE_PROTECT_WRITE_TRACKING))
+    ++s_num_write_tracked_pages;
+  owners |= owner;
+
+  // The fault handler has to see the owners as soon as the page faults.
+  s_page_owners[GetSHMPageIndex(physical_address, region)] = owners;
+  if (!was_protected)
+  {
+    SetPageProtection(physical_address, region, true);
+    ++s_num_write_protected_pages;
+  }
+}
+
+// Drops the protection of the given WriteProtectOwners. Returns the iterator following page.
+// The caller must hold s_write_protection_lock.
+static std::map<u32, u32>::iterator RemovePageProtection(std::map<u32, u32>::iterator page,
+                                                         u32 owners)
+{
+  owners &= page->second;
+  if (owners == 0)
+    return std::next(page);
+
+  if (owners & WRITE_PROTECT_WRITE_TRACKING)
+  {
+    // The stamp has to change before the page becomes writable, so that a reader never sees new
+    // data with the old stamp.
+    s_page_write_stamps[GetWriteTrackingIndex(page->first)] = ++s_write_stamp;
+    --s_num_write_tracked_pages;
+  }
+
+  const PhysicalMemoryRegion& region = *FindPhysicalRegion(page->first);
+  page->second &= ~owners;
+  s_page_owners[GetSHMPageIndex(page->first, region)] = page->second;
+  if (page->second != 0)
+    return std::next(page);
+
+  SetPageProtection(page->first, region, false);
+  --s_num_write_protected_pages;
+  return s_write_protected_pages.erase(page);
+}
+
+bool WriteProtectPhysicalPage(u32 physical_address, WriteProtectOwner owner)
+{
+  if (!s_can_write_protect)
+    return false;
+
+  physical_address &= ~(WRITE_PROTECT_PAGE_SIZE - 1);
+  const PhysicalMemoryRegion* region = FindPhysicalRegion(physical_address);
+  if (!region)
+    return false;
+
+  std::lock_guard<std::mutex> lk(s_write_protection_lock);
+  AddPageProtection(physical_address, *region, owner);
+  return true;
+}
+
+void UnWriteProtectPhysicalPage(u32 physical_address, WriteProtectOwner owner)
+{
+  physical_address &= ~(WRITE_PROTECT_PAGE_SIZE - 1);
+  std::lock_guard<std::mutex> lk(s_write_protection_lock);
+  const auto page = s_write_protected_pages.find(physical_address);
+  if (page != s_write_protected_pages.end())
+    RemovePageProtection(page, owner);
+}
+
+void UnWriteProtectAllPhysicalPages(WriteProtectOwner owner)
+{
+  std::lock_guard<std::mutex> lk(s_write_protection_lock);
+  for (auto page = s_write_protected_pages.begin(); page != s_write_protected_pages.end();)
+    page = RemovePageProtection(page, owner);
+}
+
+u64 TrackPhysicalWrites(u32 address, u32 size)
+{
+  // Ranges that wrap around or leave their region aren't worth handling.
+  address &= 0x3FFFFFFF;
+  if (size == 0 || size > EXRAM_SIZE)
+    return 0;
+
+  const u32 first_page = address & ~(WRITE_PROTECT_PAGE_SIZE - 1);
+  const u32 last_page = (address + size - 1) & ~(WRITE_PROTECT_PAGE_SIZE - 1);
+  const u32 num_pages = (last_page - first_page) / WRITE_PROTECT_PAGE_SIZE + 1;
+  const s32 first_index = GetWriteTrackingIndex(first_page);
+  const s32 last_index = GetWriteTrackingIndex(last_page);
+  if (first_index < 0 || last_index < 0 ||
+      static_cast<u32>(last_index - first_index + 1) != num_pages)
+  {
+    return 0;
+  }
+
+  const PhysicalMemoryRegion* region = FindPhysicalRegion(first_page);
+
+  std::lock_guard<std::mutex> lk(s_write_protection_lock);
+  u32 new_pages = 0;
+  for (s32 i = first_index; i <= last_index; ++i)
+  {
+    if (s_page_write_faults[i] >= MAX_WRITE_TRACKING_FAULTS)
+      return 0;
+
+    const u32 page_address = first_page + (i - first_index) * WRITE_PROTECT_PAGE_SIZE;
+    const auto page = s_write_protected_pages.find(page_address);
+    if (page == s_write_protected_pages.end() || !(page->second & WRITE_PROTECT_WRITE_TRACKING))
+      ++new_pages;
+  }
+  if (s_num_write_tracked_pages + new_pages > MAX_WRITE_TRACKED_PAGES)
+    return 0;
+
+  for (u32 page = first_page; page <= last_page; page += WRITE_PROTECT_PAGE_SIZE)
+    AddPageProtection(page, *region, WRITE_PROTECT_WRITE_TRACKING);
+
+  // Every page is protected now, so any write from here on gives it a newer stamp.
+  return s_write_stamp;
+}
+
+bool WasPhysicalRangeWritten(u32 address, u32 size, u64 stamp)
+{
+  address &= 0x3FFFFFFF;
+  const u32 page_mask = ~(WRITE_PROTECT_PAGE_SIZE - 1);
+  const s32 first_index = GetWriteTrackingIndex(address & page_mask);
+  const s32 last_index = GetWriteTrackingIndex((address + size - 1) & page_mask);
+  if (first_index < 0 || last_index < 0)
+    return true;
+
+  for (s32 i = first_index; i <= last_index; ++i)
+  {
+    if (s_page_write_stamps[i] > stamp)
+      return true;
+  }
+  return false;
+}
+
+void NotifyPhysicalWrite(u32 address, size_t size)
+{
+  if (s_num_write_protected_pages == 0 || size == 0)
+    return;
+
+  address &= 0x3FFFFFFF;
+  const u32 first_page = address & ~(WRITE_PROTECT_PAGE_SIZE - 1);
+  const u32 last_page = static_cast<u32>((address + size - 1) & ~(WRITE_PROTECT_PAGE_SIZE - 1));
+
+  // Every owner has to let go of the pages, since the kernel fails writes to protected pages
+  // instead of faulting. The JIT takes the lock itself to drop its protection.
+  std::vector<u32> code_pages;
+  {
+    std::lock_guard<std::mutex> lk(s_write_protection_lock);
+    auto page = s_write_protected_pages.lower_bound(first_page);
+    while (page != s_write_protected_pages.end() && page->first <= last_page)
+    {
+      if (page->second & WRITE_PROTECT_JIT_CODE)
+        code_pages.push_back(page->first);
+      page = RemovePageProtection(page, WRITE_PROTECT_WRITE_TRACKING);
+    }
+  }
+
+  for (u32 page : code_pages)
+    JitInterface::HandleCodePageWrite(page);
+}
+
+// Translates a host address in the physical view or one of the logical views to the physical
+// address it maps. Doesn't take the lock, so that the fault handler can use it.
+static const PhysicalMemoryRegion* HostAddressToPhysicalAddress(uintptr_t host_address,
+                                                                u32* physical_address)
+{
+  const uintptr_t physical_base_ptr = reinterpret_cast<uintptr_t>(physical_base);
+  const uintptr_t logical_base_ptr = reinterpret_cast<uintptr_t>(logical_base);
+  u32 address;
+  if (host_address - physical_base_ptr < 0x100000000)
+  {
+    address = static_cast<u32>(host_address - physical_base_ptr);
+  }
+  else if (s_logical_bat_pages && host_address - logical_base_ptr < 0x100000000)
+  {
+    const u32 logical_address = static_cast<u32>(host_address - logical_base_ptr);
+    const u32 bat_page = s_logical_bat_pages[logical_address >> PowerPC::BAT_INDEX_SHIFT];
+    if (bat_page == 0)
+      return nullptr;
+    address =
+        (bat_page & PowerPC::BAT_RESULT_MASK) | (logical_address & (PowerPC::BAT_PAGE_SIZE - 1));
+  }
+  else
+  {
+    return nullptr;
+  }
+
+  const PhysicalMemoryRegion* region = FindPhysicalRegion(address);
+  if (region)
+    *physical_address = address;
+  return region;
+}
+
+bool IsWriteProtectedHostAddress(uintptr_t host_address, u32* physical_address, u32* owners)
+{
+  std::lock_guard<std::mutex> lk(s_write_protection_lock);
+  if (s_write_protected_pages.empty())
+    return false;
+
+  u32 address;
+  if (!HostAddressToPhysicalAddress(host_address, &address))
+    return false;
+
+  const auto page = s_write_protected_pages.find(address & ~(WRITE_PROTECT_PAGE_SIZE - 1));
+  if (page == s_write_protected_pages.end())
+    return false;
+  *physical_address = address;
+  *owners = page->second;
+  return true;
+}
+
+bool HandleWriteProtectionFault(uintptr_t host_address)
+{
+  u32 physical_address;
+  const PhysicalMemoryRegion* region =
+      HostAddressToPhysicalAddress(host_address, &physical_address);
+  if (!region)
+    return false;
+
+  // Another thread can drop the protection between the fault and now. The page is writable then,
+  // and the write only has to be retried, since nothing else makes these views fault.
+  const u32 page_index = GetSHMPageIndex(physical_address, *region);
+  const u32 owners = s_can_write_protect ? s_page_owners[page_index].load() : 0;
+  if (owners == 0)
+    return true;
+
+  // The stamp has to change before the page becomes writable, like in RemovePageProtection.
+  if (owners & WRITE_PROTECT_WRITE_TRACKING)
+    s_page_write_stamps[GetWriteTrackingIndex(physical_address)] = ++s_write_stamp;
+
+  const bool cpu_thread = Core::IsCPUThread();
+  s_page_pending_faults[page_index] |=
+      static_cast<u8>(owners) | (cpu_thread ? PENDING_FAULT_ON_CPU_THREAD : 0);
+  s_has_pending_faults = true;
+
+  // Only the view that faulted is unprotected here. The other views keep faulting until
+  // ProcessWriteProtectionFaults drops the page's protection everywhere.
+  const uintptr_t host_page = host_address & ~static_cast<uintptr_t>(WRITE_PROTECT_PAGE_SIZE - 1);
+  Common::UnWriteProtectMemory(reinterpret_cast<void*>(host_page), WRITE_PROTECT_PAGE_SIZE);
+
+  // Make the CPU thread stop at the end of the current block, so that the code it wrote gets
+  // invalidated before anything runs it.
+  if (cpu_thread)
+    CoreTiming::ForceExceptionCheck(0);
+  return true;
+}
+
+void ProcessWriteProtectionFaults()
+{
+  // This runs on every exception check, so it only looks at the flag until something faulted.
+  if (!s_has_pending_faults.load(std::memory_order_relaxed) ||
+      !s_has_pending_faults.exchange(false))
+  {
+    return;
+  }
+
+  std::vector<u32> code_pages;
+  {
+    std::lock_guard<std::mutex> lk(s_write_protection_lock);
+    for (const PhysicalMemoryRegion& region : physical_regions)
+    {
+      if (!*region.out_pointer)
+        continue;
+
+      for (u32 offset = 0; offset < region.size; offset += WRITE_PROTECT_PAGE_SIZE)
+      {
+        const u32 physical_address = region.physical_address + offset;
+        std::atomic<u8>& pending_faults =
+            s_page_pending_faults[GetSHMPageIndex(physical_address, region)];
+        if (pending_faults.load(std::memory_order_relaxed) == 0)
+          continue;
+        const u8 pending = pending_faults.exchange(0);
+
+        if (pending & WRITE_PROTECT_WRITE_TRACKING)
+        {
+          u8& faults = s_page_write_faults[GetWriteTrackingIndex(physical_address)];
+          if (faults < MAX_WRITE_TRACKING_FAULTS)
+            ++faults;
+        }
+
+        // The JIT has to invalidate code the CPU wrote to, even if it dropped its protection in the
+        // meantime. Writes from other threads are left for icbi, see
+        // JitBaseBlockCache::HandleCodePageWrite.
+        const auto page = s_write_protected_pages.find(physical_address);
+        const u32 owners = pending | (page != s_write_protected_pages.end() ? page->second : 0);
+        if ((owners & WRITE_PROTECT_JIT_CODE) && (pending & PENDING_FAULT_ON_CPU_THREAD))
+          code_pages.push_back(physical_address);
+
+        // One of the views is writable now, so every owner that is still around has to let go.
+        if (page != s_write_protected_pages.end())
+          RemovePageProtection(page, page->second);
+      }
+    }
+  }
+
+  for (u32 page : code_pages)
+    JitInterface::HandleCodePageWrite(page);
+}
+
+void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
+{
+  std::lock_guard<std::mutex> lk(s_write_protection_lock);
+
+  // Build the list of views the new BAT mapping needs, merging adjacent BAT pages that map
+  // adjacent memory into a single view.
+  std::vector<LogicalMemoryView> new_entries;
   for (u32 i = 0; i < dbat_table.size(); ++i)
   {
+    if (s_logical_bat_pages)
+      s_logical_bat_pages[i] = (dbat_table[i] & PowerPC::BAT_PHYSICAL_BIT) ? dbat_table[i] : 0;
+
     if (dbat_table[i] & PowerPC::BAT_PHYSICAL_BIT)
     {
       u32 logical_address = i << PowerPC::BAT_INDEX_SHIFT;
-      // TODO: Merge adjacent mappings to make this faster.
       u32 logical_size = PowerPC::BAT_PAGE_SIZE;
       u32 translated_address = dbat_table[i] & PowerPC::BAT_RESULT_MASK;
       for (const auto& physical_region : physical_regions)
@@ -250,17 +704,54 @@ void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
           u8* base = logical_base + logical_address + intersection_start - translated_address;
           u32 mapped_size = intersection_end - intersection_start;
 
-          void* mapped_pointer = g_arena.CreateView(position, mapped_size, base);
-          if (!mapped_pointer)
+          if (!new_entries.empty())
           {
-            PanicAlert("MemoryMap_Setup: Failed finding a memory base.");
-            exit(0);
+            LogicalMemoryView& last = new_entries.back();
+            if (static_cast<u8*>(last.mapped_pointer) + last.mapped_size == base &&
+                last.shm_position + last.mapped_size == position)
+            {
+              last.mapped_size += mapped_size;
+              continue;
+            }
           }
-          logical_mapped_entries.push_back({mapped_pointer, mapped_size});
+          new_entries.push_back({base, mapped_size, position});
         }
       }
     }
   }
+
+  // Only touch the views that changed. Both lists are sorted by address, and a BAT write usually
+  // only affects a small part of the address space.
+  std::vector<LogicalMemoryView> stale_entries;
+  std::vector<LogicalMemoryView> added_entries;
+  std::set_difference(logical_mapped_entries.begin(), logical_mapped_entries.end(),
+                      new_entries.begin(), new_entries.end(), std::back_inserter(stale_entries));
+  std::set_difference(new_entries.begin(), new_entries.end(), logical_mapped_entries.begin(),
+                      logical_mapped_entries.end(), std::back_inserter(added_entries));
+
+  for (auto& entry : stale_entries)
+  {
+    g_arena.ReleaseView(entry.mapped_pointer, entry.mapped_size);
+  }
+  for (auto& entry : added_entries)
+  {
+    void* mapped_pointer = g_arena.CreateView(entry.shm_position, entry.mapped_size,
+                                              entry.mapped_pointer);
+    if (!mapped_pointer)
+    {
+      PanicAlert("MemoryMap_Setup: Failed finding a memory base.");
+      exit(0);
+    }
+
+    // New views start out writable.
+    for (const auto& page : s_write_protected_pages)
+    {
+      const PhysicalMemoryRegion* region = FindPhysicalRegion(page.first);
+      ApplyPageProtection(entry, region->shm_position + page.first - region->physical_address,
+                          true);
+    }
+  }
+  logical_mapped_entries = std::move(new_entries);
 }
 
 void DoState(PointerWrap& p)
@@ -297,9 +788,21 @@ void Shutdown()
     g_arena.ReleaseView(entry.mapped_pointer, entry.mapped_size);
   }
   logical_mapped_entries.clear();
+  s_write_protected_pages.clear();
+  s_num_write_protected_pages = 0;
+  s_page_owners.reset();
+  s_page_pending_faults.reset();
+  s_logical_bat_pages.reset();
+  s_has_pending_faults = false;
+  s_num_write_tracked_pages = 0;
+  s_page_write_stamps.reset();
+  s_page_write_faults.reset();
+  s_can_track_writes = false;
   g_arena.ReleaseSHMSegment();
   physical_base = nullptr;
   logical_base = nullptr;
+  if (mmio_mapping)
+    mmio_mapping->LogHottestSlowAccesses(16);
   mmio_mapping.reset();
   INFO_LOG(MEMMAP, "Memory system shut down.");
 }
@@ -355,6 +858,7 @@ void CopyToEmu(u32 address, const void* data, size_t size)
     PanicAlert("Invalid range in CopyToEmu. %zx bytes to 0x%08x", size, address);
     return;
   }
+  NotifyPhysicalWrite(address, size);
   memcpy(pointer, data, size);
 }
 
@@ -369,6 +873,7 @@ void Memset(u32 address, u8 value, size_t size)
     PanicAlert("Invalid range in Memset. %zx bytes at 0x%08x", size, address);
     return;
   }
+  NotifyPhysicalWrite(address, size);
   memset(pointer, value, size);
 }
 
@@ -66,6 +66,43 @@ void DoState(PointerWrap& p);
 
 void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table);
 
+// Write protection of physical memory pages in all of their views, so that the JIT can notice
+// writes to the code it has compiled and write tracking (below) can notice writes to memory the
+// video backend looked at. A page stays protected as long as any owner wants it to be.
+// WriteProtectPhysicalPage returns false if the page can't be protected on this host.
+constexpr u32 WRITE_PROTECT_PAGE_SIZE = 0x1000;
+enum WriteProtectOwner : u32
+{
+  WRITE_PROTECT_JIT_CODE = 1 << 0,
+  WRITE_PROTECT_WRITE_TRACKING = 1 << 1,
+};
+bool WriteProtectPhysicalPage(u32 physical_address, WriteProtectOwner owner);
+void UnWriteProtectPhysicalPage(u32 physical_address, WriteProtectOwner owner);
+void UnWriteProtectAllPhysicalPages(WriteProtectOwner owner);
+// Returns whether host_address is in a write-protected page of the physical or logical view, and
+// if so which physical address it corresponds to and which owners protected it. Safe to call from
+// any thread, but not from the fault handler.
+bool IsWriteProtectedHostAddress(uintptr_t host_address, u32* physical_address, u32* owners);
+// Called by the fault handler. Returns whether host_address is in the physical view or one of the
+// logical views of memory, which nothing but write protection makes fault. If so, the faulting
+// view of the page is made writable and the fault is recorded for ProcessWriteProtectionFaults.
+// Doesn't take locks or allocate, since it runs in a signal handler.
+bool HandleWriteProtectionFault(uintptr_t host_address);
+// Drops the protection of the pages that faulted in every view, and has the JIT invalidate the
+// code the CPU wrote to. Called on the CPU thread whenever it checks for exceptions.
+void ProcessWriteProtectionFaults();
+
+// Write tracking tells whether a range of RAM may have been written since some point, without
+// looking at its contents. TrackPhysicalWrites starts tracking a range and returns a stamp for
+// WasPhysicalRangeWritten, or 0 if the range can't be tracked (no fastmem, the host can't protect
+// its pages, or they keep being written). Writes through the CPU's views are caught by faulting
+// on the protected pages; anything that writes to RAM behind the host's back, like reading a file
+// into it, has to call NotifyPhysicalWrite first, since the kernel doesn't raise faults for it.
+// NotifyPhysicalWrite drops the JIT's protection as well, and invalidates the affected code.
+u64 TrackPhysicalWrites(u32 address, u32 size);
+bool WasPhysicalRangeWritten(u32 address, u32 size, u64 stamp);
+void NotifyPhysicalWrite(u32 address, size_t size);
+
 void Clear();
 
 // Routines to access physically addressed memory, designed for use by
@@ -440,6 +440,7 @@ void WiiSocket::Update(bool read, bool write, bool except)
           }
           case IOCTLV_NET_SSL_READ:
           {
+            Memory::NotifyPhysicalWrite(BufferIn2, BufferInSize2);
             int ret = mbedtls_ssl_read(&Device::NetSSL::_SSL[sslID].ctx,
                                        Memory::GetPointer(BufferIn2), BufferInSize2);
 
@@ -554,6 +555,7 @@ void WiiSocket::Update(bool read, bool write, bool except)
           }
 #endif
           socklen_t addrlen = sizeof(sockaddr_in);
+          Memory::NotifyPhysicalWrite(BufferOut, BufferOutSize);
           int ret = recvfrom(fd, data, data_len, flags,
                              BufferOutSize2 ? (struct sockaddr*)&local_name : nullptr,
                              BufferOutSize2 ? &addrlen : nullptr);
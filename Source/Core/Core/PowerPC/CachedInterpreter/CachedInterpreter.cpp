@@ -4,6 +4,7 @@
 
 #include "Core/PowerPC/CachedInterpreter/CachedInterpreter.h"
 
+#include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Core/ConfigManager.h"
@@ -15,34 +16,44 @@
 #include "Core/PowerPC/PPCAnalyst.h"
 #include "Core/PowerPC/PowerPC.h"
 
+// Blocks are compiled to call-threaded code: each entry holds the handler which executes it,
+// and the handler returns the entry to execute next (or nullptr to leave the block). Common
+// instructions get handlers with their operands decoded at compile time; everything else calls
+// the interpreter.
 struct CachedInterpreter::Instruction
 {
+  typedef const Instruction* (*Handler)(const Instruction* inst);
   typedef void (*CommonCallback)(UGeckoInstruction);
-  typedef bool (*ConditionalCallback)(u32 data);
 
-  Instruction() : type(INSTRUCTION_ABORT) {}
+  Instruction() : handler(Abort) {}
   Instruction(const CommonCallback c, UGeckoInstruction i)
-      : common_callback(c), data(i.hex), type(INSTRUCTION_TYPE_COMMON)
+      : handler(CallInterpreter), common_callback(c), data(i.hex)
   {
   }
 
-  Instruction(const ConditionalCallback c, u32 d)
-      : conditional_callback(c), data(d), type(INSTRUCTION_TYPE_CONDITIONAL)
+  Instruction(const Handler h, u32 d, u32 d2 = 0, u8 r0 = 0, u8 r1 = 0, u8 r2 = 0, u8 r3 = 0)
+      : handler(h), link_target(nullptr), data(d), data2(d2), reg{r0, r1, r2, r3}
   {
   }
 
+  static const Instruction* Abort(const Instruction*) { return nullptr; }
+  static const Instruction* CallInterpreter(const Instruction* inst)
+  {
+    inst->common_callback(UGeckoInstruction(inst->data));
+    return inst + 1;
+  }
+
+  Handler handler;
   union
   {
-    const CommonCallback common_callback;
-    const ConditionalCallback conditional_callback;
+    CommonCallback common_callback;
+    // For link slots: the entry of the linked block, or nullptr if the exit isn't linked.
+    const u8* link_target;
   };
-  u32 data;
-  enum
-  {
-    INSTRUCTION_ABORT,
-    INSTRUCTION_TYPE_COMMON,
-    INSTRUCTION_TYPE_CONDITIONAL,
-  } type;
+  u32 data = 0;
+  u32 data2 = 0;
+  // Pre-decoded register and CR field operands; their meaning depends on the handler.
+  u8 reg[4] = {};
 };
 
 CachedInterpreter::CachedInterpreter() : code_buffer(32000)
@@ -55,7 +66,9 @@ void CachedInterpreter::Init()
 {
   m_code.reserve(CODE_SIZE / sizeof(Instruction));
 
-  jo.enableBlocklink = false;
+  // Linked blocks run until the downcount expires, which would break single stepping.
+  jo.enableBlocklink =
+      !SConfig::GetInstance().bJITNoBlockLinking && !SConfig::GetInstance().bEnableDebugging;
 
   m_block_cache.Init();
   UpdateMemoryOptions();
@@ -85,25 +98,8 @@ void CachedInterpreter::ExecuteOneBlock()
   }
 
   const Instruction* code = reinterpret_cast<const Instruction*>(normal_entry);
-
-  for (; code->type != Instruction::INSTRUCTION_ABORT; ++code)
-  {
-    switch (code->type)
-    {
-    case Instruction::INSTRUCTION_TYPE_COMMON:
-      code->common_callback(UGeckoInstruction(code->data));
-      break;
-
-    case Instruction::INSTRUCTION_TYPE_CONDITIONAL:
-      if (code->conditional_callback(code->data))
-        return;
-      break;
-
-    default:
-      ERROR_LOG(POWERPC, "Unknown CachedInterpreter Instruction: %d", code->type);
-      break;
-    }
-  }
+  while (code)
+    code = code->handler(code);
 }
 
 void CachedInterpreter::Run()
@@ -128,49 +124,334 @@ void CachedInterpreter::SingleStep()
   ExecuteOneBlock();
 }
 
-static void EndBlock(UGeckoInstruction data)
+using Instruction = CachedInterpreter::Instruction;
+
+static const Instruction* EndBlock(const Instruction* inst)
 {
   PC = NPC;
-  PowerPC::ppcState.downcount -= data.hex;
+  PowerPC::ppcState.downcount -= inst->data;
+  return inst + 1;
 }
 
-static void WritePC(UGeckoInstruction data)
+static const Instruction* WritePC(const Instruction* inst)
 {
-  PC = data.hex;
-  NPC = data.hex + 4;
+  PC = inst->data;
+  NPC = inst->data + 4;
+  return inst + 1;
 }
 
-static void WriteBrokenBlockNPC(UGeckoInstruction data)
+static const Instruction* WriteBrokenBlockNPC(const Instruction* inst)
 {
-  NPC = data.hex;
+  NPC = inst->data;
+  return inst + 1;
 }
 
-static bool CheckFPU(u32 data)
+static const Instruction* CheckFPU(const Instruction* inst)
 {
   UReg_MSR msr{MSR};
   if (!msr.FP)
   {
     PowerPC::ppcState.Exceptions |= EXCEPTION_FPU_UNAVAILABLE;
     PowerPC::CheckExceptions();
-    PowerPC::ppcState.downcount -= data;
-    return true;
+    PowerPC::ppcState.downcount -= inst->data;
+    return nullptr;
   }
-  return false;
+  return inst + 1;
 }
 
-static bool CheckDSI(u32 data)
+static const Instruction* CheckDSI(const Instruction* inst)
 {
   if (PowerPC::ppcState.Exceptions & EXCEPTION_DSI)
   {
     PowerPC::CheckExceptions();
-    PowerPC::ppcState.downcount -= data;
-    return true;
+    PowerPC::ppcState.downcount -= inst->data;
+    return nullptr;
   }
-  return false;
+  return inst + 1;
+}
+
+// Continues in the linked block if the dispatcher would pick it: the block exited to
+// exit_address (data) under the same address translation (data2), and the timeslice isn't over.
+static const Instruction* LinkSlot(const Instruction* inst)
+{
+  if (inst->link_target && PC == inst->data &&
+      (MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK) == inst->data2 &&
+      PowerPC::ppcState.downcount > 0)
+  {
+    return reinterpret_cast<const Instruction*>(inst->link_target);
+  }
+  return inst + 1;
+}
+
+// The specialized handlers below match the interpreter's implementations exactly.
+
+template <typename T>
+static void CompareToCRField(u32 field, T a, T b)
+{
+  int f;
+  if (a < b)
+    f = 0x8;
+  else if (a > b)
+    f = 0x4;
+  else
+    f = 0x2;  // equals
+
+  if (GetXER_SO())
+    f |= 0x1;
+
+  SetCRField(field, f);
+}
+
+// li, lis: rD = imm
+static const Instruction* LoadImmediate(const Instruction* inst)
+{
+  rGPR[inst->reg[0]] = inst->data;
+  return inst + 1;
+}
+
+// addi, addis: rD = rA + imm
+static const Instruction* AddImmediate(const Instruction* inst)
+{
+  rGPR[inst->reg[0]] = rGPR[inst->reg[1]] + inst->data;
+  return inst + 1;
+}
+
+// ori, oris: rA = rS | imm
+static const Instruction* OrImmediate(const Instruction* inst)
+{
+  rGPR[inst->reg[0]] = rGPR[inst->reg[1]] | inst->data;
+  return inst + 1;
+}
+
+// rlwinm without Rc: rA = rotl(rS, SH) & mask
+static const Instruction* RotateAndMask(const Instruction* inst)
+{
+  rGPR[inst->reg[0]] = _rotl(rGPR[inst->reg[1]], inst->data2) & inst->data;
+  return inst + 1;
+}
+
+// add: rD = rA + rB
+static const Instruction* AddRegisters(const Instruction* inst)
+{
+  rGPR[inst->reg[0]] = rGPR[inst->reg[1]] + rGPR[inst->reg[2]];
+  return inst + 1;
+}
+
+// subf: rD = rB - rA
+static const Instruction* SubtractFromRegisters(const Instruction* inst)
+{
+  rGPR[inst->reg[0]] = rGPR[inst->reg[2]] - rGPR[inst->reg[1]];
+  return inst + 1;
+}
+
+// or, mr: rA = rS | rB
+static const Instruction* OrRegisters(const Instruction* inst)
+{
+  rGPR[inst->reg[0]] = rGPR[inst->reg[1]] | rGPR[inst->reg[2]];
+  return inst + 1;
+}
+
+// cmpi, cmpli: crfD = compare(rA, imm)
+template <typename T>
+static const Instruction* CompareImmediate(const Instruction* inst)
+{
+  CompareToCRField<T>(inst->reg[0], rGPR[inst->reg[1]], inst->data);
+  return inst + 1;
+}
+
+// cmp, cmpl: crfD = compare(rA, rB)
+template <typename T>
+static const Instruction* CompareRegisters(const Instruction* inst)
+{
+  CompareToCRField<T>(inst->reg[0], rGPR[inst->reg[1]], rGPR[inst->reg[2]]);
+  return inst + 1;
+}
+
+// lwz, lhz, lbz with rA != 0: rD = MEM(rA + offset)
+template <typename T, T (*read)(u32)>
+static const Instruction* LoadZero(const Instruction* inst)
+{
+  u32 value = read(rGPR[inst->reg[1]] + inst->data);
+  if (!(PowerPC::ppcState.Exceptions & EXCEPTION_DSI))
+    rGPR[inst->reg[0]] = value;
+  return inst + 1;
+}
+
+// stw, sth, stb with rA != 0: MEM(rA + offset) = rS
+template <typename T, void (*write)(T, u32)>
+static const Instruction* Store(const Instruction* inst)
+{
+  write(static_cast<T>(rGPR[inst->reg[0]]), rGPR[inst->reg[1]] + inst->data);
+  return inst + 1;
+}
+
+// lwz rD, offset(rA); cmpwi/cmplwi crfD, rD, imm
+template <typename T>
+static const Instruction* LoadWordAndCompare(const Instruction* inst)
+{
+  u32 value = PowerPC::Read_U32(rGPR[inst->reg[1]] + inst->data);
+  if (!(PowerPC::ppcState.Exceptions & EXCEPTION_DSI))
+    rGPR[inst->reg[0]] = value;
+  CompareToCRField<T>(inst->reg[2], rGPR[inst->reg[0]], inst->data2);
+  return inst + 1;
+}
+
+// addi/addis rD, rA, imm (li/lis if add is false); stw rS, offset(rB)
+template <bool add>
+static const Instruction* AddAndStoreWord(const Instruction* inst)
+{
+  rGPR[inst->reg[0]] = add ? rGPR[inst->reg[1]] + inst->data : inst->data;
+  PowerPC::Write_U32(rGPR[inst->reg[2]], rGPR[inst->reg[3]] + inst->data2);
+  return inst + 1;
+}
+
+bool CachedInterpreter::CanFuseWithNext(const PPCAnalyst::CodeOp* ops, u32 i) const
+{
+  // Nothing may have to run between the two instructions; see Jit().
+  if (i + 1 >= code_block.m_num_instructions || jo.memcheck)
+    return false;
+
+  const PPCAnalyst::CodeOp& next = ops[i + 1];
+  return !next.skip && !(next.opinfo->flags & (FL_ENDBLOCK | FL_USE_FPU)) &&
+         HLE::GetFirstFunctionIndex(next.address) == 0;
+}
+
+u32 CachedInterpreter::EmitSpecializedOp(const PPCAnalyst::CodeOp* ops, u32 i)
+{
+  const UGeckoInstruction inst = ops[i].inst;
+  const UGeckoInstruction next = CanFuseWithNext(ops, i) ? ops[i + 1].inst : UGeckoInstruction(0);
+
+  switch (inst.OPCD)
+  {
+  case 14:  // addi
+  case 15:  // addis
+  {
+    const u32 imm = inst.OPCD == 14 ? (u32)(s32)inst.SIMM_16 : (u32)(s32)inst.SIMM_16 << 16;
+    if (next.OPCD == 36 && next.RA != 0)
+    {
+      m_code.emplace_back(inst.RA ? AddAndStoreWord<true> : AddAndStoreWord<false>, imm,
+                          (u32)(s32)next.SIMM_16, inst.RD, inst.RA, next.RS, next.RA);
+      return 2;
+    }
+    if (inst.RA)
+      m_code.emplace_back(AddImmediate, imm, 0, inst.RD, inst.RA);
+    else
+      m_code.emplace_back(LoadImmediate, imm, 0, inst.RD);
+    return 1;
+  }
+
+  case 24:  // ori
+  case 25:  // oris
+  {
+    const u32 imm = inst.OPCD == 24 ? inst.UIMM : inst.UIMM << 16;
+    // ori 0, 0, 0 is the canonical nop.
+    if (imm != 0 || inst.RA != inst.RS)
+      m_code.emplace_back(OrImmediate, imm, 0, inst.RA, inst.RS);
+    return 1;
+  }
+
+  case 21:  // rlwinmx
+    if (inst.Rc)
+      return 0;
+    m_code.emplace_back(RotateAndMask, Helper_Mask(inst.MB, inst.ME), inst.SH, inst.RA, inst.RS);
+    return 1;
+
+  case 11:  // cmpi
+    m_code.emplace_back(CompareImmediate<s32>, (u32)(s32)inst.SIMM_16, 0, inst.CRFD, inst.RA);
+    return 1;
+
+  case 10:  // cmpli
+    m_code.emplace_back(CompareImmediate<u32>, inst.UIMM, 0, inst.CRFD, inst.RA);
+    return 1;
+
+  case 32:  // lwz
+    if (inst.RA == 0)
+      return 0;
+    if ((next.OPCD == 11 || next.OPCD == 10) && next.RA == inst.RD)
+    {
+      const bool logical = next.OPCD == 10;
+      m_code.emplace_back(logical ? LoadWordAndCompare<u32> : LoadWordAndCompare<s32>,
+                          (u32)(s32)inst.SIMM_16, logical ? next.UIMM : (u32)(s32)next.SIMM_16,
+                          inst.RD, inst.RA, next.CRFD);
+      return 2;
+    }
+    m_code.emplace_back(LoadZero<u32, PowerPC::Read_U32>, (u32)(s32)inst.SIMM_16, 0, inst.RD,
+                        inst.RA);
+    return 1;
+
+  case 40:  // lhz
+  case 34:  // lbz
+    if (inst.RA == 0)
+      return 0;
+    m_code.emplace_back(inst.OPCD == 40 ? LoadZero<u16, PowerPC::Read_U16> :
+                                          LoadZero<u8, PowerPC::Read_U8>,
+                        (u32)(s32)inst.SIMM_16, 0, inst.RD, inst.RA);
+    return 1;
+
+  case 36:  // stw
+  case 44:  // sth
+  case 38:  // stb
+    if (inst.RA == 0)
+      return 0;
+    m_code.emplace_back(inst.OPCD == 36 ? Store<u32, PowerPC::Write_U32> :
+                                          inst.OPCD == 44 ? Store<u16, PowerPC::Write_U16> :
+                                                            Store<u8, PowerPC::Write_U8>,
+                        (u32)(s32)inst.SIMM_16, 0, inst.RS, inst.RA);
+    return 1;
+
+  case 31:
+    // The OE forms have their own SUBOP10 values, so only Rc needs checking.
+    if (inst.Rc)
+      return 0;
+    switch (inst.SUBOP10)
+    {
+    case 266:  // addx
+      m_code.emplace_back(AddRegisters, 0, 0, inst.RD, inst.RA, inst.RB);
+      return 1;
+    case 40:  // subfx
+      m_code.emplace_back(SubtractFromRegisters, 0, 0, inst.RD, inst.RA, inst.RB);
+      return 1;
+    case 444:  // orx
+      m_code.emplace_back(OrRegisters, 0, 0, inst.RA, inst.RS, inst.RB);
+      return 1;
+    case 0:  // cmp
+      m_code.emplace_back(CompareRegisters<s32>, 0, 0, inst.CRFD, inst.RA, inst.RB);
+      return 1;
+    case 32:  // cmpl
+      m_code.emplace_back(CompareRegisters<u32>, 0, 0, inst.CRFD, inst.RA, inst.RB);
+      return 1;
+    }
+    return 0;
+  }
+
+  return 0;
+}
+
+void CachedInterpreter::WriteExitToDispatcher(const u8* code)
+{
+  // Blocks are only entered with PC at their start, which is where the dispatcher continues.
+  *const_cast<Instruction*>(reinterpret_cast<const Instruction*>(code)) = Instruction();
+}
+
+void CachedInterpreter::EmitLinkSlot(JitBlock* b, u32 exit_address, bool call)
+{
+  m_code.emplace_back(LinkSlot, exit_address, b->msrBits);
+
+  JitBlock::LinkData link_data;
+  // m_code never reallocates (see Jit()), so this stays valid for the lifetime of the block.
+  link_data.exitPtrs = reinterpret_cast<u8*>(&m_code.back().link_target);
+  link_data.exitAddress = exit_address;
+  link_data.linkStatus = false;
+  link_data.call = call;
+  b->linkData.push_back(link_data);
 }
 
 void CachedInterpreter::Jit(u32 address)
 {
+  // The block we were asked for may be among the ones compiled ahead of time.
+  if (m_block_cache.WarmUp() && m_block_cache.GetBlockFromStartAddress(PC, MSR))
+    return;
+
   if (m_code.size() >= CODE_SIZE / sizeof(Instruction) - 0x1000 ||
       SConfig::GetInstance().bJITNoBlockCache)
   {
@@ -180,6 +461,9 @@ void CachedInterpreter::Jit(u32 address)
   u32 nextPC = analyzer.Analyze(PC, &code_block, &code_buffer, code_buffer.GetSize());
   if (code_block.m_memory_exception)
   {
+    if (m_block_cache.IsWarmingUp())
+      return;
+
     // Address of instruction could not be translated
     NPC = nextPC;
     PowerPC::ppcState.Exceptions |= EXCEPTION_ISI;
@@ -201,6 +485,7 @@ void CachedInterpreter::Jit(u32 address)
   b->checkedEntry = GetCodePtr();
   b->normalEntry = GetCodePtr();
 
+  bool replaced_by_hle = false;
   for (u32 i = 0; i < code_block.m_num_instructions; i++)
   {
     js.downcountAmount += ops[i].opinfo->numCycles;
@@ -220,6 +505,7 @@ void CachedInterpreter::Jit(u32 address)
           {
             m_code.emplace_back(EndBlock, js.downcountAmount);
             m_code.emplace_back();
+            replaced_by_hle = true;
             break;
           }
         }
@@ -241,11 +527,17 @@ void CachedInterpreter::Jit(u32 address)
 
       if (endblock || memcheck)
         m_code.emplace_back(WritePC, ops[i].address);
-      m_code.emplace_back(GetInterpreterOp(ops[i].inst), ops[i].inst);
+      u32 num_handled = EmitSpecializedOp(ops, i);
+      if (num_handled == 0)
+        m_code.emplace_back(GetInterpreterOp(ops[i].inst), ops[i].inst);
       if (memcheck)
         m_code.emplace_back(CheckDSI, js.downcountAmount);
       if (endblock)
         m_code.emplace_back(EndBlock, js.downcountAmount);
+
+      // Fused instructions never need a check of their own (see CanFuseWithNext).
+      for (; num_handled > 1; num_handled--)
+        js.downcountAmount += ops[++i].opinfo->numCycles;
     }
   }
   if (code_block.m_broken)
@@ -253,6 +545,34 @@ void CachedInterpreter::Jit(u32 address)
     m_code.emplace_back(WriteBrokenBlockNPC, nextPC);
     m_code.emplace_back(EndBlock, js.downcountAmount);
   }
+
+  // Exits to an address known at compile time get a link slot each.
+  if (jo.enableBlocklink && !replaced_by_hle && code_block.m_num_instructions > 0)
+  {
+    const PPCAnalyst::CodeOp& last = ops[code_block.m_num_instructions - 1];
+    const UGeckoInstruction inst = last.inst;
+    if (code_block.m_broken)
+    {
+      EmitLinkSlot(b, nextPC, false);
+    }
+    else if (!last.skip && inst.OPCD == 18)  // bx
+    {
+      const u32 offset = SignExt26(inst.LI << 2);
+      EmitLinkSlot(b, inst.AA ? offset : last.address + offset, inst.LK);
+    }
+    else if (!last.skip && inst.OPCD == 16)  // bcx
+    {
+      const u32 offset = SignExt16(inst.BD << 2);
+      EmitLinkSlot(b, inst.AA ? offset : last.address + offset, inst.LK);
+      EmitLinkSlot(b, last.address + 4, false);
+    }
+    else if (!last.skip && inst.OPCD == 19 && (inst.SUBOP10 == 16 || inst.SUBOP10 == 528) &&
+             (inst.BO & 0x14) != 0x14)
+    {
+      // The fall-through of a conditional bclrx/bcctrx.
+      EmitLinkSlot(b, last.address + 4, false);
+    }
+  }
   m_code.emplace_back();
 
   b->codeSize = (u32)(GetCodePtr() - b->checkedEntry);
@@ -263,7 +583,8 @@ void CachedInterpreter::Jit(u32 address)
 
 void CachedInterpreter::ClearCache()
 {
-  m_code.clear();
+  // Unlinking the blocks writes to their link slots, so this has to happen before m_code is cleared.
   m_block_cache.Clear();
+  m_code.clear();
   UpdateMemoryOptions();
 }
@@ -31,12 +31,23 @@ public:
   JitBaseBlockCache* GetBlockCache() override { return &m_block_cache; }
   const char* GetName() override { return "Cached Interpreter"; }
   const CommonAsmRoutinesBase* GetAsmRoutines() override { return nullptr; }
-private:
+  // An entry of the threaded code blocks are compiled to.
   struct Instruction;
 
+  // Makes the entry at code return to the dispatcher, so that stale jumps into a destroyed block
+  // don't run it.
+  static void WriteExitToDispatcher(const u8* code);
+
+private:
   const u8* GetCodePtr() const;
   void ExecuteOneBlock();
 
+  // Emits a pre-decoded entry for ops[i], possibly fused with ops[i + 1]. Returns the number of
+  // instructions handled, or 0 if the instruction has to go through the interpreter.
+  u32 EmitSpecializedOp(const PPCAnalyst::CodeOp* ops, u32 i);
+  bool CanFuseWithNext(const PPCAnalyst::CodeOp* ops, u32 i) const;
+  void EmitLinkSlot(JitBlock* b, u32 exit_address, bool call);
+
   BlockCache m_block_cache{*this};
   std::vector<Instruction> m_code;
   PPCAnalyst::CodeBuffer code_buffer;
@@ -4,6 +4,7 @@
 
 #include "Core/PowerPC/CachedInterpreter/InterpreterBlockCache.h"
 
+#include "Core/PowerPC/CachedInterpreter/CachedInterpreter.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
 
 BlockCache::BlockCache(JitBase& jit) : JitBaseBlockCache{jit}
@@ -12,4 +13,12 @@ BlockCache::BlockCache(JitBase& jit) : JitBaseBlockCache{jit}
 
 void BlockCache::WriteLinkBlock(const JitBlock::LinkData& source, const JitBlock* dest)
 {
+  // exitPtrs points at the target of the exit's link slot; see CachedInterpreter::EmitLinkSlot.
+  *reinterpret_cast<const u8**>(source.exitPtrs) = dest ? dest->normalEntry : nullptr;
+}
+
+void BlockCache::WriteDestroyBlock(const JitBlock& block)
+{
+  // Only clear the entry point as we might still be within this block.
+  CachedInterpreter::WriteExitToDispatcher(block.normalEntry);
 }
@@ -810,5 +810,8 @@ void Interpreter::tlbie(UGeckoInstruction inst)
 
 void Interpreter::tlbsync(UGeckoInstruction inst)
 {
-  // MessageBox(0,"TLBsync","TLBsyncE",0);
+  // tlbie only drops the congruence class of its address from the fast TLB. Software that edits
+  // the page table and then invalidates with a different address still sees its changes after
+  // the tlbsync that completes the sequence.
+  PowerPC::InvalidateFastTLB();
 }
@@ -4,6 +4,7 @@
 
 #include "Core/PowerPC/Jit64/Jit.h"
 
+#include <cinttypes>
 #include <map>
 #include <string>
 
@@ -14,6 +15,7 @@
 
 #include "Common/CommonTypes.h"
 #include "Common/File.h"
+#include "Common/JitRegister.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemoryUtil.h"
 #include "Common/PerformanceCounter.h"
@@ -251,15 +253,45 @@ void Jit64::Init()
   m_far_code.Init();
   Clear();
 
+  m_recycle_code_regions = SConfig::GetInstance().bJITRecycleCodeRegions;
+  const size_t num_regions = m_recycle_code_regions ? NUM_CODE_REGIONS : 1;
+  SetNumRegions(num_regions);
+  m_far_code.SetNumRegions(num_regions);
+  trampolines.SetNumRegions(num_regions);
+  m_num_regions_recycled = 0;
+  m_num_blocks_recycled = 0;
+  m_num_flushes_avoided = 0;
+
   code_block.m_stats = &js.st;
   code_block.m_gpa = &js.gpa;
   code_block.m_fpa = &js.fpa;
+
+  m_enable_register_passing = SConfig::GetInstance().bJITRegisterPassing &&
+                              !SConfig::GetInstance().bEnableDebugging;
+  m_entry_layouts.clear();
+  m_num_blocks_compiled = 0;
+  m_num_entry_layouts = 0;
+  m_num_register_passing_exits = 0;
+  m_enable_idle_loop_detection = SConfig::GetInstance().bJITIdleLoopDetection &&
+                                 !SConfig::GetInstance().bEnableDebugging;
+  m_num_idle_loops = 0;
+
+  m_num_dead_flags_eliminated = 0;
+  m_num_gqr_speculations = 0;
+  m_num_gqr_guard_failures = 0;
+  m_trace_profile.Init();
+  analyzer.SetBranchPredictor([this](u32 address) {
+    return m_trace_profile.IsBranchLikelyTaken(address) || m_tiering.IsBranchLikelyTaken(address);
+  });
   EnableOptimization();
+  m_tiering.Init(analyzer, blocks);
 }
 
 void Jit64::ClearCache()
 {
   blocks.Clear();
+  m_tiering.ClearBlocks();
+  m_entry_layouts.clear();
   trampolines.ClearCodeSpace();
   m_far_code.ClearCodeSpace();
   m_const_pool.Clear();
@@ -268,12 +300,83 @@ void Jit64::ClearCache()
   UpdateMemoryOptions();
 }
 
+void Jit64::OnBlockDestroyed(const JitBlock& block)
+{
+  m_tiering.DestroyBlock(block);
+  // Exits compiled from now on go through checkedEntry until the address is compiled again.
+  m_entry_layouts.erase(block.effectiveAddress);
+}
+
+void Jit64::MakeCodeSpace()
+{
+  if (!m_recycle_code_regions)
+  {
+    if (IsAlmostFull() || m_far_code.IsAlmostFull() || trampolines.IsAlmostFull())
+      ClearCache();
+    return;
+  }
+
+  // This is only called from the dispatcher, which has reset the stack, so no return address
+  // of the BLR optimization can point into the code being recycled.
+  if (IsAlmostFull() || m_far_code.IsAlmostFull())
+  {
+    const size_t next_region = (GetCurrentRegion() + 1) % GetNumRegions();
+    RecycleCodeRegion(next_region);
+    SwitchToRegion(next_region);
+    m_far_code.SwitchToRegion(next_region);
+    ++m_num_flushes_avoided;
+  }
+
+  // Trampolines are added to the region of the code they patch long after it was compiled.
+  for (size_t region = 0; region < trampolines.GetNumRegions(); ++region)
+  {
+    if (trampolines.GetRegionSpaceLeft(region) < 0x10000)
+    {
+      RecycleCodeRegion(region);
+      ++m_num_flushes_avoided;
+    }
+  }
+}
+
+void Jit64::RecycleCodeRegion(size_t region)
+{
+  m_num_blocks_recycled += blocks.EraseCodeRange(GetRegionStart(region), GetRegionEnd(region));
+  ClearCodeRegion(region);
+
+  ResetRegion(region);
+  m_far_code.ResetRegion(region);
+  trampolines.ResetRegion(region);
+  ++m_num_regions_recycled;
+}
+
 void Jit64::Shutdown()
 {
   FreeStack();
   FreeCodeSpace();
 
+  INFO_LOG(DYNA_REC, "%" PRIu64 " dead CR/CA computations eliminated",
+           m_num_dead_flags_eliminated);
+  INFO_LOG(DYNA_REC, "%" PRIu64 " blocks speculated on GQR values, %" PRIu64 " guards failed",
+           m_num_gqr_speculations, m_num_gqr_guard_failures);
+  if (m_enable_idle_loop_detection)
+    INFO_LOG(DYNA_REC, "%" PRIu64 " idle loops detected", m_num_idle_loops);
+  if (m_enable_register_passing)
+  {
+    INFO_LOG(DYNA_REC,
+             "Register passing: %" PRIu64 " of %" PRIu64 " blocks have an entry layout, %" PRIu64
+             " exits set it up",
+             m_num_entry_layouts, m_num_blocks_compiled, m_num_register_passing_exits);
+  }
+  if (m_recycle_code_regions)
+  {
+    INFO_LOG(DYNA_REC,
+             "Code space: %" PRIu64 " regions recycled (%" PRIu64 " blocks), %" PRIu64
+             " full cache flushes avoided",
+             m_num_regions_recycled, m_num_blocks_recycled, m_num_flushes_avoided);
+  }
   blocks.Shutdown();
+  m_tiering.Shutdown();
+  m_trace_profile.Shutdown();
   m_far_code.Shutdown();
   m_const_pool.Shutdown();
 }
@@ -411,6 +514,126 @@ void Jit64::FakeBLCall(u32 after)
   SetJumpTarget(skip_exit);
 }
 
+void Jit64::WriteBranchCounter(const PPCAnalyst::CodeOp& op, bool taken)
+{
+  if (!analyzer.HasOption(PPCAnalyst::PPCAnalyzer::OPTION_HOT_BRANCH_FOLLOW) ||
+      op.branchIsFollowed || !JitTraceProfile::IsTraceableBranch(op.inst))
+  {
+    return;
+  }
+
+  JitTraceProfile::Edge* edge = m_trace_profile.GetEdge(op.address);
+  MOV(64, R(RSCRATCH), ImmPtr(taken ? &edge->taken : &edge->not_taken));
+  // Increment with LEA to leave the flags alone; they may still hold XER.CA for the next
+  // instruction.
+  MOV(32, R(RSCRATCH2), MatR(RSCRATCH));
+  LEA(32, RSCRATCH2, MDisp(RSCRATCH2, 1));
+  MOV(32, MatR(RSCRATCH), R(RSCRATCH2));
+  if (!taken)
+    return;
+
+  // The taken path is about to leave the block, so registers have been flushed already.
+  TEST(32, R(RSCRATCH2), Imm32(JitTraceProfile::RETRACE_INTERVAL - 1));
+  FixupBranch skip = J_CC(CC_NZ);
+  ABI_PushRegistersAndAdjustStack({}, 0);
+  ABI_CallFunctionPC(JitTraceProfile::OnTakenBranch, &m_trace_profile, op.address);
+  ABI_PopRegistersAndAdjustStack({}, 0);
+  SetJumpTarget(skip);
+}
+
+// An entry layout lists up to MAX_ENTRY_REGISTERS (guest GPR, host register) pairs, packed
+// into 9 bits each, with the number of pairs in the top bits. Zero means there is no layout.
+constexpr u32 MAX_ENTRY_REGISTERS = 4;
+
+static u32 EntryLayoutSize(u64 layout)
+{
+  return static_cast<u32>(layout >> 60);
+}
+
+static size_t EntryLayoutGuestReg(u64 layout, u32 i)
+{
+  return (layout >> (i * 9)) & 31;
+}
+
+static X64Reg EntryLayoutHostReg(u64 layout, u32 i)
+{
+  return static_cast<X64Reg>((layout >> (i * 9 + 5)) & 15);
+}
+
+static u64 AddToEntryLayout(u64 layout, size_t preg, X64Reg xreg)
+{
+  const u32 size = EntryLayoutSize(layout);
+  layout &= (1ULL << 60) - 1;
+  layout |= static_cast<u64>(preg | (xreg << 5)) << (size * 9);
+  return layout | static_cast<u64>(size + 1) << 60;
+}
+
+u64 Jit64::BindEntryRegisters(const PPCAnalyst::CodeOp& first_op)
+{
+  // Block inputs that are going to be needed in a register anyway, most used first.
+  BitSet32 candidates = code_block.m_gpr_inputs & (first_op.gprInReg | first_op.regsIn);
+  u64 layout = 0;
+  for (u32 n = 0; n < MAX_ENTRY_REGISTERS && candidates; ++n)
+  {
+    int best = -1;
+    for (int reg : candidates)
+    {
+      if (best < 0 || js.gpa.numReads[reg] > js.gpa.numReads[best])
+        best = reg;
+    }
+    candidates[best] = false;
+
+    gpr.BindToRegister(best, false, false);
+    layout = AddToEntryLayout(layout, best, gpr.RX(best));
+  }
+  return layout;
+}
+
+void Jit64::WriteEntryLoads(u64 layout)
+{
+  for (u32 i = 0; i < EntryLayoutSize(layout); ++i)
+    MOV(32, R(EntryLayoutHostReg(layout, i)), PPCSTATE(gpr[EntryLayoutGuestReg(layout, i)]));
+}
+
+u64 Jit64::WriteEntryRegisters(u32 destination)
+{
+  if (!m_enable_register_passing || !jo.enableBlocklink)
+    return 0;
+
+  const auto it = m_entry_layouts.find(destination);
+  if (it == m_entry_layouts.end() || !it->second)
+    return 0;
+
+  // The registers have been flushed, so ppcState is up to date; this only saves the
+  // destination from reloading them. Values still in a host register are reused when that
+  // register is callee-saved, since the exit path may have called out (Cleanup, for example).
+  const u64 layout = it->second;
+  ++m_num_register_passing_exits;
+  BitSet32 written;
+  for (u32 i = 0; i < EntryLayoutSize(layout); ++i)
+  {
+    const size_t preg = EntryLayoutGuestReg(layout, i);
+    const X64Reg xreg = EntryLayoutHostReg(layout, i);
+    const OpArg& location = gpr.R(preg);
+    if (location.IsImm())
+    {
+      MOV(32, R(xreg), location);
+    }
+    else if (location.IsSimpleReg() && !ABI_ALL_CALLER_SAVED[location.GetSimpleReg()] &&
+             !written[location.GetSimpleReg()])
+    {
+      if (location.GetSimpleReg() != xreg)
+        MOV(32, R(xreg), location);
+    }
+    else
+    {
+      MOV(32, R(xreg), PPCSTATE(gpr[preg]));
+    }
+    written[xreg] = true;
+  }
+  return layout;
+}
+
 void Jit64::WriteExit(u32 destination, bool bl, u32 after)
 {
   if (!m_enable_blr_optimization)
@@ -426,16 +649,19 @@ void Jit64::WriteExit(u32 destination, bool bl, u32 after)
 
   SUB(32, PPCSTATE(downcount), Imm32(js.downcountAmount));
 
-  JustWriteExit(destination, bl, after);
+  // Moves don't touch the flags, which the destination checks for the downcount.
+  const u64 entry_layout = WriteEntryRegisters(destination);
+  JustWriteExit(destination, bl, after, entry_layout);
 }
 
-void Jit64::JustWriteExit(u32 destination, bool bl, u32 after)
+void Jit64::JustWriteExit(u32 destination, bool bl, u32 after, u64 entry_layout)
 {
   // If nobody has taken care of this yet (this can be removed when all branches are done)
   JitBlock* b = js.curBlock;
   JitBlock::LinkData linkData;
   linkData.exitAddress = destination;
   linkData.linkStatus = false;
+  linkData.entry_layout = entry_layout;
 
   MOV(32, PPCSTATE(pc), Imm32(destination));
   linkData.exitPtrs = GetWritableCodePtr();
@@ -521,6 +747,32 @@ void Jit64::WriteExceptionExit()
   JMP(asm_routines.dispatcher, true);
 }
 
+void Jit64::WriteIdleExit(u32 destination)
+{
+  ABI_PushRegistersAndAdjustStack({}, 0);
+  ABI_CallFunction(CoreTiming::Idle);
+  ABI_PopRegistersAndAdjustStack({}, 0);
+  MOV(32, PPCSTATE(pc), Imm32(destination));
+  WriteExceptionExit();
+}
+
+// The analyzer only knows the addresses of the loads in an idle loop, not what is mapped there.
+// An MMIO read can have side effects, and what it returns can change without a CoreTiming
+// event, so only loops which read nothing but RAM are skipped.
+bool Jit64::IsIdleLoopBranch(const PPCAnalyst::CodeOp& op) const
+{
+  if (!op.branchIsIdleLoop)
+    return false;
+
+  // The loop starts at the start of the block. It only contains integer loads of up to a word.
+  for (const PPCAnalyst::CodeOp* i = code_buffer.codebuffer; i != &op; ++i)
+  {
+    if (i->opinfo->type == OPTYPE_LOAD && !IsKnownRAMAccess(*i, 32))
+      return false;
+  }
+  return true;
+}
+
 void Jit64::WriteExternalExceptionExit()
 {
   Cleanup();
@@ -581,10 +833,24 @@ void Jit64::Jit(u32 em_address)
 #endif
   }
 
-  if (IsAlmostFull() || m_far_code.IsAlmostFull() || trampolines.IsAlmostFull() ||
-      SConfig::GetInstance().bJITNoBlockCache)
-  {
+  // The block we were asked for may be among the ones compiled ahead of time.
+  if (blocks.WarmUp() && blocks.GetBlockFromStartAddress(em_address, MSR))
+    return;
+
+  if (SConfig::GetInstance().bJITNoBlockCache)
     ClearCache();
+  else
+    MakeCodeSpace();
+
+  // We came here from the dispatcher, so no tier-0 block is running.
+  m_tiering.FreeDestroyedBlocks();
+
+  // Cold code runs through the interpreter until it has shown that it is worth compiling.
+  if (m_tiering.IsEnabled() && !m_tiering.IsHot(em_address) &&
+      !SConfig::GetInstance().bEnableDebugging && !Profiler::g_ProfileBlocks)
+  {
+    JitTier0(em_address);
+    return;
   }
 
   int blockSize = code_buffer.GetSize();
@@ -609,6 +875,7 @@ void Jit64::Jit(u32 em_address)
         analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_CROR_MERGE);
         analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_CARRY_MERGE);
         analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_BRANCH_FOLLOW);
+        analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_HOT_BRANCH_FOLLOW);
       }
       Trace();
     }
@@ -617,10 +884,19 @@ void Jit64::Jit(u32 em_address)
   // Analyze the block, collect all instructions it is made of (including inlining,
   // if that is enabled), reorder instructions for optimal performance, and join joinable
   // instructions.
-  u32 nextPC = analyzer.Analyze(em_address, &code_block, &code_buffer, blockSize);
+  // Blocks promoted from tier 0 may already have been analyzed on the worker thread.
+  u32 nextPC;
+  if (SConfig::GetInstance().bEnableDebugging ||
+      !m_tiering.TakeAnalysis(em_address, &code_block, &code_buffer, &nextPC))
+  {
+    nextPC = analyzer.Analyze(em_address, &code_block, &code_buffer, blockSize);
+  }
 
   if (code_block.m_memory_exception)
   {
+    if (blocks.IsWarmingUp())
+      return;
+
     // Address of instruction could not be translated
     NPC = nextPC;
     PowerPC::ppcState.Exceptions |= EXCEPTION_ISI;
@@ -634,6 +910,52 @@ void Jit64::Jit(u32 em_address)
   blocks.FinalizeBlock(*b, jo.enableBlocklink, code_block.m_physical_addresses);
 }
 
+void Jit64::JitTier0(u32 em_address)
+{
+  u32 nextPC = m_tiering.GetAnalyzer().Analyze(em_address, &code_block, &code_buffer,
+                                                code_buffer.GetSize());
+
+  if (code_block.m_memory_exception)
+  {
+    if (blocks.IsWarmingUp())
+      return;
+
+    // Address of instruction could not be translated
+    NPC = nextPC;
+    PowerPC::ppcState.Exceptions |= EXCEPTION_ISI;
+    PowerPC::CheckExceptions();
+    WARN_LOG(POWERPC, "ISI exception at 0x%08x", nextPC);
+    return;
+  }
+
+  JitBlock* b = blocks.AllocateBlock(em_address);
+  const JitTiering::Block* tier0_block =
+      m_tiering.Translate(*b, code_block, code_buffer, nextPC, jo.memcheck);
+
+  const u8* start = AlignCode4();
+  b->checkedEntry = start;
+
+  FixupBranch skip = J_CC(CC_G);
+  MOV(32, PPCSTATE(pc), Imm32(em_address));
+  JMP(asm_routines.doTiming, true);
+  SetJumpTarget(skip);
+
+  b->normalEntry = GetCodePtr();
+
+  // The whole block is run by JitTiering::RunBlock, which leaves the next PC in ppcState and
+  // returns the cycles to charge; the dispatcher expects the flags of the downcount update.
+  ABI_PushRegistersAndAdjustStack({}, 0);
+  MOV(64, R(ABI_PARAM1), ImmPtr(tier0_block));
+  ABI_CallFunction(JitTiering::RunBlock);
+  ABI_PopRegistersAndAdjustStack({}, 0);
+  SUB(32, PPCSTATE(downcount), R(ABI_RETURN));
+  JMP(asm_routines.dispatcher, true);
+
+  b->codeSize = (u32)(GetCodePtr() - start);
+  b->originalSize = code_block.m_num_instructions;
+  blocks.FinalizeBlock(*b, jo.enableBlocklink, code_block.m_physical_addresses);
+}
+
 const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock* b, u32 nextPC)
 {
   js.firstFPInstructionFound = false;
@@ -644,22 +966,80 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
   js.curBlock = b;
   js.numLoadStoreInst = 0;
   js.numFloatingPointInst = 0;
+  js.codeLines.clear();
+  const u8* far_start = m_far_code.GetCodePtr();
 
   PPCAnalyst::CodeOp* ops = code_buf->codebuffer;
 
+  // Start up the register allocators
+  // They use the information in gpa/fpa to preload commonly used registers.
+  gpr.Start();
+  fpr.Start();
+
+  // Assume that GQR values don't change often at runtime. Many paired-heavy games use largely float
+  // loads and stores,
+  // which are significantly faster when inlined (especially in MMU mode, where this lets them use
+  // fastmem).
+  BitSet8 gqr_static;
+  if (js.pairedQuantizeAddresses.find(js.blockStart) == js.pairedQuantizeAddresses.end())
+  {
+    // If there are GQRs used but not set, we'll treat those as constant and optimize them
+    gqr_static = ComputeStaticGQRs(code_block);
+  }
+  const bool speculative_constants = js.noSpeculativeConstantsAddresses.find(js.blockStart) ==
+                                     js.noSpeculativeConstantsAddresses.end();
+
+  // A block with nothing to check before its first instruction can be entered by linked exits
+  // that already hold its inputs in the expected host registers; see WriteEntryRegisters.
+  u64 entry_layout = 0;
+  if (m_enable_register_passing && jo.enableBlocklink && code_block.m_num_instructions > 0 &&
+      !ImHereDebug && !Profiler::g_ProfileBlocks && !gqr_static &&
+      !(speculative_constants && HasSpeculativeConstants()))
+  {
+    entry_layout = BindEntryRegisters(ops[0]);
+  }
+
   const u8* start =
       AlignCode4();  // TODO: Test if this or AlignCode16 make a difference from GetCodePtr
-  b->checkedEntry = start;
+  const u8* normalEntry;
+  if (entry_layout)
+  {
+    // Linked exits enter at checkedEntry, or at hintedEntry if they have loaded the registers
+    // themselves. The dispatcher enters at normalEntry, which has no downcount to check.
+    b->checkedEntry = start;
+    WriteEntryLoads(entry_layout);
+
+    b->hintedEntry = GetCodePtr();
+    b->entry_layout = entry_layout;
+    FixupBranch skip = J_CC(CC_G);
+    MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
+    JMP(asm_routines.doTiming, true);
+
+    normalEntry = GetCodePtr();
+    WriteEntryLoads(entry_layout);
+    SetJumpTarget(skip);
+  }
+  else
+  {
+    b->checkedEntry = start;
 
-  // Downcount flag check. The last block decremented downcounter, and the flag should still be
-  // available.
-  FixupBranch skip = J_CC(CC_G);
-  MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
-  JMP(asm_routines.doTiming, true);  // downcount hit zero - go doTiming.
-  SetJumpTarget(skip);
+    // Downcount flag check. The last block decremented downcounter, and the flag should still be
+    // available.
+    FixupBranch skip = J_CC(CC_G);
+    MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
+    JMP(asm_routines.doTiming, true);  // downcount hit zero - go doTiming.
+    SetJumpTarget(skip);
 
-  const u8* normalEntry = GetCodePtr();
+    normalEntry = GetCodePtr();
+  }
   b->normalEntry = normalEntry;
+  if (m_enable_register_passing)
+  {
+    m_entry_layouts[em_address] = entry_layout;
+    ++m_num_blocks_compiled;
+    if (entry_layout)
+      ++m_num_entry_layouts;
+  }
 
   // Used to get a trace of the last few blocks before a crash, sometimes VERY useful
   if (ImHereDebug)
@@ -684,54 +1064,38 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
   MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
 #endif
 
-  // Start up the register allocators
-  // They use the information in gpa/fpa to preload commonly used registers.
-  gpr.Start();
-  fpr.Start();
-
   js.downcountAmount = 0;
   js.skipInstructions = 0;
   js.carryFlagSet = false;
   js.carryFlagInverted = false;
   js.constantGqr.clear();
 
-  // Assume that GQR values don't change often at runtime. Many paired-heavy games use largely float
-  // loads and stores,
-  // which are significantly faster when inlined (especially in MMU mode, where this lets them use
-  // fastmem).
-  if (js.pairedQuantizeAddresses.find(js.blockStart) == js.pairedQuantizeAddresses.end())
+  if (gqr_static)
   {
-    // If there are GQRs used but not set, we'll treat those as constant and optimize them
-    BitSet8 gqr_static = ComputeStaticGQRs(code_block);
-    if (gqr_static)
-    {
-      SwitchToFarCode();
-      const u8* target = GetCodePtr();
-      MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
-      ABI_PushRegistersAndAdjustStack({}, 0);
-      ABI_CallFunctionC(JitInterface::CompileExceptionCheck,
-                        static_cast<u32>(JitInterface::ExceptionType::PairedQuantize));
-      ABI_PopRegistersAndAdjustStack({}, 0);
-      JMP(asm_routines.dispatcherNoCheck, true);
-      SwitchToNearCode();
+    ++m_num_gqr_speculations;
+    SwitchToFarCode();
+    const u8* target = GetCodePtr();
+    MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
+    ABI_PushRegistersAndAdjustStack({}, 0);
+    ABI_CallFunctionC(JitInterface::CompileExceptionCheck,
+                      static_cast<u32>(JitInterface::ExceptionType::PairedQuantize));
+    ABI_PopRegistersAndAdjustStack({}, 0);
+    JMP(asm_routines.dispatcherNoCheck, true);
+    SwitchToNearCode();
 
-      // Insert a check that the GQRs are still the value we expect at
-      // the start of the block in case our guess turns out wrong.
-      for (int gqr : gqr_static)
-      {
-        u32 value = GQR(gqr);
-        js.constantGqr[gqr] = value;
-        CMP_or_TEST(32, PPCSTATE(spr[SPR_GQR0 + gqr]), Imm32(value));
-        J_CC(CC_NZ, target);
-      }
+    // Insert a check that the GQRs are still the value we expect at
+    // the start of the block in case our guess turns out wrong.
+    for (int gqr : gqr_static)
+    {
+      u32 value = GQR(gqr);
+      js.constantGqr[gqr] = value;
+      CMP_or_TEST(32, PPCSTATE(spr[SPR_GQR0 + gqr]), Imm32(value));
+      J_CC(CC_NZ, target);
     }
   }
 
-  if (js.noSpeculativeConstantsAddresses.find(js.blockStart) ==
-      js.noSpeculativeConstantsAddresses.end())
-  {
+  if (speculative_constants)
     IntializeSpeculativeConstants();
-  }
 
   // Translate instructions
   for (u32 i = 0; i < code_block.m_num_instructions; i++)
@@ -739,6 +1103,8 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
     js.compilerPC = ops[i].address;
     js.op = &ops[i];
     js.instructionNumber = i;
+    if (JitRegister::IsEnabled())
+      js.codeLines.push_back({GetCodePtr(), i + 1});
     js.instructionsLeft = (code_block.m_num_instructions - 1) - i;
     const GekkoOPInfo* opinfo = ops[i].opinfo;
     js.downcountAmount += opinfo->numCycles;
@@ -957,14 +1323,19 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
 
   if (code_block.m_broken)
   {
-    gpr.Flush();
-    fpr.Flush();
+    // Nothing follows the exit, so keep the register mapping around for WriteEntryRegisters.
+    gpr.Flush(RegCache::FlushMode::MaintainState);
+    fpr.Flush(RegCache::FlushMode::MaintainState);
     WriteExit(nextPC);
   }
 
   b->codeSize = (u32)(GetCodePtr() - start);
   b->originalSize = code_block.m_num_instructions;
 
+  // The far code of a block is contiguous as long as the block doesn't switch regions midway.
+  if (JitRegister::IsEnabled() && m_far_code.GetCodePtr() > far_start)
+    JitRegister::Register(far_start, m_far_code.GetCodePtr(), "JIT_PPC_FAR_%08x", em_address);
+
 #ifdef JIT_LOG_X86
   LogGeneratedX86(code_block.m_num_instructions, code_buf, start, b);
 #endif
@@ -1004,6 +1375,26 @@ void Jit64::EnableOptimization()
   analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CROR_MERGE);
   analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CARRY_MERGE);
   analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_BRANCH_FOLLOW);
+  if (m_trace_profile.IsEnabled())
+    analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_HOT_BRANCH_FOLLOW);
+  if (m_enable_idle_loop_detection)
+    analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_IDLE_LOOP_DETECTION);
+}
+
+static bool IsSpeculativeConstant(u32 value)
+{
+  return PowerPC::IsOptimizableGatherPipeWrite(value) ||
+         PowerPC::IsOptimizableGatherPipeWrite(value - 0x8000) || value == 0xCC000000;
+}
+
+bool Jit64::HasSpeculativeConstants() const
+{
+  for (auto i : code_block.m_gpr_inputs)
+  {
+    if (IsSpeculativeConstant(PowerPC::ppcState.gpr[i]))
+      return true;
+  }
+  return false;
 }
 
 void Jit64::IntializeSpeculativeConstants()
@@ -1018,9 +1409,7 @@ void Jit64::IntializeSpeculativeConstants()
   for (auto i : code_block.m_gpr_inputs)
   {
     u32 compileTimeValue = PowerPC::ppcState.gpr[i];
-    if (PowerPC::IsOptimizableGatherPipeWrite(compileTimeValue) ||
-        PowerPC::IsOptimizableGatherPipeWrite(compileTimeValue - 0x8000) ||
-        compileTimeValue == 0xCC000000)
+    if (IsSpeculativeConstant(compileTimeValue))
     {
       if (!target)
       {
@@ -18,6 +18,8 @@
 // ----------
 #pragma once
 
+#include <unordered_map>
+
 #include "Common/CommonTypes.h"
 #include "Common/x64ABI.h"
 #include "Common/x64Emitter.h"
@@ -25,6 +27,7 @@
 #include "Core/PowerPC/Jit64/GPRRegCache.h"
 #include "Core/PowerPC/Jit64/JitAsm.h"
 #include "Core/PowerPC/Jit64/JitRegCache.h"
+#include "Core/PowerPC/Jit64/JitTiering.h"
 #include "Core/PowerPC/Jit64Common/Jit64Base.h"
 #include "Core/PowerPC/JitCommon/JitCache.h"
 #include "Core/PowerPC/PPCAnalyst.h"
@@ -46,17 +49,23 @@ public:
   // Jit!
 
   void Jit(u32 em_address) override;
+  void JitTier0(u32 em_address);
   const u8* DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock* b, u32 nextPC);
 
   BitSet32 CallerSavedRegistersInUse() const;
+  // SafeLoadStoreFlags for the current load/store, from what the analyzer knows of its address.
+  int KnownAddressFlags(int accessSize) const;
+  bool IsKnownRAMAccess(const PPCAnalyst::CodeOp& op, int accessSize) const;
   BitSet8 ComputeStaticGQRs(const PPCAnalyst::CodeBlock&) const;
 
+  bool HasSpeculativeConstants() const;
   void IntializeSpeculativeConstants();
 
   JitBlockCache* GetBlockCache() override { return &blocks; }
   void Trace();
 
   void ClearCache() override;
+  void OnBlockDestroyed(const JitBlock& block) override;
 
   const CommonAsmRoutines* GetAsmRoutines() override { return &asm_routines; }
   const char* GetName() override { return "JIT64"; }
@@ -67,11 +76,20 @@ public:
   // Utilities for use by opcodes
 
   void FakeBLCall(u32 after);
+  // Counts an edge of a conditional branch for trace formation; see JitTraceProfile.
+  void WriteBranchCounter(const PPCAnalyst::CodeOp& op, bool taken);
+  // Passing guest registers in host registers between linked blocks; see WriteEntryRegisters.
+  u64 BindEntryRegisters(const PPCAnalyst::CodeOp& first_op);
+  void WriteEntryLoads(u64 layout);
+  u64 WriteEntryRegisters(u32 destination);
   void WriteExit(u32 destination, bool bl = false, u32 after = 0);
-  void JustWriteExit(u32 destination, bool bl, u32 after);
+  void JustWriteExit(u32 destination, bool bl, u32 after, u64 entry_layout = 0);
   void WriteExitDestInRSCRATCH(bool bl = false, u32 after = 0);
   void WriteBLRExit();
   void WriteExceptionExit();
+  // Skips ahead to the next CoreTiming event, then continues at destination.
+  void WriteIdleExit(u32 destination);
+  bool IsIdleLoopBranch(const PPCAnalyst::CodeOp& op) const;
   void WriteExternalExceptionExit();
   void WriteRfiExitDestInRSCRATCH();
   bool Cleanup();
@@ -87,6 +105,10 @@ public:
   // Use to extract bytes from a register using the regcache. offset is in bytes.
   Gen::OpArg ExtractFromReg(int reg, int offset);
   void AndWithMask(Gen::X64Reg reg, u32 mask);
+  // Copies arg into regOp rotated left by rotate bits, using RORX when BMI2 is available.
+  void RotateLeft(int bits, Gen::X64Reg regOp, const Gen::OpArg& arg, u8 rotate);
+  // Returns a register holding the shift amount in gpr b, for BMI2 SHLX/SHRX/SARX.
+  Gen::X64Reg ShiftAmountReg(int b);
   bool CheckMergedBranch(u32 crf);
   void DoMergedBranch();
   void DoMergedBranchCondition();
@@ -237,6 +259,11 @@ private:
   void AllocStack();
   void FreeStack();
 
+  // Makes room for the next block when the code space of the current region runs out, by
+  // moving on to the next region and recycling the blocks that were compiled into it.
+  void MakeCodeSpace();
+  void RecycleCodeRegion(size_t region);
+
   GPRRegCache gpr{*this};
   FPURegCache fpr{*this};
 
@@ -244,8 +271,26 @@ private:
   // large chunk of memory for each recompiled block.
   PPCAnalyst::CodeBuffer code_buffer;
   Jit64AsmRoutineManager asm_routines;
+  JitTiering m_tiering;
 
   bool m_enable_blr_optimization;
+  bool m_enable_register_passing = false;
+  // Entry layouts of the compiled blocks that are still around, by address; see
+  // WriteEntryRegisters.
+  std::unordered_map<u32, u64> m_entry_layouts;
+  u64 m_num_blocks_compiled = 0;
+  u64 m_num_entry_layouts = 0;
+  // Exits that set up the registers of their destination's entry layout.
+  u64 m_num_register_passing_exits = 0;
   bool m_cleanup_after_stackfault;
   u8* m_stack;
+
+  bool m_recycle_code_regions = false;
+  u64 m_num_regions_recycled = 0;
+  u64 m_num_blocks_recycled = 0;
+  // Times the code space filled up which would have cleared the whole cache before.
+  u64 m_num_flushes_avoided = 0;
+
+  bool m_enable_idle_loop_detection = false;
+  u64 m_num_idle_loops = 0;
 };
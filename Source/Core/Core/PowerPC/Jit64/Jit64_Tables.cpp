@@ -313,7 +313,7 @@ const GekkoOPTemplate table31[] = {
     {438, &Jit64::FallBackToInterpreter},  // ecowx
     {854, &Jit64::eieio},                  // eieio
     {306, &Jit64::FallBackToInterpreter},  // tlbie
-    {566, &Jit64::DoNothing},              // tlbsync
+    {566, &Jit64::FallBackToInterpreter},  // tlbsync
 };
 
 const GekkoOPTemplate table59[] = {
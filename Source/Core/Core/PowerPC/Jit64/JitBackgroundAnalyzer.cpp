@@ -0,0 +1,189 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/Jit64/JitBackgroundAnalyzer.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "Common/CommonTypes.h"
+#include "Common/Logging/Log.h"
+#include "Common/Thread.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/PowerPC.h"
+
+JitBackgroundAnalyzer::JitBackgroundAnalyzer() : m_code_buffer(32000)
+{
+}
+
+JitBackgroundAnalyzer::~JitBackgroundAnalyzer()
+{
+  Stop();
+}
+
+void JitBackgroundAnalyzer::Start(const PPCAnalyst::PPCAnalyzer& analyzer)
+{
+  Stop();
+
+  m_analyzer = analyzer;
+  // The branch profiles are updated by the CPU thread, so traces are only formed there.
+  m_analyzer.SetBranchPredictor(nullptr);
+  // The hook table is only safe to look at from the CPU thread, so any jump may go to a hooked
+  // function as far as the worker knows.
+  m_analyzer.SetHookLookup([](u32 address) -> u32 { return 1; });
+  m_stats = {};
+  m_translation.reset();
+  m_exit = false;
+  m_thread = std::thread(&JitBackgroundAnalyzer::WorkerThread, this);
+}
+
+void JitBackgroundAnalyzer::Stop()
+{
+  if (!m_thread.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_pending_lock);
+    m_exit = true;
+    m_pending.clear();
+  }
+  m_wake.notify_one();
+  m_thread.join();
+
+  const u64 num_published = std::max<u64>(m_stats.num_published, 1);
+  INFO_LOG(DYNA_REC,
+           "Background JIT analysis: %" PRIu64 " queued, %" PRIu64 " published, %" PRIu64
+           " discarded, max queue depth %zu, time to publish avg %" PRIu64 " us max %" PRIu64
+           " us",
+           m_stats.num_queued, m_stats.num_published, m_stats.num_discarded,
+           m_stats.max_queue_depth, m_stats.total_publish_us / num_published,
+           m_stats.max_publish_us);
+}
+
+JitBackgroundAnalyzer::RequestPtr JitBackgroundAnalyzer::Queue(u32 address, u32 msr)
+{
+  auto request = std::make_shared<Request>();
+  request->address = address;
+  request->msr_bits = msr & JitBaseBlockCache::JIT_CACHE_MSR_MASK;
+
+  if (!m_translation || !PowerPC::IsInstructionTranslationCurrent(*m_translation))
+  {
+    auto translation = std::make_shared<PowerPC::InstructionTranslation>();
+    PowerPC::CopyInstructionTranslation(translation.get());
+    m_translation = std::move(translation);
+  }
+  request->translation = m_translation;
+  request->queue_time = std::chrono::steady_clock::now();
+
+  size_t depth;
+  {
+    std::lock_guard<std::mutex> lock(m_pending_lock);
+    m_pending.push_back(request);
+    depth = m_pending.size();
+  }
+  m_wake.notify_one();
+
+  ++m_stats.num_queued;
+  m_stats.max_queue_depth = std::max(m_stats.max_queue_depth, depth);
+  return request;
+}
+
+void JitBackgroundAnalyzer::CancelPending()
+{
+  std::lock_guard<std::mutex> lock(m_pending_lock);
+  m_pending.clear();
+}
+
+size_t JitBackgroundAnalyzer::GetQueueDepth()
+{
+  std::lock_guard<std::mutex> lock(m_pending_lock);
+  return m_pending.size();
+}
+
+bool JitBackgroundAnalyzer::Take(const Request& request, PPCAnalyst::CodeBlock* block,
+                                 PPCAnalyst::CodeBuffer* buffer, u32* next_pc)
+{
+  bool usable = request.valid &&
+                request.msr_bits == (MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK) &&
+                request.ops.size() <= static_cast<size_t>(buffer->GetSize());
+
+  // Fetch every instruction the way a synchronous compile would have, which also keeps the
+  // emulated instruction cache in the state it would have been in.
+  for (size_t i = 0; usable && i < request.ops.size(); ++i)
+  {
+    const PPCAnalyst::CodeOp& op = request.ops[i];
+    const PowerPC::TryReadInstResult result = PowerPC::TryReadInstruction(op.address);
+    usable = result.valid && result.hex == op.inst.hex &&
+             request.code_block.m_physical_addresses.count(result.physical_address) != 0;
+  }
+
+  if (!usable)
+  {
+    ++m_stats.num_discarded;
+    return false;
+  }
+
+  PPCAnalyst::BlockStats* stats = block->m_stats;
+  PPCAnalyst::BlockRegStats* gpa = block->m_gpa;
+  PPCAnalyst::BlockRegStats* fpa = block->m_fpa;
+  *block = request.code_block;
+  block->m_stats = stats;
+  block->m_gpa = gpa;
+  block->m_fpa = fpa;
+  *stats = request.stats;
+  *gpa = request.gpa;
+  *fpa = request.fpa;
+  std::copy(request.ops.begin(), request.ops.end(), buffer->codebuffer);
+  *next_pc = request.next_pc;
+
+  const u64 publish_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - request.queue_time)
+                             .count();
+  ++m_stats.num_published;
+  m_stats.total_publish_us += publish_us;
+  m_stats.max_publish_us = std::max(m_stats.max_publish_us, publish_us);
+  return true;
+}
+
+void JitBackgroundAnalyzer::WorkerThread()
+{
+  Common::SetCurrentThreadName("JIT analyzer");
+
+  while (true)
+  {
+    RequestPtr request;
+    {
+      std::unique_lock<std::mutex> lock(m_pending_lock);
+      m_wake.wait(lock, [this] { return m_exit || !m_pending.empty(); });
+      if (m_exit)
+        return;
+
+      request = std::move(m_pending.front());
+      m_pending.pop_front();
+    }
+
+    Analyze(*request);
+    request->done.store(true, std::memory_order_release);
+  }
+}
+
+void JitBackgroundAnalyzer::Analyze(Request& request)
+{
+  request.code_block.m_stats = &request.stats;
+  request.code_block.m_gpa = &request.gpa;
+  request.code_block.m_fpa = &request.fpa;
+
+  const PowerPC::InstructionTranslation& translation = *request.translation;
+  m_analyzer.SetInstructionReader([&translation](u32 address) {
+    return PowerPC::HostTryReadInstruction(address, translation);
+  });
+  request.next_pc = m_analyzer.Analyze(request.address, &request.code_block, &m_code_buffer,
+                                       m_code_buffer.GetSize());
+  request.valid = !request.code_block.m_memory_exception;
+  if (request.valid)
+  {
+    request.ops.assign(m_code_buffer.codebuffer,
+                       m_code_buffer.codebuffer + request.code_block.m_num_instructions);
+  }
+}
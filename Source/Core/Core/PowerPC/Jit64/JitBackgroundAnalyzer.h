@@ -0,0 +1,103 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// Runs PPCAnalyst for blocks that are about to be compiled on a worker thread. Meanwhile the
+// CPU thread keeps running those blocks through the interpreter (tier 0 of JitTiering), and
+// only emits code once the analysis is ready.
+//
+// Code emission and publishing stay on the CPU thread, unlike what was first planned: emitted
+// blocks refer to far code, trampolines, the constant pool and other blocks, all of which the CPU
+// thread owns, so emitting elsewhere would need most of the emitter to become thread safe.
+//
+// The worker never looks at the CPU's state. It translates addresses with a copy of the
+// translation state made when the block was queued, reads guest code without going through the
+// emulated instruction cache or the TLB, and doesn't look up HLE hooks. Its view of memory can
+// still be stale, so every result is checked against a real instruction fetch before it is used.
+class JitBackgroundAnalyzer
+{
+public:
+  struct Request
+  {
+    u32 address;
+    u32 msr_bits;
+    std::shared_ptr<const PowerPC::InstructionTranslation> translation;
+    std::chrono::steady_clock::time_point queue_time;
+    std::atomic<bool> done{false};
+
+    // Filled in by the worker thread before done is set.
+    bool valid = false;
+    u32 next_pc = 0;
+    PPCAnalyst::CodeBlock code_block;
+    PPCAnalyst::BlockStats stats;
+    PPCAnalyst::BlockRegStats gpa;
+    PPCAnalyst::BlockRegStats fpa;
+    std::vector<PPCAnalyst::CodeOp> ops;
+  };
+  using RequestPtr = std::shared_ptr<Request>;
+
+  struct Statistics
+  {
+    u64 num_queued = 0;
+    u64 num_published = 0;
+    u64 num_discarded = 0;
+    size_t max_queue_depth = 0;
+    // Time from queueing a block to its compiled version being published.
+    u64 total_publish_us = 0;
+    u64 max_publish_us = 0;
+  };
+
+  JitBackgroundAnalyzer();
+  ~JitBackgroundAnalyzer();
+
+  // Starts the worker thread, which analyzes with the same options as the given analyzer.
+  void Start(const PPCAnalyst::PPCAnalyzer& analyzer);
+  void Stop();
+  bool IsRunning() const { return m_thread.joinable(); }
+
+  RequestPtr Queue(u32 address, u32 msr);
+  // Drops requests the worker has not started on yet.
+  void CancelPending();
+
+  // Hands the result of a finished request to the compiler, if it still matches what the CPU
+  // thread fetches from memory. Must be called on the CPU thread.
+  bool Take(const Request& request, PPCAnalyst::CodeBlock* block,
+            PPCAnalyst::CodeBuffer* buffer, u32* next_pc);
+
+  size_t GetQueueDepth();
+  const Statistics& GetStatistics() const { return m_stats; }
+
+private:
+  void WorkerThread();
+  void Analyze(Request& request);
+
+  std::thread m_thread;
+  bool m_exit = false;
+  std::deque<RequestPtr> m_pending;
+  std::mutex m_pending_lock;
+  std::condition_variable m_wake;
+
+  // Only used by the worker thread.
+  PPCAnalyst::PPCAnalyzer m_analyzer;
+  PPCAnalyst::CodeBuffer m_code_buffer;
+
+  // Only used by the CPU thread.
+  Statistics m_stats;
+  // Shared by the requests queued while the translation state doesn't change.
+  std::shared_ptr<const PowerPC::InstructionTranslation> m_translation;
+};
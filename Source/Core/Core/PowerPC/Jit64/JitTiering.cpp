@@ -0,0 +1,264 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/Jit64/JitTiering.h"
+
+#include <cinttypes>
+
+#include "Common/CommonTypes.h"
+#include "Common/Logging/Log.h"
+#include "Core/ConfigManager.h"
+#include "Core/HLE/HLE.h"
+#include "Core/PatchEngine.h"
+#include "Core/PowerPC/PPCTables.h"
+#include "Core/PowerPC/PowerPC.h"
+
+void JitTiering::Init(const PPCAnalyst::PPCAnalyzer& analyzer, JitBaseBlockCache& block_cache)
+{
+  const SConfig& config = SConfig::GetInstance();
+  m_block_cache = &block_cache;
+  m_enabled = config.bJITTieredCompilation || config.bJITBackgroundCompilation;
+  m_hot_addresses.clear();
+  m_branch_profiles.clear();
+  m_num_translated = 0;
+  m_num_promoted = 0;
+  ClearBlocks();
+
+  if (config.bJITBackgroundCompilation)
+    m_background.Start(analyzer);
+}
+
+void JitTiering::Shutdown()
+{
+  if (m_enabled)
+  {
+    INFO_LOG(DYNA_REC, "Tiered compilation: %" PRIu64 " blocks interpreted, %" PRIu64 " compiled",
+             m_num_translated, m_num_promoted);
+  }
+  m_background.Stop();
+  ClearBlocks();
+}
+
+void JitTiering::ClearBlocks()
+{
+  m_blocks.clear();
+  m_destroyed_blocks.clear();
+  m_ready.clear();
+  m_background.CancelPending();
+}
+
+void JitTiering::DestroyBlock(const JitBlock& jit_block)
+{
+  const auto it = m_blocks.find(&jit_block);
+  if (it == m_blocks.end())
+    return;
+
+  m_destroyed_blocks.push_back(std::move(it->second));
+  m_blocks.erase(it);
+}
+
+void JitTiering::FreeDestroyedBlocks()
+{
+  m_destroyed_blocks.clear();
+}
+
+bool JitTiering::IsHot(u32 effective_address) const
+{
+  return m_hot_addresses.count(effective_address) != 0;
+}
+
+static bool IsConditionalBranch(UGeckoInstruction inst)
+{
+  u32 bo;
+  if (inst.OPCD == 16)
+    bo = inst.BO;
+  else if (inst.OPCD == 19 && (inst.SUBOP10 == 16 || inst.SUBOP10 == 528))
+    bo = inst.BO_2;
+  else
+    return false;
+
+  return (bo & BO_DONT_CHECK_CONDITION) == 0 || (bo & BO_DONT_DECREMENT_FLAG) == 0;
+}
+
+const JitTiering::Block* JitTiering::Translate(JitBlock& jit_block,
+                                               const PPCAnalyst::CodeBlock& code_block,
+                                               const PPCAnalyst::CodeBuffer& code_buffer,
+                                               u32 next_pc, bool memcheck)
+{
+  std::unique_ptr<Block>& slot = m_blocks[&jit_block];
+  slot = std::make_unique<Block>();
+  Block& block = *slot;
+  block.owner = this;
+  block.jit_block = &jit_block;
+  block.effective_address = jit_block.effectiveAddress;
+  block.next_pc = next_pc;
+  block.run_count = 0;
+
+  const bool speedhacks = !SConfig::GetInstance().bEnableDebugging;
+  bool first_fp_instruction_found = false;
+  u32 downcount = 0;
+
+  const PPCAnalyst::CodeOp* ops = code_buffer.codebuffer;
+  for (u32 i = 0; i < code_block.m_num_instructions; i++)
+  {
+    const PPCAnalyst::CodeOp& op = ops[i];
+    downcount += op.opinfo->numCycles;
+    if (speedhacks)
+      downcount += PatchEngine::GetSpeedhackCycles(op.address);
+
+    u32 function = HLE::GetFirstFunctionIndex(op.address);
+    if (function != 0)
+    {
+      int type = HLE::GetFunctionTypeByIndex(function);
+      if ((type == HLE::HLE_HOOK_START || type == HLE::HLE_HOOK_REPLACE) &&
+          HLE::IsEnabled(HLE::GetFunctionFlagsByIndex(function)))
+      {
+        const bool replace = type == HLE::HLE_HOOK_REPLACE;
+        block.instructions.push_back({Interpreter::HLEFunction, UGeckoInstruction(function),
+                                      op.address, downcount, true, false, false, replace,
+                                      nullptr});
+        if (replace)
+          break;
+      }
+    }
+
+    if (op.skip)
+      continue;
+
+    const bool check_fpu = (op.opinfo->flags & FL_USE_FPU) && !first_fp_instruction_found;
+    const bool end_block = (op.opinfo->flags & FL_ENDBLOCK) != 0;
+    const bool check_dsi = memcheck && (op.opinfo->flags & FL_LOADSTORE);
+    if (check_fpu)
+      first_fp_instruction_found = true;
+
+    BranchProfile* branch = nullptr;
+    if (end_block && IsConditionalBranch(op.inst))
+      branch = &m_branch_profiles[op.address];
+
+    block.instructions.push_back({GetInterpreterOp(op.inst), op.inst, op.address, downcount,
+                                  end_block || check_dsi, check_fpu, check_dsi, end_block,
+                                  branch});
+  }
+
+  block.downcount = downcount;
+  ++m_num_translated;
+  return &block;
+}
+
+u32 JitTiering::RunBlock(Block* block)
+{
+  if (++block->run_count > TIER_UP_THRESHOLD)
+  {
+    JitTiering* owner = block->owner;
+    if (!owner->m_background.IsRunning())
+    {
+      // PC still points at this block, so the dispatcher will pick up the compiled version.
+      owner->Promote(*block);
+      return 0;
+    }
+
+    // Keep interpreting until the worker thread is done with the block.
+    if (!block->analysis)
+      block->analysis = owner->m_background.Queue(block->effective_address, MSR);
+    else if (block->analysis->done.load(std::memory_order_acquire))
+    {
+      owner->Promote(*block);
+      return 0;
+    }
+  }
+
+  for (const Instruction& instruction : block->instructions)
+  {
+    if (instruction.check_fpu && !UReg_MSR(MSR).FP)
+    {
+      PC = NPC = instruction.address;
+      PowerPC::ppcState.Exceptions |= EXCEPTION_FPU_UNAVAILABLE;
+      PowerPC::CheckExceptions();
+      return instruction.downcount;
+    }
+
+    if (instruction.write_pc)
+    {
+      PC = instruction.address;
+      NPC = instruction.address + 4;
+    }
+
+    instruction.interpret(instruction.inst);
+
+    if (instruction.memcheck && (PowerPC::ppcState.Exceptions & EXCEPTION_DSI))
+    {
+      PowerPC::CheckExceptions();
+      return instruction.downcount;
+    }
+
+    if (instruction.end_block)
+    {
+      if (instruction.branch)
+      {
+        if (NPC == instruction.address + 4)
+          ++instruction.branch->not_taken;
+        else
+          ++instruction.branch->taken;
+      }
+
+      // Same as the exception exit Jit64 uses after falling back to the interpreter.
+      PC = NPC;
+      PowerPC::CheckExceptions();
+      return instruction.downcount;
+    }
+  }
+
+  PC = NPC = block->next_pc;
+  return block->downcount;
+}
+
+const JitTiering::BranchProfile* JitTiering::GetBranchProfile(u32 address) const
+{
+  const auto it = m_branch_profiles.find(address);
+  if (it == m_branch_profiles.end())
+    return nullptr;
+
+  // Require a reasonable number of samples; a freshly translated block has none.
+  const BranchProfile& profile = it->second;
+  if (profile.taken + profile.not_taken < TIER_UP_THRESHOLD / 2)
+    return nullptr;
+  return &profile;
+}
+
+bool JitTiering::IsBranchRarelyTaken(u32 address) const
+{
+  const BranchProfile* profile = GetBranchProfile(address);
+  return profile && profile->taken * 16 < profile->taken + profile->not_taken;
+}
+
+bool JitTiering::IsBranchLikelyTaken(u32 address) const
+{
+  const BranchProfile* profile = GetBranchProfile(address);
+  return profile && profile->not_taken * 16 < profile->taken + profile->not_taken;
+}
+
+bool JitTiering::TakeAnalysis(u32 effective_address, PPCAnalyst::CodeBlock* code_block,
+                              PPCAnalyst::CodeBuffer* code_buffer, u32* next_pc)
+{
+  const auto it = m_ready.find(effective_address);
+  if (it == m_ready.end())
+    return false;
+
+  const JitBackgroundAnalyzer::RequestPtr request = std::move(it->second);
+  m_ready.erase(it);
+  return m_background.Take(*request, code_block, code_buffer, next_pc);
+}
+
+void JitTiering::Promote(const Block& block)
+{
+  m_hot_addresses.insert(block.effective_address);
+  if (block.analysis)
+    m_ready[block.effective_address] = block.analysis;
+  ++m_num_promoted;
+
+  // Throw away the tier-0 block; the next dispatch of this address compiles it for real.
+  // Only its own JitBlock goes, as other blocks overlapping its code are still valid.
+  // This destroys the block, which must not be touched afterwards.
+  m_block_cache->EraseBlock(*block.jit_block);
+}
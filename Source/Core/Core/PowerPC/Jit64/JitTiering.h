@@ -0,0 +1,137 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/PowerPC/Gekko.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
+#include "Core/PowerPC/Jit64/JitBackgroundAnalyzer.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+
+// Tiered compilation for Jit64.
+//
+// Most guest code only ever runs a handful of times (boot code, loaders, one-off setup), yet
+// without tiering every block gets the full treatment from the x86 code generator. With tiering
+// enabled, a block is first translated into a list of interpreter calls, like the blocks the
+// CachedInterpreter runs, which is far cheaper to produce and needs only a small stub of host
+// code. Tier-0 blocks count how often they run and how their conditional branch went. Once a
+// block has run TIER_UP_THRESHOLD times it is invalidated and compiled by Jit64 proper, which
+// can then consult the branch counts collected in the meantime.
+//
+// With background compilation enabled, a block that reaches the threshold is queued on the
+// JitBackgroundAnalyzer instead and keeps running in tier 0 until its analysis is done.
+class JitTiering
+{
+public:
+  // Number of runs after which a tier-0 block is recompiled by the real JIT.
+  static constexpr u32 TIER_UP_THRESHOLD = 200;
+
+  struct BranchProfile
+  {
+    u64 taken = 0;
+    u64 not_taken = 0;
+  };
+
+  struct Instruction
+  {
+    Interpreter::Instruction interpret;
+    UGeckoInstruction inst;
+    u32 address;
+    // Cycles taken by the block up to and including this instruction.
+    u32 downcount;
+    // Update PC/NPC before running the instruction; needed by branches, HLE and DSI handling.
+    bool write_pc;
+    bool check_fpu;
+    bool memcheck;
+    bool end_block;
+    // Set for conditional branches.
+    BranchProfile* branch;
+  };
+
+  struct Block
+  {
+    JitTiering* owner;
+    JitBlock* jit_block;
+    u32 effective_address;
+    u32 next_pc;
+    u32 downcount;
+    u32 run_count;
+    std::vector<Instruction> instructions;
+    // Pending background analysis, once the block has reached the threshold.
+    JitBackgroundAnalyzer::RequestPtr analysis;
+  };
+
+  // Options for background analysis are taken from the given analyzer, so call this after
+  // the JIT has configured it. Promoted blocks are erased from block_cache.
+  void Init(const PPCAnalyst::PPCAnalyzer& analyzer, JitBaseBlockCache& block_cache);
+  void Shutdown();
+
+  // Drops all tier-0 blocks. The set of hot addresses and the branch profiles are kept, so
+  // that blocks which were hot before a cache flush are compiled right away afterwards.
+  void ClearBlocks();
+  // Drops the tier-0 block of the given JitBlock, if it has one. RunBlock may still be running
+  // it, so it is only freed by the next call to FreeDestroyedBlocks.
+  void DestroyBlock(const JitBlock& jit_block);
+  // Must not be called from within RunBlock.
+  void FreeDestroyedBlocks();
+
+  bool IsEnabled() const { return m_enabled; }
+  bool IsHot(u32 effective_address) const;
+
+  // Tier-0 blocks end at their first branch, so that every conditional branch gets a profile.
+  PPCAnalyst::PPCAnalyzer& GetAnalyzer() { return m_analyzer; }
+
+  // Builds a tier-0 block from the output of GetAnalyzer(), owned by jit_block.
+  const Block* Translate(JitBlock& jit_block, const PPCAnalyst::CodeBlock& code_block,
+                         const PPCAnalyst::CodeBuffer& code_buffer, u32 next_pc, bool memcheck);
+
+  // Called by the host code stub of a tier-0 block. Runs the block, leaving PC at the next block
+  // to run, and returns the number of cycles to subtract from the downcount.
+  static u32 RunBlock(Block* block);
+
+  // Fills in the analysis of a block that was promoted after background analysis, if there is
+  // one and it is still valid. Returns false if the caller has to analyze the block itself.
+  bool TakeAnalysis(u32 effective_address, PPCAnalyst::CodeBlock* code_block,
+                    PPCAnalyst::CodeBuffer* code_buffer, u32* next_pc);
+
+  const JitBackgroundAnalyzer::Statistics& GetBackgroundStatistics() const
+  {
+    return m_background.GetStatistics();
+  }
+  size_t GetBackgroundQueueDepth() { return m_background.GetQueueDepth(); }
+
+  // True if tier 0 saw the conditional branch at this address being taken only rarely.
+  bool IsBranchRarelyTaken(u32 address) const;
+  // True if tier 0 saw the conditional branch at this address being taken nearly always.
+  bool IsBranchLikelyTaken(u32 address) const;
+
+private:
+  const BranchProfile* GetBranchProfile(u32 address) const;
+  void Promote(const Block& block);
+
+  bool m_enabled = false;
+  PPCAnalyst::PPCAnalyzer m_analyzer;
+  JitBaseBlockCache* m_block_cache = nullptr;
+
+  // Emitted stubs point at their block, so blocks are allocated individually.
+  std::unordered_map<const JitBlock*, std::unique_ptr<Block>> m_blocks;
+  std::vector<std::unique_ptr<Block>> m_destroyed_blocks;
+  std::unordered_set<u32> m_hot_addresses;
+  // Elements of an unordered_map never move, so tier-0 instructions can point into it.
+  std::unordered_map<u32, BranchProfile> m_branch_profiles;
+
+  JitBackgroundAnalyzer m_background;
+  // Finished analyses of promoted blocks, waiting for the next dispatch of their address.
+  std::unordered_map<u32, JitBackgroundAnalyzer::RequestPtr> m_ready;
+
+  u64 m_num_translated = 0;
+  u64 m_num_promoted = 0;
+};
@@ -6,7 +6,6 @@
 #include "Common/Assert.h"
 #include "Common/CommonTypes.h"
 #include "Common/x64Emitter.h"
-#include "Core/CoreTiming.h"
 #include "Core/PowerPC/Gekko.h"
 #include "Core/PowerPC/Jit64/JitRegCache.h"
 #include "Core/PowerPC/Jit64Common/Jit64PowerPCState.h"
@@ -69,6 +68,17 @@ void Jit64::bx(UGeckoInstruction inst)
   if (inst.LK)
     MOV(32, PPCSTATE_LR, Imm32(js.compilerPC + 4));
 
+  if (IsIdleLoopBranch(*js.op))
+  {
+    // The analyzer may have kept going at the start of the loop, but nothing after this
+    // branch is reached.
+    gpr.Flush(RegCache::FlushMode::MaintainState);
+    fpr.Flush(RegCache::FlushMode::MaintainState);
+    ++m_num_idle_loops;
+    WriteIdleExit(js.blockStart);
+    return;
+  }
+
   // If this is not the last instruction of a block,
   // we will skip the rest process.
   // Because PPCAnalyst::Flatten() merged the blocks.
@@ -84,8 +94,9 @@ void Jit64::bx(UGeckoInstruction inst)
     return;
   }
 
-  gpr.Flush();
-  fpr.Flush();
+  // This is the end of the block, so the mapping can be kept for WriteEntryRegisters.
+  gpr.Flush(RegCache::FlushMode::MaintainState);
+  fpr.Flush(RegCache::FlushMode::MaintainState);
 
   u32 destination;
   if (inst.AA)
@@ -98,11 +109,7 @@ void Jit64::bx(UGeckoInstruction inst)
 #endif
   if (destination == js.compilerPC)
   {
-    ABI_PushRegistersAndAdjustStack({}, 0);
-    ABI_CallFunction(CoreTiming::Idle);
-    ABI_PopRegistersAndAdjustStack({}, 0);
-    MOV(32, PPCSTATE(pc), Imm32(destination));
-    WriteExceptionExit();
+    WriteIdleExit(destination);
     return;
   }
   WriteExit(destination, inst.LK, js.compilerPC + 4);
@@ -118,6 +125,21 @@ void Jit64::bcx(UGeckoInstruction inst)
 
   // USES_CR
 
+  if (js.op->branchIsFollowed)
+  {
+    // The analyzer continued the block at the branch target, so the taken path falls through
+    // and only the not-taken path leaves the block, from far code.
+    FixupBranch pConditionDontBranch =
+        JumpIfCRFieldBit(inst.BI >> 2, 3 - (inst.BI & 3), !(inst.BO_2 & BO_BRANCH_IF_TRUE));
+    SwitchToFarCode();
+    SetJumpTarget(pConditionDontBranch);
+    gpr.Flush(RegCache::FlushMode::MaintainState);
+    fpr.Flush(RegCache::FlushMode::MaintainState);
+    WriteExit(js.compilerPC + 4);
+    SwitchToNearCode();
+    return;
+  }
+
   FixupBranch pCTRDontBranch;
   if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)  // Decrement and test CTR
   {
@@ -128,8 +150,21 @@ void Jit64::bcx(UGeckoInstruction inst)
       pCTRDontBranch = J_CC(CC_Z, true);
   }
 
+  // If tiered compilation saw this branch being taken only rarely, move the taken path out of
+  // line so that the common case falls straight through.
+  const bool cold_exit = (inst.BO & BO_DONT_DECREMENT_FLAG) &&
+                         (inst.BO & BO_DONT_CHECK_CONDITION) == 0 &&
+                         m_tiering.IsBranchRarelyTaken(js.compilerPC);
+
   FixupBranch pConditionDontBranch;
-  if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)  // Test a CR bit
+  if (cold_exit)
+  {
+    FixupBranch pConditionBranch =
+        JumpIfCRFieldBit(inst.BI >> 2, 3 - (inst.BI & 3), !!(inst.BO_2 & BO_BRANCH_IF_TRUE));
+    SwitchToFarCode();
+    SetJumpTarget(pConditionBranch);
+  }
+  else if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)  // Test a CR bit
   {
     pConditionDontBranch =
         JumpIfCRFieldBit(inst.BI >> 2, 3 - (inst.BI & 3), !(inst.BO_2 & BO_BRANCH_IF_TRUE));
@@ -162,12 +197,24 @@ void Jit64::bcx(UGeckoInstruction inst)
 
   gpr.Flush(RegCache::FlushMode::MaintainState);
   fpr.Flush(RegCache::FlushMode::MaintainState);
-  WriteExit(destination, inst.LK, js.compilerPC + 4);
+  WriteBranchCounter(*js.op, true);
+  if (IsIdleLoopBranch(*js.op))
+  {
+    ++m_num_idle_loops;
+    WriteIdleExit(destination);
+  }
+  else
+  {
+    WriteExit(destination, inst.LK, js.compilerPC + 4);
+  }
 
-  if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
+  if (cold_exit)
+    SwitchToNearCode();
+  else if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
     SetJumpTarget(pConditionDontBranch);
   if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)
     SetJumpTarget(pCTRDontBranch);
+  WriteBranchCounter(*js.op, false);
 
   if (!analyzer.HasOption(PPCAnalyst::PPCAnalyzer::OPTION_CONDITIONAL_CONTINUE))
   {
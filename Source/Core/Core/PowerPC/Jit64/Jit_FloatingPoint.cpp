@@ -425,7 +425,20 @@ void Jit64::fselx(UGeckoInstruction inst)
   else
     CMPSD(XMM0, fpr.R(a), CMP_NLE);
 
-  if (cpu_info.bSSE4_1)
+  if (cpu_info.bAVX && packed)
+  {
+    // VBLENDVPD takes an explicit mask and destination, so blend straight into d.
+    X64Reg src1 = XMM1;
+    if (fpr.R(c).IsSimpleReg())
+      src1 = fpr.RX(c);
+    else
+      MOVAPD(XMM1, fpr.R(c));
+    fpr.BindToRegister(d, d == b || d == c);
+    VBLENDVPD(fpr.RX(d), src1, fpr.R(b), XMM0);
+    fpr.UnlockAll();
+    return;
+  }
+  else if (cpu_info.bSSE4_1)
   {
     MOVAPD(XMM1, fpr.R(c));
     BLENDVPD(XMM1, fpr.R(b));
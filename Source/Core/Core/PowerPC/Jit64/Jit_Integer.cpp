@@ -87,6 +87,10 @@ void Jit64::FinalizeCarry(CCFlags cond)
       JitSetCAIf(cond);
     }
   }
+  else
+  {
+    ++m_num_dead_flags_eliminated;
+  }
 }
 
 // Unconditional version
@@ -114,6 +118,10 @@ void Jit64::FinalizeCarry(bool ca)
       JitClearCA();
     }
   }
+  else
+  {
+    ++m_num_dead_flags_eliminated;
+  }
 }
 
 void Jit64::FinalizeCarryOverflow(bool oe, bool inv)
@@ -143,6 +151,10 @@ void Jit64::FinalizeCarryOverflow(bool oe, bool inv)
 void Jit64::ComputeRC(const OpArg& arg, bool needs_test, bool needs_sext)
 {
   _assert_msg_(DYNA_REC, arg.IsSimpleReg() || arg.IsImm(), "Invalid ComputeRC operand");
+  // A merged branch reads CR0, so it is never dead in that case.
+  if (SkipDeadCRField(0))
+    return;
+
   if (arg.IsImm())
   {
     MOV(64, PPCSTATE(cr_val[0]), Imm32(arg.SImm32()));
@@ -207,6 +219,32 @@ void Jit64::AndWithMask(X64Reg reg, u32 mask)
     AND(32, R(reg), Imm32(mask));
 }
 
+// RORX is a non-destructive, flag-preserving rotate, which saves the MOV when the source and
+// destination differ.
+void Jit64::RotateLeft(int bits, X64Reg regOp, const OpArg& arg, u8 rotate)
+{
+  const bool is_same_reg = arg.IsSimpleReg(regOp);
+  if (cpu_info.bBMI2 && !is_same_reg && !arg.IsImm() && rotate != 0)
+  {
+    RORX(bits, regOp, arg, bits - rotate);
+    return;
+  }
+  if (!is_same_reg)
+    MOV(bits, R(regOp), arg);
+  if (rotate != 0)
+    ROL(bits, R(regOp), Imm8(rotate));
+}
+
+// The BMI2 shifts take their count from any register, so the variable shifts don't have to
+// flush ECX. They mask the count to 6 bits in 64-bit mode, like SHL/SHR/SAR by CL.
+X64Reg Jit64::ShiftAmountReg(int b)
+{
+  if (gpr.R(b).IsSimpleReg())
+    return gpr.RX(b);
+  MOV(32, R(RSCRATCH2), gpr.R(b));
+  return RSCRATCH2;
+}
+
 // Following static functions are used in conjunction with regimmop
 static u32 Add(u32 a, u32 b)
 {
@@ -370,7 +408,15 @@ void Jit64::DoMergedBranch()
       destination = SignExt16(next.BD << 2);
     else
       destination = nextPC + SignExt16(next.BD << 2);
-    WriteExit(destination, next.LK, nextPC + 4);
+    if (IsIdleLoopBranch(js.op[1]))
+    {
+      ++m_num_idle_loops;
+      WriteIdleExit(destination);
+    }
+    else
+    {
+      WriteExit(destination, next.LK, nextPC + 4);
+    }
   }
   else if ((next.OPCD == 19) && (next.SUBOP10 == 528))  // bcctrx
   {
@@ -406,22 +452,77 @@ void Jit64::DoMergedBranchCondition()
 
   gpr.UnlockAll();
   gpr.UnlockAllX();
-  FixupBranch pDontBranch;
-  if (test_bit & 8)
-    pDontBranch = J_CC(condition ? CC_GE : CC_L, true);  // Test < 0, so jump over if >= 0.
-  else if (test_bit & 4)
-    pDontBranch = J_CC(condition ? CC_LE : CC_G, true);  // Test > 0, so jump over if <= 0.
-  else if (test_bit & 2)
-    pDontBranch = J_CC(condition ? CC_NE : CC_E, true);  // Test = 0, so jump over if != 0.
-  else  // SO bit, do not branch (we don't emulate SO for cmp).
-    pDontBranch = J(true);
 
-  gpr.Flush(RegCache::FlushMode::MaintainState);
-  fpr.Flush(RegCache::FlushMode::MaintainState);
+  if (js.op[1].branchIsFollowed)
+  {
+    // The block continues at the branch target; only the not-taken path leaves it.
+    if ((test_bit & 0xE) == 0)
+    {
+      // SO bit, never taken (we don't emulate SO for cmp).
+      gpr.Flush();
+      fpr.Flush();
+      WriteExit(nextPC + 4);
+      return;
+    }
+
+    FixupBranch pDontBranch;
+    if (test_bit & 8)
+      pDontBranch = J_CC(condition ? CC_GE : CC_L, true);
+    else if (test_bit & 4)
+      pDontBranch = J_CC(condition ? CC_LE : CC_G, true);
+    else
+      pDontBranch = J_CC(condition ? CC_NE : CC_E, true);
+
+    SwitchToFarCode();
+    SetJumpTarget(pDontBranch);
+    gpr.Flush(RegCache::FlushMode::MaintainState);
+    fpr.Flush(RegCache::FlushMode::MaintainState);
+    WriteExit(nextPC + 4);
+    SwitchToNearCode();
+    return;
+  }
+
+  // If tiered compilation saw this branch being taken only rarely, move the taken path out of
+  // line so that the common case falls straight through.
+  if ((test_bit & 0xE) && m_tiering.IsBranchRarelyTaken(nextPC))
+  {
+    FixupBranch pBranch;
+    if (test_bit & 8)
+      pBranch = J_CC(condition ? CC_L : CC_GE, true);
+    else if (test_bit & 4)
+      pBranch = J_CC(condition ? CC_G : CC_LE, true);
+    else
+      pBranch = J_CC(condition ? CC_E : CC_NE, true);
 
-  DoMergedBranch();
+    SwitchToFarCode();
+    SetJumpTarget(pBranch);
+    gpr.Flush(RegCache::FlushMode::MaintainState);
+    fpr.Flush(RegCache::FlushMode::MaintainState);
+    WriteBranchCounter(js.op[1], true);
+    DoMergedBranch();
+    SwitchToNearCode();
+  }
+  else
+  {
+    FixupBranch pDontBranch;
+    if (test_bit & 8)
+      pDontBranch = J_CC(condition ? CC_GE : CC_L, true);  // Test < 0, so jump over if >= 0.
+    else if (test_bit & 4)
+      pDontBranch = J_CC(condition ? CC_LE : CC_G, true);  // Test > 0, so jump over if <= 0.
+    else if (test_bit & 2)
+      pDontBranch = J_CC(condition ? CC_NE : CC_E, true);  // Test = 0, so jump over if != 0.
+    else  // SO bit, do not branch (we don't emulate SO for cmp).
+      pDontBranch = J(true);
+
+    gpr.Flush(RegCache::FlushMode::MaintainState);
+    fpr.Flush(RegCache::FlushMode::MaintainState);
 
-  SetJumpTarget(pDontBranch);
+    WriteBranchCounter(js.op[1], true);
+    DoMergedBranch();
+
+    SetJumpTarget(pDontBranch);
+  }
+  WriteBranchCounter(js.op[1], false);
 
   if (!analyzer.HasOption(PPCAnalyst::PPCAnalyzer::OPTION_CONDITIONAL_CONTINUE))
   {
@@ -452,7 +553,17 @@ void Jit64::DoMergedBranchImmediate(s64 val)
   else  // SO bit, do not branch (we don't emulate SO for cmp).
     branch = false;
 
-  if (branch)
+  if (js.op[1].branchIsFollowed)
+  {
+    // The block continues at the branch target, which is where we are going anyway.
+    if (!branch)
+    {
+      gpr.Flush();
+      fpr.Flush();
+      WriteExit(nextPC + 4);
+    }
+  }
+  else if (branch)
   {
     gpr.Flush();
     fpr.Flush();
@@ -474,6 +585,9 @@ void Jit64::cmpXX(UGeckoInstruction inst)
   int a = inst.RA;
   int b = inst.RB;
   u32 crf = inst.CRFD;
+  if (SkipDeadCRField(crf))
+    return;
+
   bool merge_branch = CheckMergedBranch(crf);
 
   OpArg comparand;
@@ -1465,7 +1579,7 @@ void Jit64::rlwinmx(UGeckoInstruction inst)
       SHL(32, gpr.R(a), Imm8(inst.SH));
       needs_sext = inst.SH + mask_size >= 32;
     }
-    else
+    else if (left_shift || right_shift)
     {
       if (a != s)
         MOV(32, gpr.R(a), gpr.R(s));
@@ -1474,25 +1588,24 @@ void Jit64::rlwinmx(UGeckoInstruction inst)
       {
         SHL(32, gpr.R(a), Imm8(inst.SH));
       }
-      else if (right_shift)
+      else
       {
         SHR(32, gpr.R(a), Imm8(inst.MB));
         needs_sext = false;
       }
-      else
+    }
+    else
+    {
+      RotateLeft(32, gpr.RX(a), gpr.R(s), inst.SH);
+      if (!(inst.MB == 0 && inst.ME == 31))
       {
-        if (inst.SH != 0)
-          ROL(32, gpr.R(a), Imm8(inst.SH));
-        if (!(inst.MB == 0 && inst.ME == 31))
-        {
-          // we need flags if we're merging the branch
-          if (inst.Rc && CheckMergedBranch(0))
-            AND(32, gpr.R(a), Imm32(mask));
-          else
-            AndWithMask(gpr.RX(a), mask);
-          needs_sext = inst.MB == 0;
-          needs_test = false;
-        }
+        // we need flags if we're merging the branch
+        if (inst.Rc && CheckMergedBranch(0))
+          AND(32, gpr.R(a), Imm32(mask));
+        else
+          AndWithMask(gpr.RX(a), mask);
+        needs_sext = inst.MB == 0;
+        needs_test = false;
       }
     }
     if (inst.Rc)
@@ -1527,10 +1640,7 @@ void Jit64::rlwimix(UGeckoInstruction inst)
     else if (mask == 0xFFFFFFFF)
     {
       gpr.BindToRegister(a, a == s, true);
-      if (a != s)
-        MOV(32, gpr.R(a), gpr.R(s));
-      if (inst.SH)
-        ROL(32, gpr.R(a), Imm8(inst.SH));
+      RotateLeft(32, gpr.RX(a), gpr.R(s), inst.SH);
       needs_test = true;
     }
     else if (gpr.R(s).IsImm())
@@ -1547,18 +1657,19 @@ void Jit64::rlwimix(UGeckoInstruction inst)
       {
         u32 maskA = gpr.R(a).Imm32() & ~mask;
         gpr.BindToRegister(a, false, true);
-        MOV(32, gpr.R(a), gpr.R(s));
         if (isLeftShift)
         {
+          MOV(32, gpr.R(a), gpr.R(s));
           SHL(32, gpr.R(a), Imm8(inst.SH));
         }
         else if (isRightShift)
         {
+          MOV(32, gpr.R(a), gpr.R(s));
           SHR(32, gpr.R(a), Imm8(32 - inst.SH));
         }
         else
         {
-          ROL(32, gpr.R(a), Imm8(inst.SH));
+          RotateLeft(32, gpr.RX(a), gpr.R(s), inst.SH);
           AND(32, gpr.R(a), Imm32(mask));
         }
         OR(32, gpr.R(a), Imm32(maskA));
@@ -1567,22 +1678,23 @@ void Jit64::rlwimix(UGeckoInstruction inst)
       {
         // TODO: common cases of this might be faster with pinsrb or abuse of AH
         gpr.BindToRegister(a, true, true);
-        MOV(32, R(RSCRATCH), gpr.R(s));
         if (isLeftShift)
         {
+          MOV(32, R(RSCRATCH), gpr.R(s));
           SHL(32, R(RSCRATCH), Imm8(inst.SH));
           AndWithMask(gpr.RX(a), ~mask);
           OR(32, gpr.R(a), R(RSCRATCH));
         }
         else if (isRightShift)
         {
+          MOV(32, R(RSCRATCH), gpr.R(s));
           SHR(32, R(RSCRATCH), Imm8(32 - inst.SH));
           AndWithMask(gpr.RX(a), ~mask);
           OR(32, gpr.R(a), R(RSCRATCH));
         }
         else
         {
-          ROL(32, R(RSCRATCH), Imm8(inst.SH));
+          RotateLeft(32, RSCRATCH, gpr.R(s), inst.SH);
           XOR(32, R(RSCRATCH), gpr.R(a));
           AndWithMask(RSCRATCH, mask);
           XOR(32, gpr.R(a), R(RSCRATCH));
@@ -1678,6 +1790,20 @@ void Jit64::srwx(UGeckoInstruction inst)
     u32 amount = gpr.R(b).Imm32();
     gpr.SetImmediate32(a, (amount & 0x20) ? 0 : (gpr.R(s).Imm32() >> (amount & 0x1f)));
   }
+  else if (cpu_info.bBMI2)
+  {
+    gpr.Lock(a, b, s);
+    gpr.BindToRegister(a, a == s || a == b, true);
+    X64Reg amount = ShiftAmountReg(b);
+    // This is a 64-bit shift, so the source must be a zero-extended register rather than memory.
+    OpArg src = gpr.R(s);
+    if (!src.IsSimpleReg())
+    {
+      MOV(32, R(RSCRATCH), src);
+      src = R(RSCRATCH);
+    }
+    SHRX(64, gpr.RX(a), src, amount);
+  }
   else
   {
     // no register choice
@@ -1715,14 +1841,30 @@ void Jit64::slwx(UGeckoInstruction inst)
   }
   else
   {
-    // no register choice
-    gpr.FlushLockX(ECX);
-    gpr.Lock(a, b, s);
-    MOV(32, R(ECX), gpr.R(b));
-    gpr.BindToRegister(a, a == s, true);
-    if (a != s)
-      MOV(32, gpr.R(a), gpr.R(s));
-    SHL(64, gpr.R(a), R(ECX));
+    if (cpu_info.bBMI2)
+    {
+      gpr.Lock(a, b, s);
+      gpr.BindToRegister(a, a == s || a == b, true);
+      X64Reg amount = ShiftAmountReg(b);
+      OpArg src = gpr.R(s);
+      if (!src.IsSimpleReg())
+      {
+        MOV(32, R(RSCRATCH), src);
+        src = R(RSCRATCH);
+      }
+      SHLX(64, gpr.RX(a), src, amount);
+    }
+    else
+    {
+      // no register choice
+      gpr.FlushLockX(ECX);
+      gpr.Lock(a, b, s);
+      MOV(32, R(ECX), gpr.R(b));
+      gpr.BindToRegister(a, a == s, true);
+      if (a != s)
+        MOV(32, gpr.R(a), gpr.R(s));
+      SHL(64, gpr.R(a), R(ECX));
+    }
     if (inst.Rc)
     {
       AND(32, gpr.R(a), gpr.R(a));
@@ -1746,14 +1888,32 @@ void Jit64::srawx(UGeckoInstruction inst)
   int b = inst.RB;
   int s = inst.RS;
 
-  gpr.FlushLockX(ECX);
-  gpr.Lock(a, s, b);
-  gpr.BindToRegister(a, (a == s || a == b), true);
-  MOV(32, R(ECX), gpr.R(b));
-  if (a != s)
-    MOV(32, gpr.R(a), gpr.R(s));
-  SHL(64, gpr.R(a), Imm8(32));
-  SAR(64, gpr.R(a), R(ECX));
+  if (cpu_info.bBMI2)
+  {
+    gpr.Lock(a, s, b);
+    gpr.BindToRegister(a, (a == s || a == b), true);
+    // The amount has to survive the shift below, which clobbers a.
+    X64Reg amount = RSCRATCH2;
+    if (a != b && gpr.R(b).IsSimpleReg())
+      amount = gpr.RX(b);
+    else
+      MOV(32, R(RSCRATCH2), gpr.R(b));
+    if (a != s)
+      MOV(32, gpr.R(a), gpr.R(s));
+    SHL(64, gpr.R(a), Imm8(32));
+    SARX(64, gpr.RX(a), gpr.R(a), amount);
+  }
+  else
+  {
+    gpr.FlushLockX(ECX);
+    gpr.Lock(a, s, b);
+    gpr.BindToRegister(a, (a == s || a == b), true);
+    MOV(32, R(ECX), gpr.R(b));
+    if (a != s)
+      MOV(32, gpr.R(a), gpr.R(s));
+    SHL(64, gpr.R(a), Imm8(32));
+    SAR(64, gpr.R(a), R(ECX));
+  }
   if (js.op->wantsCA)
   {
     MOV(32, R(RSCRATCH), gpr.R(a));
@@ -25,6 +25,26 @@
 
 using namespace Gen;
 
+int Jit64::KnownAddressFlags(int accessSize) const
+{
+  return IsKnownRAMAccess(*js.op, accessSize) ? SAFE_LOADSTORE_KNOWN_RAM : 0;
+}
+
+bool Jit64::IsKnownRAMAccess(const PPCAnalyst::CodeOp& op, int accessSize) const
+{
+  if (!op.addressKnownMask)
+    return false;
+
+  // The lowest and highest addresses the access can touch.
+  const u32 lowest = op.addressKnownBits;
+  const u32 highest = op.addressKnownBits | ~op.addressKnownMask;
+  const u32 size = accessSize >> 3;
+  if (highest > 0xFFFFFFFF - (size - 1))
+    return false;
+
+  return PowerPC::IsOptimizableRAMRange(lowest, highest + size - 1);
+}
+
 void Jit64::lXXx(UGeckoInstruction inst)
 {
   INSTRUCTION_START
@@ -164,7 +184,15 @@ void Jit64::lXXx(UGeckoInstruction inst)
 
   // Prepare address operand
   OpArg opAddress;
-  if (!update && !a)
+  if (js.op->HasConstantAddress() && !jo.memcheck && !(update && (a == 0 || d == a)))
+  {
+    // The register cache may have lost track of the constant (across an interpreter fallback,
+    // for example), but the analyzer hasn't.
+    opAddress = Imm32(js.op->addressKnownBits);
+    if (update)
+      gpr.SetImmediate32(a, js.op->addressKnownBits);
+  }
+  else if (!update && !a)
   {
     if (inst.OPCD == 31)
     {
@@ -254,7 +282,8 @@ void Jit64::lXXx(UGeckoInstruction inst)
   if (update && storeAddress)
     registersInUse[RSCRATCH2] = true;
 
-  SafeLoadToReg(gpr.RX(d), opAddress, accessSize, loadOffset, registersInUse, signExtend);
+  SafeLoadToReg(gpr.RX(d), opAddress, accessSize, loadOffset, registersInUse, signExtend,
+                KnownAddressFlags(accessSize));
 
   if (update && storeAddress)
     MOV(32, gpr.R(a), opAddress);
@@ -406,9 +435,10 @@ void Jit64::stX(UGeckoInstruction inst)
   }
 
   // If we already know the address of the write
-  if (!a || gpr.R(a).IsImm())
+  if (!a || gpr.R(a).IsImm() || js.op->HasConstantAddress())
   {
-    u32 addr = (a ? gpr.R(a).Imm32() : 0) + offset;
+    u32 addr = js.op->HasConstantAddress() ? js.op->addressKnownBits :
+                                             (a ? gpr.R(a).Imm32() : 0) + offset;
     bool exception = WriteToConstAddress(accessSize, gpr.R(s), addr, CallerSavedRegistersInUse());
     if (update)
     {
@@ -431,7 +461,8 @@ void Jit64::stX(UGeckoInstruction inst)
     if (gpr.R(s).IsImm())
     {
       SafeWriteRegToReg(gpr.R(s), gpr.RX(a), accessSize, offset, CallerSavedRegistersInUse(),
-                        SAFE_LOADSTORE_CLOBBER_RSCRATCH_INSTEAD_OF_ADDR);
+                        SAFE_LOADSTORE_CLOBBER_RSCRATCH_INSTEAD_OF_ADDR |
+                            KnownAddressFlags(accessSize));
     }
     else
     {
@@ -447,7 +478,8 @@ void Jit64::stX(UGeckoInstruction inst)
         reg_value = gpr.RX(s);
       }
       SafeWriteRegToReg(reg_value, gpr.RX(a), accessSize, offset, CallerSavedRegistersInUse(),
-                        SAFE_LOADSTORE_CLOBBER_RSCRATCH_INSTEAD_OF_ADDR);
+                        SAFE_LOADSTORE_CLOBBER_RSCRATCH_INSTEAD_OF_ADDR |
+                            KnownAddressFlags(accessSize));
     }
 
     if (update)
@@ -466,13 +498,6 @@ void Jit64::stXx(UGeckoInstruction inst)
   bool byte_reverse = !!(inst.SUBOP10 & 512);
   FALLBACK_IF(!a || (update && a == s) || (update && jo.memcheck && a == b));
 
-  gpr.Lock(a, b, s);
-
-  if (update)
-    gpr.BindToRegister(a, true, true);
-
-  MOV_sum(32, RSCRATCH2, gpr.R(a), gpr.R(b));
-
   int accessSize;
   switch (inst.SUBOP10 & ~32)
   {
@@ -493,13 +518,30 @@ void Jit64::stXx(UGeckoInstruction inst)
     break;
   }
 
+  // WriteToConstAddress always swaps.
+  if (js.op->HasConstantAddress() && !byte_reverse && !(update && jo.memcheck))
+  {
+    const u32 addr = js.op->addressKnownBits;
+    WriteToConstAddress(accessSize, gpr.R(s), addr, CallerSavedRegistersInUse());
+    if (update)
+      gpr.SetImmediate32(a, addr);
+    return;
+  }
+
+  gpr.Lock(a, b, s);
+
+  if (update)
+    gpr.BindToRegister(a, true, true);
+
+  MOV_sum(32, RSCRATCH2, gpr.R(a), gpr.R(b));
+
+  const int flags = (byte_reverse ? SAFE_LOADSTORE_NO_SWAP : 0) | KnownAddressFlags(accessSize);
   if (gpr.R(s).IsImm())
   {
     BitSet32 registersInUse = CallerSavedRegistersInUse();
     if (update)
       registersInUse[RSCRATCH2] = true;
-    SafeWriteRegToReg(gpr.R(s), RSCRATCH2, accessSize, 0, registersInUse,
-                      byte_reverse ? SAFE_LOADSTORE_NO_SWAP : 0);
+    SafeWriteRegToReg(gpr.R(s), RSCRATCH2, accessSize, 0, registersInUse, flags);
   }
   else
   {
@@ -517,8 +559,7 @@ void Jit64::stXx(UGeckoInstruction inst)
     BitSet32 registersInUse = CallerSavedRegistersInUse();
     if (update)
       registersInUse[RSCRATCH2] = true;
-    SafeWriteRegToReg(reg_value, RSCRATCH2, accessSize, 0, registersInUse,
-                      byte_reverse ? SAFE_LOADSTORE_NO_SWAP : 0);
+    SafeWriteRegToReg(reg_value, RSCRATCH2, accessSize, 0, registersInUse, flags);
   }
 
   if (update)
@@ -69,7 +69,8 @@ void Jit64::lfXXX(UGeckoInstruction inst)
   BitSet32 registersInUse = CallerSavedRegistersInUse();
   if (update && jo.memcheck)
     registersInUse[RSCRATCH2] = true;
-  SafeLoadToReg(RSCRATCH, addr, single ? 32 : 64, offset, registersInUse, false);
+  SafeLoadToReg(RSCRATCH, addr, single ? 32 : 64, offset, registersInUse, false,
+                KnownAddressFlags(single ? 32 : 64));
 
   if (single)
   {
@@ -124,9 +125,10 @@ void Jit64::stfXXX(UGeckoInstruction inst)
       MOV(64, R(RSCRATCH), fpr.R(s));
   }
 
-  if (!indexed && (!a || gpr.R(a).IsImm()))
+  const bool constant_address = js.op->HasConstantAddress() && !(update && jo.memcheck);
+  if (constant_address || (!indexed && (!a || gpr.R(a).IsImm())))
   {
-    u32 addr = (a ? gpr.R(a).Imm32() : 0) + imm;
+    u32 addr = constant_address ? js.op->addressKnownBits : (a ? gpr.R(a).Imm32() : 0) + imm;
     bool exception =
         WriteToConstAddress(accessSize, R(RSCRATCH), addr, CallerSavedRegistersInUse());
 
@@ -173,7 +175,8 @@ void Jit64::stfXXX(UGeckoInstruction inst)
   if (update)
     registersInUse[RSCRATCH2] = true;
 
-  SafeWriteRegToReg(RSCRATCH, RSCRATCH2, accessSize, offset, registersInUse);
+  SafeWriteRegToReg(RSCRATCH, RSCRATCH2, accessSize, offset, registersInUse,
+                    KnownAddressFlags(accessSize));
 
   if (update)
     MOV(32, gpr.R(a), R(RSCRATCH2));
@@ -15,7 +15,13 @@ JitBlockCache::JitBlockCache(JitBase& jit) : JitBaseBlockCache{jit}
 void JitBlockCache::WriteLinkBlock(const JitBlock::LinkData& source, const JitBlock* dest)
 {
   u8* location = source.exitPtrs;
-  const u8* address = dest ? dest->checkedEntry : m_jit.GetAsmRoutines()->dispatcher;
+  const u8* address = m_jit.GetAsmRoutines()->dispatcher;
+  if (dest)
+  {
+    // Exits that have set up the destination's entry registers can skip loading them again.
+    const bool hinted = source.entry_layout != 0 && source.entry_layout == dest->entry_layout;
+    address = hinted ? dest->hintedEntry : dest->checkedEntry;
+  }
   Gen::XEmitter emit(location);
   if (*location == 0xE8)
   {
@@ -41,4 +47,9 @@ void JitBlockCache::WriteDestroyBlock(const JitBlock& block)
   emit.INT3();
   Gen::XEmitter emit2(const_cast<u8*>(block.normalEntry));
   emit2.INT3();
+  if (block.hintedEntry)
+  {
+    Gen::XEmitter emit3(const_cast<u8*>(block.hintedEntry));
+    emit3.INT3();
+  }
 }
@@ -4,7 +4,11 @@
 
 #include "Core/PowerPC/Jit64Common/EmuCodeBlock.h"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <functional>
+#include <iterator>
 #include <limits>
 
 #include "Common/Assert.h"
@@ -114,6 +118,58 @@ FixupBranch EmuCodeBlock::CheckIfSafeAddress(const OpArg& reg_value, X64Reg reg_
   return J_CC(CC_Z, m_far_code.Enabled());
 }
 
+FixupBranch EmuCodeBlock::FastTLBAccess(X64Reg reg_addr, X64Reg reg_value, int accessSize,
+                                        bool write, BitSet32 registers_in_use,
+                                        const std::function<void(const OpArg&)>& access)
+{
+  static_assert(sizeof(PowerPC::FastTLBEntry) == 16, "The index below is scaled by 16");
+  constexpr std::array<X64Reg, 3> scratch_regs = {{RSCRATCH_EXTRA, RSCRATCH2, RSCRATCH}};
+  const X64Reg reg_offset = *std::find_if(scratch_regs.begin(), scratch_regs.end(), [&](X64Reg r) {
+    return r != reg_addr && r != reg_value;
+  });
+  const X64Reg reg_tag = *std::find_if(scratch_regs.begin(), scratch_regs.end(), [&](X64Reg r) {
+    return r != reg_addr && r != reg_offset;
+  });
+  if (reg_value != INVALID_REG)
+    registers_in_use[reg_value] = true;
+  const bool push_offset = registers_in_use[reg_offset];
+  const bool push_tag = registers_in_use[reg_tag];
+
+  const s32 fast_tlb_offset =
+      (s32)((char*)&PowerPC::ppcState.fast_tlb - (char*)&PowerPC::ppcState) - 0x80;
+  const s32 tag_offset = write ? offsetof(PowerPC::FastTLBEntry, write_tag) :
+                                 offsetof(PowerPC::FastTLBEntry, read_tag);
+
+  if (push_offset)
+    PUSH(reg_offset);
+  MOV(32, R(reg_offset), R(reg_addr));
+  SHR(32, R(reg_offset), Imm8(12 - 4));
+  AND(32, R(reg_offset), Imm32((PowerPC::FAST_TLB_SIZE - 1) << 4));
+
+  // Tag with the page of the last byte accessed, so that accesses crossing a page boundary miss.
+  if (push_tag)
+    PUSH(reg_tag);
+  LEA(32, reg_tag, MDisp(reg_addr, accessSize / 8 - 1));
+  AND(32, R(reg_tag), Imm32(~0xFFFu));
+  CMP(32, R(reg_tag), MComplex(RPPCSTATE, reg_offset, SCALE_1, fast_tlb_offset + tag_offset));
+  if (push_tag)
+    POP(reg_tag);
+  FixupBranch miss = J_CC(CC_NE);
+
+  MOV(64, R(reg_offset),
+      MComplex(RPPCSTATE, reg_offset, SCALE_1,
+               fast_tlb_offset + (s32)offsetof(PowerPC::FastTLBEntry, host_offset)));
+  access(MRegSum(reg_offset, reg_addr));
+  if (push_offset)
+    POP(reg_offset);
+  FixupBranch hit = J(true);
+
+  SetJumpTarget(miss);
+  if (push_offset)
+    POP(reg_offset);
+  return hit;
+}
+
 void EmuCodeBlock::UnsafeLoadRegToReg(X64Reg reg_addr, X64Reg reg_value, int accessSize, s32 offset,
                                       bool signExtend)
 {
@@ -311,12 +367,130 @@ void EmuCodeBlock::MMIOLoadToReg(MMIO::Mapping* mmio, Gen::X64Reg reg_value,
   }
 }
 
+// Visitor that generates code to write a MMIO value.
+template <typename T>
+class MMIOWriteCodeGenerator : public MMIO::WriteHandlingMethodVisitor<T>
+{
+public:
+  MMIOWriteCodeGenerator(Gen::X64CodeBlock* code, BitSet32 registers_in_use,
+                         const Gen::OpArg& value, u32 address)
+      : m_code(code), m_registers_in_use(registers_in_use), m_value(value), m_address(address)
+  {
+  }
+
+  void VisitNop() override
+  {
+    // Do nothing
+  }
+  void VisitDirect(T* addr, u32 mask) override { WriteRegToAddr(8 * sizeof(T), addr, mask); }
+  void VisitComplex(const std::function<void(u32, T)>* lambda) override
+  {
+    CallLambda(8 * sizeof(T), lambda);
+  }
+
+private:
+  void WriteRegToAddr(int sbits, void* ptr, u32 mask)
+  {
+    u32 all_ones = (1ULL << sbits) - 1;
+    if (m_value.IsImm())
+    {
+      const u32 value = m_value.AsImm32().Imm32() & mask & all_ones;
+      m_code->MOV(64, R(RSCRATCH2), ImmPtr(ptr));
+      switch (sbits)
+      {
+      case 8:
+        m_code->MOV(8, MatR(RSCRATCH2), Imm8(value));
+        break;
+      case 16:
+        m_code->MOV(16, MatR(RSCRATCH2), Imm16(value));
+        break;
+      case 32:
+        m_code->MOV(32, MatR(RSCRATCH2), Imm32(value));
+        break;
+      }
+      return;
+    }
+
+    // If we do not need to mask, we can store the value register directly.
+    X64Reg reg;
+    if ((all_ones & mask) == all_ones && m_value.IsSimpleReg() && !m_value.IsSimpleReg(RSCRATCH2))
+    {
+      reg = m_value.GetSimpleReg();
+    }
+    else
+    {
+      m_code->MOV(sbits, R(RSCRATCH), m_value);
+      if ((all_ones & mask) != all_ones)
+        m_code->AND(32, R(RSCRATCH), Imm32(mask));
+      reg = RSCRATCH;
+    }
+    m_code->MOV(64, R(RSCRATCH2), ImmPtr(ptr));
+    m_code->MOV(sbits, MatR(RSCRATCH2), R(reg));
+  }
+
+  void CallLambda(int sbits, const std::function<void(u32, T)>* lambda)
+  {
+    // Helps external systems know which instruction triggered the write
+    m_code->MOV(32, PPCSTATE(pc), Imm32(g_jit->js.compilerPC));
+
+    m_code->ABI_PushRegistersAndAdjustStack(m_registers_in_use, 0);
+    m_code->ABI_CallLambdaCA(sbits, lambda, m_address, m_value);
+    m_code->ABI_PopRegistersAndAdjustStack(m_registers_in_use, 0);
+  }
+
+  Gen::X64CodeBlock* m_code;
+  BitSet32 m_registers_in_use;
+  Gen::OpArg m_value;
+  u32 m_address;
+};
+
+void EmuCodeBlock::MMIOWriteRegToAddr(MMIO::Mapping* mmio, const Gen::OpArg& value,
+                                      BitSet32 registers_in_use, u32 address, int access_size)
+{
+  switch (access_size)
+  {
+  case 8:
+  {
+    MMIOWriteCodeGenerator<u8> gen(this, registers_in_use, value, address);
+    mmio->GetHandlerForWrite<u8>(address).Visit(gen);
+    break;
+  }
+  case 16:
+  {
+    MMIOWriteCodeGenerator<u16> gen(this, registers_in_use, value, address);
+    mmio->GetHandlerForWrite<u16>(address).Visit(gen);
+    break;
+  }
+  case 32:
+  {
+    MMIOWriteCodeGenerator<u32> gen(this, registers_in_use, value, address);
+    mmio->GetHandlerForWrite<u32>(address).Visit(gen);
+    break;
+  }
+  }
+}
+
 void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg& opAddress, int accessSize,
                                  s32 offset, BitSet32 registersInUse, bool signExtend, int flags)
 {
   bool slowmem = (flags & SAFE_LOADSTORE_FORCE_SLOWMEM) != 0;
 
   registersInUse[reg_value] = false;
+  if ((flags & SAFE_LOADSTORE_KNOWN_RAM) && !slowmem)
+  {
+    UnsafeLoadToReg(reg_value, opAddress, accessSize, offset, signExtend);
+    return;
+  }
+
+  // Constant addresses get their RAM or MMIO access inlined, rather than going through fastmem
+  // and faulting into a trampoline if they turn out not to be RAM.
+  if (opAddress.IsImm() && !slowmem)
+  {
+    u32 address = opAddress.Imm32() + offset;
+    SafeLoadToRegImmediate(reg_value, address, accessSize, registersInUse, signExtend);
+    return;
+  }
+
   if (g_jit->jo.fastmem && !(flags & SAFE_LOADSTORE_NO_FASTMEM) && !slowmem)
   {
     u8* backpatchStart = GetWritableCodePtr();
@@ -376,6 +550,18 @@ void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg& opAddress,
       exit = J(true);
     SetJumpTarget(slow);
   }
+
+  // With the MMU on, most accesses that aren't BAT mapped can still skip the page table walk.
+  FixupBranch fast_tlb_hit;
+  bool probe_fast_tlb = dr_set && g_jit->jo.fastTLB;
+  if (probe_fast_tlb)
+  {
+    fast_tlb_hit = FastTLBAccess(reg_addr, INVALID_REG, accessSize, false, registersInUse,
+                                 [&](const OpArg& src) {
+                                   LoadAndSwap(accessSize, reg_value, src, signExtend);
+                                 });
+  }
+
   size_t rsp_alignment = (flags & SAFE_LOADSTORE_NO_PROLOG) ? 8 : 0;
   ABI_PushRegistersAndAdjustStack(registersInUse, rsp_alignment);
   switch (accessSize)
@@ -406,6 +592,9 @@ void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg& opAddress,
     MOVZX(64, accessSize, reg_value, R(ABI_RETURN));
   }
 
+  if (probe_fast_tlb)
+    SetJumpTarget(fast_tlb_hit);
+
   if (fast_check_address)
   {
     if (m_far_code.Enabled())
@@ -476,6 +665,12 @@ void EmuCodeBlock::SafeWriteRegToReg(OpArg reg_value, X64Reg reg_addr, int acces
   // set the correct immediate format
   reg_value = FixImmediate(accessSize, reg_value);
 
+  if ((flags & SAFE_LOADSTORE_KNOWN_RAM) && !slowmem)
+  {
+    UnsafeWriteRegToReg(reg_value, reg_addr, accessSize, offset, swap);
+    return;
+  }
+
   if (g_jit->jo.fastmem && !(flags & SAFE_LOADSTORE_NO_FASTMEM) && !slowmem)
   {
     u8* backpatchStart = GetWritableCodePtr();
@@ -532,6 +727,29 @@ void EmuCodeBlock::SafeWriteRegToReg(OpArg reg_value, X64Reg reg_addr, int acces
     SetJumpTarget(slow);
   }
 
+  FixupBranch fast_tlb_hit;
+  bool probe_fast_tlb = dr_set && g_jit->jo.fastTLB;
+  if (probe_fast_tlb)
+  {
+    X64Reg value_reg = reg_value.IsSimpleReg() ? reg_value.GetSimpleReg() : INVALID_REG;
+    fast_tlb_hit = FastTLBAccess(reg_addr, value_reg, accessSize, true, registersInUse,
+                                 [&](const OpArg& dest) {
+                                   if (reg_value.IsImm())
+                                   {
+                                     MOV(accessSize, dest,
+                                         swap ? SwapImmediate(accessSize, reg_value) : reg_value);
+                                   }
+                                   else if (swap)
+                                   {
+                                     SwapAndStore(accessSize, dest, value_reg);
+                                   }
+                                   else
+                                   {
+                                     MOV(accessSize, dest, reg_value);
+                                   }
+                                 });
+  }
+
   // PC is used by memory watchpoints (if enabled) or to print accurate PC locations in debug logs
   MOV(32, PPCSTATE(pc), Imm32(g_jit->js.compilerPC));
 
@@ -569,6 +787,9 @@ void EmuCodeBlock::SafeWriteRegToReg(OpArg reg_value, X64Reg reg_addr, int acces
 
   MemoryExceptionCheck();
 
+  if (probe_fast_tlb)
+    SetJumpTarget(fast_tlb_hit);
+
   if (fast_check_address)
   {
     if (m_far_code.Enabled())
@@ -623,6 +844,15 @@ bool EmuCodeBlock::WriteToConstAddress(int accessSize, OpArg arg, u32 address,
     WriteToConstRamAddress(accessSize, arg, address);
     return false;
   }
+
+  // If the address maps to an MMIO register, inline MMIO write code. The whole page of the
+  // gather pipe is handled as the gather pipe by the generic path, so leave it alone.
+  const u32 mmio_address = PowerPC::IsOptimizableMMIOAccess(address, accessSize);
+  if (accessSize != 64 && mmio_address && (mmio_address & 0xFFFFF000) != 0x0C008000)
+  {
+    MMIOWriteRegToAddr(Memory::mmio_mapping.get(), arg, registersInUse, mmio_address, accessSize);
+    return false;
+  }
   else
   {
     // Helps external systems know which instruction triggered the write
@@ -1136,3 +1366,23 @@ void EmuCodeBlock::Clear()
   m_back_patch_info.clear();
   m_exception_handler_at_loc.clear();
 }
+
+void EmuCodeBlock::ClearCodeRegion(size_t index)
+{
+  // Loads and stores can be emitted into far code as well, so both halves of the region go.
+  const u8* start = GetRegionStart(index);
+  const u8* end = GetRegionEnd(index);
+  const u8* far_start = m_far_code.GetRegionStart(index);
+  const u8* far_end = m_far_code.GetRegionEnd(index);
+  const auto in_region = [=](const u8* ptr) {
+    return (ptr >= start && ptr < end) || (ptr >= far_start && ptr < far_end);
+  };
+
+  for (auto it = m_back_patch_info.begin(); it != m_back_patch_info.end();)
+    it = in_region(it->first) ? m_back_patch_info.erase(it) : std::next(it);
+  for (auto it = m_exception_handler_at_loc.begin(); it != m_exception_handler_at_loc.end();)
+  {
+    const bool stale = in_region(it->first) || (it->second && in_region(it->second));
+    it = stale ? m_exception_handler_at_loc.erase(it) : std::next(it);
+  }
+}
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <functional>
 #include <unordered_map>
 
 #include "Common/BitSet.h"
@@ -49,6 +50,12 @@ public:
 
   Gen::FixupBranch CheckIfSafeAddress(const Gen::OpArg& reg_value, Gen::X64Reg reg_addr,
                                       BitSet32 registers_in_use);
+  // Looks the page of reg_addr up in the fast TLB and, on a hit, calls access with the host
+  // address and jumps to the returned branch. Falls through on a miss. reg_value (if valid) and
+  // the registers in use are preserved.
+  Gen::FixupBranch FastTLBAccess(Gen::X64Reg reg_addr, Gen::X64Reg reg_value, int accessSize,
+                                 bool write, BitSet32 registers_in_use,
+                                 const std::function<void(const Gen::OpArg&)>& access);
   void UnsafeLoadRegToReg(Gen::X64Reg reg_addr, Gen::X64Reg reg_value, int accessSize,
                           s32 offset = 0, bool signExtend = false);
   void UnsafeLoadRegToRegNoSwap(Gen::X64Reg reg_addr, Gen::X64Reg reg_value, int accessSize,
@@ -66,6 +73,8 @@ public:
   // call for known addresses in MMIO range (MMIO::IsMMIOAddress).
   void MMIOLoadToReg(MMIO::Mapping* mmio, Gen::X64Reg reg_value, BitSet32 registers_in_use,
                      u32 address, int access_size, bool sign_extend);
+  void MMIOWriteRegToAddr(MMIO::Mapping* mmio, const Gen::OpArg& value, BitSet32 registers_in_use,
+                          u32 address, int access_size);
 
   enum SafeLoadStoreFlags
   {
@@ -77,6 +86,9 @@ public:
     // Force slowmem (used when generating fallbacks in trampolines)
     SAFE_LOADSTORE_FORCE_SLOWMEM = 16,
     SAFE_LOADSTORE_DR_ON = 32,
+    // The whole range the address can be in is known to be RAM (PowerPC::IsOptimizableRAMRange),
+    // so the access needs neither a check nor backpatching
+    SAFE_LOADSTORE_KNOWN_RAM = 64,
   };
 
   void SafeLoadToReg(Gen::X64Reg reg_value, const Gen::OpArg& opAddress, int accessSize, s32 offset,
@@ -121,6 +133,8 @@ public:
   void ConvertDoubleToSingle(Gen::X64Reg dst, Gen::X64Reg src);
   void SetFPRF(Gen::X64Reg xmm);
   void Clear();
+  // Forgets the backpatching information of the near and far code in the given code region.
+  void ClearCodeRegion(size_t index);
 
 protected:
   ConstantPool m_const_pool;
@@ -71,7 +71,12 @@ bool Jitx86Base::BackPatch(u32 emAddress, SContext* ctx)
   js.generatingTrampoline = true;
   js.trampolineExceptionHandler = exceptionHandler;
 
-  // Generate the trampoline.
+  // Generate the trampoline. It goes into the region of the code it belongs to, so that both
+  // are recycled together. Regions are looked up in the near code, which is the only place
+  // fastmem accesses are emitted; far code is recycled along with it but laid out differently.
+  _assert_msg_(DYNA_REC, IsInSpace(info.start),
+               "BackPatch: memory access at %p is not in near code", info.start);
+  trampolines.SwitchToRegion(GetRegionOf(info.start));
   const u8* trampoline = trampolines.GenerateTrampoline(info);
   js.generatingTrampoline = false;
   js.trampolineExceptionHandler = nullptr;
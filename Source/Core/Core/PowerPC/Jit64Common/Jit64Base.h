@@ -33,6 +33,10 @@ constexpr Gen::X64Reg RMEM = Gen::RBX;
 constexpr Gen::X64Reg RPPCSTATE = Gen::RBP;
 
 constexpr size_t CODE_SIZE = 1024 * 1024 * 32;
+// With code space recycling, the near code, far code and trampoline caches are split into this
+// many regions. A block keeps all of its code in regions with the same index, so that a region
+// can be recycled without touching the code of blocks in other regions.
+constexpr size_t NUM_CODE_REGIONS = 4;
 
 class Jitx86Base : public JitBase, public QuantizedMemoryRoutines
 {
@@ -44,6 +48,7 @@ protected:
 public:
   JitBlockCache* GetBlockCache() override { return &blocks; }
   bool HandleFault(uintptr_t access_address, SContext* ctx) override;
+  bool IsInCodeSpace(const u8* ptr) const override { return IsInSpace(ptr); }
 };
 
 void LogGeneratedX86(size_t size, const PPCAnalyst::CodeBuffer* code_buffer, const u8* normalEntry,
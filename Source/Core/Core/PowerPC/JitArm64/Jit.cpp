@@ -4,10 +4,12 @@
 
 #include "Core/PowerPC/JitArm64/Jit.h"
 
+#include <cinttypes>
 #include <cstdio>
 
 #include "Common/Arm64Emitter.h"
 #include "Common/CommonTypes.h"
+#include "Common/JitRegister.h"
 #include "Common/Logging/Log.h"
 #include "Common/MathUtil.h"
 #include "Common/PerformanceCounter.h"
@@ -57,6 +59,17 @@ void JitArm64::Init()
   analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CARRY_MERGE);
   analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_BRANCH_FOLLOW);
 
+  m_num_dead_flags_eliminated = 0;
+  m_num_gqr_speculations = 0;
+  m_num_gqr_guard_failures = 0;
+  m_trace_profile.Init();
+  if (m_trace_profile.IsEnabled())
+  {
+    analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_HOT_BRANCH_FOLLOW);
+    analyzer.SetBranchPredictor(
+        [this](u32 address) { return m_trace_profile.IsBranchLikelyTaken(address); });
+  }
+
   m_enable_blr_optimization = jo.enableBlocklink && SConfig::GetInstance().bFastmem &&
                               !SConfig::GetInstance().bEnableDebugging;
   m_cleanup_after_stackfault = false;
@@ -128,7 +141,12 @@ void JitArm64::ClearCache()
 void JitArm64::Shutdown()
 {
   FreeCodeSpace();
+  INFO_LOG(DYNA_REC, "%" PRIu64 " dead CR/CA computations eliminated",
+           m_num_dead_flags_eliminated);
+  INFO_LOG(DYNA_REC, "%" PRIu64 " blocks speculated on GQR values, %" PRIu64 " guards failed",
+           m_num_gqr_speculations, m_num_gqr_guard_failures);
   blocks.Shutdown();
+  m_trace_profile.Shutdown();
   FreeStack();
 }
 
@@ -291,6 +309,38 @@ void JitArm64::FreeStack()
 #endif
 }
 
+void JitArm64::WriteBranchCounter(const PPCAnalyst::CodeOp& op, bool taken)
+{
+  if (!analyzer.HasOption(PPCAnalyst::PPCAnalyzer::OPTION_HOT_BRANCH_FOLLOW) ||
+      op.branchIsFollowed || !JitTraceProfile::IsTraceableBranch(op.inst))
+  {
+    return;
+  }
+
+  JitTraceProfile::Edge* edge = m_trace_profile.GetEdge(op.address);
+  ARM64Reg WA = gpr.GetReg();
+  ARM64Reg XA = EncodeRegTo64(WA);
+  ARM64Reg WB = gpr.GetReg();
+  MOVP2R(XA, taken ? &edge->taken : &edge->not_taken);
+  LDR(INDEX_UNSIGNED, WB, XA, 0);
+  ADD(WB, WB, 1);
+  STR(INDEX_UNSIGNED, WB, XA, 0);
+
+  if (taken)
+  {
+    // The taken path is about to leave the block, so registers have been flushed already.
+    ANDI2R(WB, WB, JitTraceProfile::RETRACE_INTERVAL - 1);
+    FixupBranch skip = CBNZ(WB);
+    MOVP2R(X0, &m_trace_profile);
+    MOVI2R(W1, op.address);
+    MOVP2R(X30, &JitTraceProfile::OnTakenBranch);
+    BLR(X30);
+    SetJumpTarget(skip);
+  }
+
+  gpr.Unlock(WA, WB);
+}
+
 void JitArm64::WriteExit(u32 destination, bool LK, u32 exit_address_after_return)
 {
   Cleanup();
@@ -548,6 +598,10 @@ void JitArm64::Jit(u32)
 #endif
   }
 
+  // The block we were asked for may be among the ones compiled ahead of time.
+  if (blocks.WarmUp() && blocks.GetBlockFromStartAddress(PowerPC::ppcState.pc, MSR))
+    return;
+
   if (IsAlmostFull() || farcode.IsAlmostFull() || SConfig::GetInstance().bJITNoBlockCache)
   {
     ClearCache();
@@ -569,6 +623,9 @@ void JitArm64::Jit(u32)
 
   if (code_block.m_memory_exception)
   {
+    if (blocks.IsWarmingUp())
+      return;
+
     // Address of instruction could not be translated
     NPC = nextPC;
     PowerPC::ppcState.Exceptions |= EXCEPTION_ISI;
@@ -600,6 +657,8 @@ void JitArm64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock*
   js.skipInstructions = 0;
   js.curBlock = b;
   js.carryFlagSet = false;
+  js.codeLines.clear();
+  const u8* far_start = farcode.GetCodePtr();
 
   PPCAnalyst::CodeOp* ops = code_buf->codebuffer;
 
@@ -644,6 +703,7 @@ void JitArm64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock*
       SwitchToNearCode();
       SetJumpTarget(no_fail);
       js.assumeNoPairedQuantize = true;
+      ++m_num_gqr_speculations;
     }
   }
 
@@ -656,6 +716,8 @@ void JitArm64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock*
     js.compilerPC = ops[i].address;
     js.op = &ops[i];
     js.instructionNumber = i;
+    if (JitRegister::IsEnabled())
+      js.codeLines.push_back({GetCodePtr(), i + 1});
     js.instructionsLeft = (code_block.m_num_instructions - 1) - i;
     const GekkoOPInfo* opinfo = ops[i].opinfo;
     js.downcountAmount += opinfo->numCycles;
@@ -794,6 +856,9 @@ void JitArm64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock*
   b->codeSize = (u32)(GetCodePtr() - start);
   b->originalSize = code_block.m_num_instructions;
 
+  if (JitRegister::IsEnabled() && farcode.GetCodePtr() > far_start)
+    JitRegister::Register(far_start, farcode.GetCodePtr(), "JIT_PPC_FAR_%08x", em_address);
+
   FlushIcache();
   farcode.FlushIcache();
 }
@@ -27,7 +27,7 @@ public:
   void Shutdown() override;
 
   JitBaseBlockCache* GetBlockCache() override { return &blocks; }
-  bool IsInCodeSpace(const u8* ptr) const { return IsInSpace(ptr); }
+  bool IsInCodeSpace(const u8* ptr) const override { return IsInSpace(ptr); }
   bool HandleFault(uintptr_t access_address, SContext* ctx) override;
   void DoBacktrace(uintptr_t access_address, SContext* ctx);
   bool HandleStackFault() override;
@@ -217,6 +217,8 @@ private:
   void EndTimeProfile(JitBlock* b);
 
   // Exits
+  // Counts an edge of a conditional branch for trace formation; see JitTraceProfile.
+  void WriteBranchCounter(const PPCAnalyst::CodeOp& op, bool taken);
   void WriteExit(u32 destination, bool LK = false, u32 exit_address_after_return = 0);
   void WriteExit(Arm64Gen::ARM64Reg dest, bool LK = false, u32 exit_address_after_return = 0);
   void WriteExceptionExit(u32 destination, bool only_external = false);
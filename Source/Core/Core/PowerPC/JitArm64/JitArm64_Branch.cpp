@@ -127,6 +127,25 @@ void JitArm64::bcx(UGeckoInstruction inst)
   INSTRUCTION_START
   JITDISABLE(bJITBranchOff);
 
+  if (js.op->branchIsFollowed)
+  {
+    // The analyzer continued the block at the branch target, so the taken path falls through
+    // and only the not-taken path leaves the block, from far code.
+    FixupBranch pConditionBranch =
+        JumpIfCRFieldBit(inst.BI >> 2, 3 - (inst.BI & 3), !!(inst.BO_2 & BO_BRANCH_IF_TRUE));
+    FixupBranch far = B();
+    SwitchToFarCode();
+    SetJumpTarget(far);
+
+    gpr.Flush(FlushMode::FLUSH_MAINTAIN_STATE);
+    fpr.Flush(FlushMode::FLUSH_MAINTAIN_STATE);
+    WriteExit(js.compilerPC + 4);
+
+    SwitchToNearCode();
+    SetJumpTarget(pConditionBranch);
+    return;
+  }
+
   ARM64Reg WA = gpr.GetReg();
   FixupBranch pCTRDontBranch;
   if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)  // Decrement and test CTR
@@ -169,6 +188,7 @@ void JitArm64::bcx(UGeckoInstruction inst)
   gpr.Flush(FlushMode::FLUSH_MAINTAIN_STATE);
   fpr.Flush(FlushMode::FLUSH_MAINTAIN_STATE);
 
+  WriteBranchCounter(*js.op, true);
   WriteExit(destination, inst.LK, js.compilerPC + 4);
 
   SwitchToNearCode();
@@ -177,6 +197,7 @@ void JitArm64::bcx(UGeckoInstruction inst)
     SetJumpTarget(pConditionDontBranch);
   if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)
     SetJumpTarget(pCTRDontBranch);
+  WriteBranchCounter(*js.op, false);
 
   if (!analyzer.HasOption(PPCAnalyst::PPCAnalyzer::OPTION_CONDITIONAL_CONTINUE))
   {
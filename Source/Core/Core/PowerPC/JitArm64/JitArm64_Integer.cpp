@@ -17,12 +17,18 @@ using namespace Arm64Gen;
 
 void JitArm64::ComputeRC0(ARM64Reg reg)
 {
+  if (SkipDeadCRField(0))
+    return;
+
   gpr.BindCRToRegister(0, false);
   SXTW(gpr.CR(0), reg);
 }
 
 void JitArm64::ComputeRC0(u64 imm)
 {
+  if (SkipDeadCRField(0))
+    return;
+
   gpr.BindCRToRegister(0, false);
   MOVI2R(gpr.CR(0), imm);
   if (imm & 0x80000000)
@@ -34,7 +40,10 @@ void JitArm64::ComputeCarry(bool Carry)
   js.carryFlagSet = false;
 
   if (!js.op->wantsCA)
+  {
+    ++m_num_dead_flags_eliminated;
     return;
+  }
 
   if (Carry)
   {
@@ -53,7 +62,10 @@ void JitArm64::ComputeCarry()
   js.carryFlagSet = false;
 
   if (!js.op->wantsCA)
+  {
+    ++m_num_dead_flags_eliminated;
     return;
+  }
 
   js.carryFlagSet = true;
   if (CanMergeNextInstructions(1) && js.op[1].opinfo->type == OPTYPE_INTEGER)
@@ -402,6 +414,9 @@ void JitArm64::cmp(UGeckoInstruction inst)
   int crf = inst.CRFD;
   u32 a = inst.RA, b = inst.RB;
 
+  if (SkipDeadCRField(crf))
+    return;
+
   gpr.BindCRToRegister(crf, false);
   ARM64Reg CR = gpr.CR(crf);
 
@@ -439,6 +454,9 @@ void JitArm64::cmpl(UGeckoInstruction inst)
   int crf = inst.CRFD;
   u32 a = inst.RA, b = inst.RB;
 
+  if (SkipDeadCRField(crf))
+    return;
+
   gpr.BindCRToRegister(crf, false);
   ARM64Reg CR = gpr.CR(crf);
 
@@ -468,6 +486,9 @@ void JitArm64::cmpi(UGeckoInstruction inst)
   s64 B = inst.SIMM_16;
   int crf = inst.CRFD;
 
+  if (SkipDeadCRField(crf))
+    return;
+
   gpr.BindCRToRegister(crf, false);
   ARM64Reg CR = gpr.CR(crf);
 
@@ -496,6 +517,9 @@ void JitArm64::cmpli(UGeckoInstruction inst)
   u64 B = inst.UIMM;
   int crf = inst.CRFD;
 
+  if (SkipDeadCRField(crf))
+    return;
+
   gpr.BindCRToRegister(crf, false);
   ARM64Reg CR = gpr.CR(crf);
 
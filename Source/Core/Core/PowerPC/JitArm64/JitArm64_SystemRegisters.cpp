@@ -115,6 +115,8 @@ void JitArm64::mtsr(UGeckoInstruction inst)
 {
   INSTRUCTION_START
   JITDISABLE(bJITSystemRegistersOff);
+  // The fast TLB has to see SR writes, and it is only used with the MMU on.
+  FALLBACK_IF(SConfig::GetInstance().bMMU);
 
   gpr.BindToRegister(inst.RS, true);
   STR(INDEX_UNSIGNED, gpr.R(inst.RS), PPC_REG, PPCSTATE_OFF(sr[inst.SR]));
@@ -143,6 +145,7 @@ void JitArm64::mtsrin(UGeckoInstruction inst)
 {
   INSTRUCTION_START
   JITDISABLE(bJITSystemRegistersOff);
+  FALLBACK_IF(SConfig::GetInstance().bMMU);
 
   u32 b = inst.RB, d = inst.RD;
   gpr.BindToRegister(d, d == b);
@@ -321,7 +321,7 @@ constexpr GekkoOPTemplate table31[] = {
     {438, &JitArm64::FallBackToInterpreter},  // ecowx
     {854, &JitArm64::eieio},                  // eieio
     {306, &JitArm64::FallBackToInterpreter},  // tlbie
-    {566, &JitArm64::DoNothing},              // tlbsync
+    {566, &JitArm64::FallBackToInterpreter},  // tlbsync
 };
 
 constexpr GekkoOPTemplate table59[] = {
@@ -12,6 +12,10 @@
 
 JitBase* g_jit;
 
+// Games usually set their GQRs once, or switch between a few layouts. A block whose guard keeps
+// failing past this is compiled against the GQRs read at runtime instead.
+constexpr u32 MAX_GQR_GUARD_FAILURES = 4;
+
 void JitTrampoline(u32 em_address)
 {
   g_jit->Jit(em_address);
@@ -43,9 +47,26 @@ bool JitBase::CanMergeNextInstructions(int count) const
   return true;
 }
 
+bool JitBase::SkipDeadCRField(int field)
+{
+  // Keep CR accurate for the debugger.
+  if (SConfig::GetInstance().bEnableDebugging || !js.op->crDiscardable[field])
+    return false;
+
+  ++m_num_dead_flags_eliminated;
+  return true;
+}
+
+bool JitBase::GQRGuardFailed(u32 address)
+{
+  ++m_num_gqr_guard_failures;
+  return ++js.pairedQuantizeGuardFailures[address] > MAX_GQR_GUARD_FAILURES;
+}
+
 void JitBase::UpdateMemoryOptions()
 {
   bool any_watchpoints = PowerPC::memchecks.HasAny();
   jo.fastmem = SConfig::GetInstance().bFastmem && (UReg_MSR(MSR).DR || !any_watchpoints);
   jo.memcheck = SConfig::GetInstance().bMMU || any_watchpoints;
+  jo.fastTLB = SConfig::GetInstance().bMMU;
 }
@@ -9,15 +9,19 @@
 //#define JIT_LOG_FPR     // Enables logging of the PPC floating point regs
 
 #include <map>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "Common/CommonTypes.h"
+#include "Common/JitRegister.h"
 #include "Common/x64Emitter.h"
 #include "Core/ConfigManager.h"
 #include "Core/MachineContext.h"
 #include "Core/PowerPC/CPUCoreBase.h"
 #include "Core/PowerPC/JitCommon/JitAsmCommon.h"
 #include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/JitCommon/JitTraceProfile.h"
 #include "Core/PowerPC/PPCAnalyst.h"
 
 // Use these to control the instruction selection
@@ -52,6 +56,7 @@ protected:
     bool accurateSinglePrecision;
     bool fastmem;
     bool memcheck;
+    bool fastTLB;
   };
   struct JitState
   {
@@ -95,16 +100,30 @@ protected:
     u8* rewriteStart;
 
     JitBlock* curBlock;
+    // Host code of each guest instruction of the current block, numbered from 1, for
+    // JitRegister. Only filled in when it is enabled.
+    std::vector<JitRegister::LineInfo> codeLines;
 
     std::unordered_set<u32> fifoWriteAddresses;
     std::unordered_set<u32> pairedQuantizeAddresses;
+    // How often the GQR guard of the block at each address has failed.
+    std::unordered_map<u32, u32> pairedQuantizeGuardFailures;
     std::unordered_set<u32> noSpeculativeConstantsAddresses;
   };
 
   PPCAnalyst::CodeBlock code_block;
   PPCAnalyst::PPCAnalyzer analyzer;
+  JitTraceProfile m_trace_profile;
+  // Number of CR and CA computations left out of compiled code because nothing reads them.
+  u64 m_num_dead_flags_eliminated = 0;
+  // Number of blocks compiled with speculated GQR values, and how often their guards failed.
+  u64 m_num_gqr_speculations = 0;
+  u64 m_num_gqr_guard_failures = 0;
 
   bool CanMergeNextInstructions(int count) const;
+  // Returns true if the current instruction's write to the given CR field is dead (see
+  // CodeOp::crDiscardable) and can be left out. Counts it as eliminated.
+  bool SkipDeadCRField(int field);
 
   void UpdateMemoryOptions();
 
@@ -117,6 +136,10 @@ public:
   ~JitBase() override;
 
   static const u8* Dispatch() { return g_jit->GetBlockCache()->Dispatch(); }
+  u64 GetNumDeadFlagsEliminated() const { return m_num_dead_flags_eliminated; }
+  // Records that the GQR guard of the block at address failed. Returns true if the block has
+  // failed often enough that it should be compiled without GQR speculation from now on.
+  bool GQRGuardFailed(u32 address);
   virtual JitBaseBlockCache* GetBlockCache() = 0;
 
   virtual void Jit(u32 em_address) = 0;
@@ -125,6 +148,11 @@ public:
 
   virtual bool HandleFault(uintptr_t access_address, SContext* ctx) = 0;
   virtual bool HandleStackFault() { return false; }
+  // Whether ptr is in the code space the blocks are emitted into.
+  virtual bool IsInCodeSpace(const u8* ptr) const { return false; }
+  // Called by the block cache when a block is invalidated or its code space is recycled.
+  // The host code of the block may still be running.
+  virtual void OnBlockDestroyed(const JitBlock& block) {}
 };
 
 void JitTrampoline(u32 em_address);
@@ -0,0 +1,147 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+struct JitBlock;
+
+// An open-addressing hash table from a u32 key to JitBlock pointers, which replaces the
+// node-based std::multimaps the block cache used to keep. Several entries may share a key.
+// Entries with other keys can sit between them, so lookups scan from the key's home slot until
+// the next empty slot and skip whatever doesn't match. With the table at most half full, that is
+// a handful of adjacent cache lines instead of chasing tree nodes.
+//
+// Uses linear probing with backward-shift deletion, so there are no tombstones and lookups
+// never degrade after many insert/erase cycles (which is exactly what icbi storms cause).
+class JitBlockIndex final
+{
+public:
+  JitBlockIndex() { m_slots.resize(MIN_CAPACITY); }
+
+  size_t Size() const { return m_size; }
+  size_t Capacity() const { return m_slots.size(); }
+
+  void Clear()
+  {
+    m_slots.assign(MIN_CAPACITY, Slot());
+    m_size = 0;
+  }
+
+  void Insert(u32 key, JitBlock* block)
+  {
+    if ((m_size + 1) * 2 > m_slots.size())
+      Rehash(m_slots.size() * 2);
+
+    size_t i = Home(key);
+    while (m_slots[i].block)
+      i = Next(i);
+    m_slots[i] = {key, block};
+    ++m_size;
+  }
+
+  // Removes one entry matching both key and block. Returns false if there is none.
+  bool Erase(u32 key, const JitBlock* block)
+  {
+    for (size_t i = Home(key); m_slots[i].block; i = Next(i))
+    {
+      if (m_slots[i].key == key && m_slots[i].block == block)
+      {
+        EraseSlot(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Calls f(block) for every entry with the given key. f must not modify the index.
+  template <typename F>
+  void ForEach(u32 key, F f) const
+  {
+    for (size_t i = Home(key); m_slots[i].block; i = Next(i))
+    {
+      if (m_slots[i].key == key)
+        f(m_slots[i].block);
+    }
+  }
+
+  // Returns the first block with the given key that satisfies pred, or nullptr.
+  template <typename P>
+  JitBlock* Find(u32 key, P pred) const
+  {
+    for (size_t i = Home(key); m_slots[i].block; i = Next(i))
+    {
+      if (m_slots[i].key == key && pred(*m_slots[i].block))
+        return m_slots[i].block;
+    }
+    return nullptr;
+  }
+
+  // Calls f(key, block) for every entry in the index, in no particular order.
+  // f must not modify the index.
+  template <typename F>
+  void ForEachEntry(F f) const
+  {
+    for (const Slot& slot : m_slots)
+    {
+      if (slot.block)
+        f(slot.key, slot.block);
+    }
+  }
+
+private:
+  static constexpr size_t MIN_CAPACITY = 1024;
+
+  struct Slot
+  {
+    u32 key = 0;
+    JitBlock* block = nullptr;
+  };
+
+  size_t Mask() const { return m_slots.size() - 1; }
+  size_t Next(size_t i) const { return (i + 1) & Mask(); }
+  size_t Home(u32 key) const
+  {
+    // Fibonacci hashing; spreads the sequential addresses we get as keys over the table.
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & Mask();
+  }
+
+  void EraseSlot(size_t hole)
+  {
+    // Shift later entries of the probe run back so that no lookup stops early at the hole.
+    for (size_t i = Next(hole); m_slots[i].block; i = Next(i))
+    {
+      const size_t home = Home(m_slots[i].key);
+      // Move the entry if its home slot doesn't lie cyclically in (hole, i].
+      const bool movable = hole <= i ? (home <= hole || home > i) : (home <= hole && home > i);
+      if (movable)
+      {
+        m_slots[hole] = m_slots[i];
+        hole = i;
+      }
+    }
+    m_slots[hole] = Slot();
+    --m_size;
+  }
+
+  void Rehash(size_t capacity)
+  {
+    std::vector<Slot> old_slots(capacity);
+    std::swap(old_slots, m_slots);
+    m_size = 0;
+    for (const Slot& slot : old_slots)
+    {
+      if (slot.block)
+        Insert(slot.key, slot.block);
+    }
+  }
+
+  std::vector<Slot> m_slots;
+  size_t m_size = 0;
+};
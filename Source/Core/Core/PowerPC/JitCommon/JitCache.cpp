@@ -13,14 +13,16 @@
 #include <array>
 #include <cstring>
 #include <functional>
-#include <map>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Common/JitRegister.h"
+#include "Common/Logging/Log.h"
 #include "Core/ConfigManager.h"
 #include "Core/Core.h"
+#include "Core/HW/Memmap.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
 #include "Core/PowerPC/PPCSymbolDB.h"
 #include "Core/PowerPC/PowerPC.h"
@@ -33,8 +35,8 @@ using namespace Gen;
 
 bool JitBlock::OverlapsPhysicalRange(u32 address, u32 length) const
 {
-  return physical_addresses.lower_bound(address) !=
-         physical_addresses.lower_bound(address + length);
+  const auto first = std::lower_bound(physical_addresses.begin(), physical_addresses.end(), address);
+  return first != physical_addresses.end() && *first < static_cast<u64>(address) + length;
 }
 
 JitBaseBlockCache::JitBaseBlockCache(JitBase& jit) : m_jit{jit}
@@ -45,13 +47,20 @@ JitBaseBlockCache::~JitBaseBlockCache() = default;
 
 void JitBaseBlockCache::Init()
 {
-  JitRegister::Init(SConfig::GetInstance().m_perfDir);
+  JitRegister::Init(SConfig::GetInstance().m_perfDir, SConfig::GetInstance().bPerfJitDump);
 
+  // The fault handler is only installed with fastmem.
+  const SConfig& config = SConfig::GetInstance();
+  m_code_page_tracking = config.bJITCodePageTracking && config.bFastmem;
+  m_code_page_write_faults.assign(m_code_page_tracking ? 1 << 20 : 0, 0);
+
+  m_warm_up_done = false;
   Clear();
 }
 
 void JitBaseBlockCache::Shutdown()
 {
+  m_disk_cache.Close();
   JitRegister::Shutdown();
 }
 
@@ -62,19 +71,31 @@ void JitBaseBlockCache::Clear()
 #if defined(_DEBUG) || defined(DEBUGFAST)
   Core::DisplayMessage("Clearing code cache.", 3000);
 #endif
+  if (m_warming_up)
+    m_warm_up_interrupted = true;
+
   m_jit.js.fifoWriteAddresses.clear();
   m_jit.js.pairedQuantizeAddresses.clear();
-  for (auto& e : block_map)
+  m_jit.js.pairedQuantizeGuardFailures.clear();
+  block_map.ForEachEntry([this](u32, JitBlock* block) { DestroyBlock(*block); });
+  block_map.Clear();
+  host_code_map.clear();
+  links_to.Clear();
+  block_range_map.Clear();
+
+  m_free_blocks.clear();
+  for (auto chunk = m_block_chunks.rbegin(); chunk != m_block_chunks.rend(); ++chunk)
   {
-    DestroyBlock(e.second);
+    for (size_t i = BLOCK_POOL_CHUNK_SIZE; i-- > 0;)
+      m_free_blocks.push_back(&(*chunk)[i]);
   }
-  block_map.clear();
-  links_to.clear();
-  block_range_map.clear();
 
   valid_block.ClearAll();
 
   fast_block_map.fill(nullptr);
+
+  if (m_code_page_tracking)
+    Memory::UnWriteProtectAllPhysicalPages(Memory::WRITE_PROTECT_JIT_CODE);
 }
 
 void JitBaseBlockCache::Reset()
@@ -90,19 +111,17 @@ JitBlock** JitBaseBlockCache::GetFastBlockMap()
 
 void JitBaseBlockCache::RunOnBlocks(std::function<void(const JitBlock&)> f)
 {
-  for (const auto& e : block_map)
-    f(e.second);
+  block_map.ForEachEntry([&f](u32, const JitBlock* block) { f(*block); });
 }
 
 JitBlock* JitBaseBlockCache::AllocateBlock(u32 em_address)
 {
   u32 physicalAddress = PowerPC::JitCache_TranslateAddress(em_address).address;
-  JitBlock& b = block_map.emplace(physicalAddress, JitBlock())->second;
+  JitBlock& b = *NewBlock();
   b.effectiveAddress = em_address;
   b.physicalAddress = physicalAddress;
   b.msrBits = MSR & JIT_CACHE_MSR_MASK;
-  b.linkData.clear();
-  b.fast_block_map_index = 0;
+  block_map.Insert(physicalAddress, &b);
   return &b;
 }
 
@@ -113,36 +132,59 @@ void JitBaseBlockCache::FinalizeBlock(JitBlock& block, bool block_link,
   fast_block_map[index] = &block;
   block.fast_block_map_index = index;
 
-  block.physical_addresses = physical_addresses;
+  block.physical_addresses.assign(physical_addresses.begin(), physical_addresses.end());
+  host_code_map[block.checkedEntry] = &block;
 
+  // The addresses are sorted, so all addresses of one macro block are adjacent.
   u32 range_mask = ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
-  for (u32 addr : physical_addresses)
+  for (size_t i = 0; i < block.physical_addresses.size(); ++i)
   {
+    const u32 addr = block.physical_addresses[i];
     valid_block.Set(addr / 32);
-    block_range_map[addr & range_mask].insert(&block);
+    if (i == 0 || (block.physical_addresses[i - 1] & range_mask) != (addr & range_mask))
+      block_range_map.Insert(addr & range_mask, &block);
+  }
+
+  if (m_code_page_tracking)
+  {
+    const u32 page_mask = ~(Memory::WRITE_PROTECT_PAGE_SIZE - 1);
+    for (size_t i = 0; i < block.physical_addresses.size(); ++i)
+    {
+      const u32 page = block.physical_addresses[i] & page_mask;
+      if (i != 0 && (block.physical_addresses[i - 1] & page_mask) == page)
+        continue;
+      if (m_code_page_write_faults[page / Memory::WRITE_PROTECT_PAGE_SIZE] <
+          MAX_CODE_PAGE_WRITE_FAULTS)
+      {
+        Memory::WriteProtectPhysicalPage(page, Memory::WRITE_PROTECT_JIT_CODE);
+      }
+    }
   }
 
   if (block_link)
   {
     for (const auto& e : block.linkData)
     {
-      links_to.emplace(e.exitAddress, &block);
+      links_to.Insert(e.exitAddress, &block);
     }
 
     LinkBlock(block);
   }
 
+  m_disk_cache.Record(block);
+
   Symbol* symbol = nullptr;
   if (JitRegister::IsEnabled() &&
       (symbol = g_symbolDB.GetSymbolFromAddr(block.effectiveAddress)) != nullptr)
   {
-    JitRegister::Register(block.checkedEntry, block.codeSize, "JIT_PPC_%s_%08x",
-                          symbol->function_name.c_str(), block.physicalAddress);
+    JitRegister::RegisterWithLines(block.checkedEntry, block.codeSize, m_jit.js.codeLines,
+                                   "JIT_PPC_%s_%08x", symbol->function_name.c_str(),
+                                   block.physicalAddress);
   }
   else
   {
-    JitRegister::Register(block.checkedEntry, block.codeSize, "JIT_PPC_%08x",
-                          block.physicalAddress);
+    JitRegister::RegisterWithLines(block.checkedEntry, block.codeSize, m_jit.js.codeLines,
+                                   "JIT_PPC_%08x", block.physicalAddress);
   }
 }
 
@@ -159,15 +201,19 @@ JitBlock* JitBaseBlockCache::GetBlockFromStartAddress(u32 addr, u32 msr)
     translated_addr = translated.address;
   }
 
-  auto iter = block_map.equal_range(translated_addr);
-  for (; iter.first != iter.second; iter.first++)
-  {
-    JitBlock& b = iter.first->second;
-    if (b.effectiveAddress == addr && b.msrBits == (msr & JIT_CACHE_MSR_MASK))
-      return &b;
-  }
+  return block_map.Find(translated_addr, [addr, msr](const JitBlock& b) {
+    return b.effectiveAddress == addr && b.msrBits == (msr & JIT_CACHE_MSR_MASK);
+  });
+}
 
-  return nullptr;
+const JitBlock* JitBaseBlockCache::GetBlockFromHostCode(const u8* address) const
+{
+  auto it = host_code_map.upper_bound(address);
+  if (it == host_code_map.begin())
+    return nullptr;
+  --it;
+  const JitBlock* block = it->second;
+  return address < block->checkedEntry + block->codeSize ? block : nullptr;
 }
 
 const u8* JitBaseBlockCache::Dispatch()
@@ -215,6 +261,7 @@ void JitBaseBlockCache::InvalidateICache(u32 address, u32 length, bool forced)
       {
         m_jit.js.fifoWriteAddresses.erase(i);
         m_jit.js.pairedQuantizeAddresses.erase(i);
+        m_jit.js.pairedQuantizeGuardFailures.erase(i);
       }
     }
   }
@@ -222,58 +269,170 @@ void JitBaseBlockCache::InvalidateICache(u32 address, u32 length, bool forced)
 
 void JitBaseBlockCache::ErasePhysicalRange(u32 address, u32 length)
 {
-  // Iterate over all macro blocks which overlap the given range.
-  u32 range_mask = ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
-  auto start = block_range_map.lower_bound(address & range_mask);
-  auto end = block_range_map.lower_bound(address + length);
-  while (start != end)
+  if (length == 0)
+    return;
+
+  const u32 range_mask = ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
+  const u64 first = address & range_mask;
+  const u64 end = static_cast<u64>(address) + length;
+
+  m_erase_candidates.clear();
+  const auto collect = [this, address, length](JitBlock* block) {
+    if (block->OverlapsPhysicalRange(address, length))
+      m_erase_candidates.push_back(block);
+  };
+
+  // Visit all macro blocks which overlap the given range. For huge ranges (e.g. a full
+  // invalidation) it is cheaper to walk the whole index than to probe every macro block.
+  if ((end - first) / BLOCK_RANGE_MAP_ELEMENTS >= block_range_map.Capacity())
   {
-    // Iterate over all blocks in the macro block.
-    auto iter = start->second.begin();
-    while (iter != start->second.end())
-    {
-      JitBlock* block = *iter;
-      if (block->OverlapsPhysicalRange(address, length))
-      {
-        // If the block overlaps, also remove all other occupied slots in the other macro blocks.
-        // This will leak empty macro blocks, but they may be reused or cleared later on.
-        for (u32 addr : block->physical_addresses)
-          if ((addr & range_mask) != start->first)
-            block_range_map[addr & range_mask].erase(block);
-
-        // And remove the block.
-        DestroyBlock(*block);
-        auto block_map_iter = block_map.equal_range(block->physicalAddress);
-        while (block_map_iter.first != block_map_iter.second)
-        {
-          if (&block_map_iter.first->second == block)
-          {
-            block_map.erase(block_map_iter.first);
-            break;
-          }
-          block_map_iter.first++;
-        }
-        iter = start->second.erase(iter);
-      }
-      else
-      {
-        iter++;
-      }
-    }
+    block_range_map.ForEachEntry([first, end, &collect](u32 key, JitBlock* block) {
+      if (key >= first && key < end)
+        collect(block);
+    });
+  }
+  else
+  {
+    for (u64 key = first; key < end; key += BLOCK_RANGE_MAP_ELEMENTS)
+      block_range_map.ForEach(static_cast<u32>(key), collect);
+  }
 
-    // If the macro block is empty, drop it.
-    if (start->second.empty())
-      start = block_range_map.erase(start);
-    else
-      start++;
+  // A block spanning several macro blocks was found once for each of them.
+  std::sort(m_erase_candidates.begin(), m_erase_candidates.end());
+  m_erase_candidates.erase(std::unique(m_erase_candidates.begin(), m_erase_candidates.end()),
+                           m_erase_candidates.end());
+
+  for (JitBlock* block : m_erase_candidates)
+    EraseBlock(*block);
+}
+
+void JitBaseBlockCache::HandleCodePageWrite(u32 physical_address)
+{
+  const u32 page = physical_address & ~(Memory::WRITE_PROTECT_PAGE_SIZE - 1);
+  Memory::UnWriteProtectPhysicalPage(page, Memory::WRITE_PROTECT_JIT_CODE);
+
+  // DMA and the GPU thread can write to RAM as well. The hardware doesn't keep the instruction
+  // cache coherent with those, so the code is left for icbi to invalidate. The page gets
+  // protected again the next time a block is compiled from it.
+  if (!Core::IsCPUThread())
+    return;
+
+  u8& write_faults = m_code_page_write_faults[page / Memory::WRITE_PROTECT_PAGE_SIZE];
+  if (write_faults < MAX_CODE_PAGE_WRITE_FAULTS)
+    ++write_faults;
+
+  // Writes by the CPU are handled once the block doing them has exited, so that block ran to its
+  // end with the old instructions, which is what the hardware would do without an isync.
+  ErasePhysicalRange(page, Memory::WRITE_PROTECT_PAGE_SIZE);
+  for (u32 i = page; i < page + Memory::WRITE_PROTECT_PAGE_SIZE; i += 4)
+  {
+    m_jit.js.fifoWriteAddresses.erase(i);
+    m_jit.js.pairedQuantizeAddresses.erase(i);
+    m_jit.js.pairedQuantizeGuardFailures.erase(i);
   }
 }
 
+size_t JitBaseBlockCache::EraseCodeRange(const u8* start, const u8* end)
+{
+  // Recycling code space in the middle of warming up throws away blocks it just compiled.
+  if (m_warming_up)
+    m_warm_up_interrupted = true;
+
+  m_erase_candidates.clear();
+  block_map.ForEachEntry([this, start, end](u32, JitBlock* block) {
+    if (block->checkedEntry >= start && block->checkedEntry < end)
+      m_erase_candidates.push_back(block);
+  });
+
+  for (JitBlock* block : m_erase_candidates)
+    EraseBlock(*block);
+  return m_erase_candidates.size();
+}
+
+void JitBaseBlockCache::EraseBlock(JitBlock& block)
+{
+  // Remove the block from all macro blocks it occupies.
+  const u32 range_mask = ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
+  for (size_t i = 0; i < block.physical_addresses.size(); ++i)
+  {
+    const u32 addr = block.physical_addresses[i];
+    if (i == 0 || (block.physical_addresses[i - 1] & range_mask) != (addr & range_mask))
+      block_range_map.Erase(addr & range_mask, &block);
+  }
+
+  // And remove the block.
+  DestroyBlock(block);
+  block_map.Erase(block.physicalAddress, &block);
+  FreeBlock(block);
+}
+
 u32* JitBaseBlockCache::GetBlockBitSet() const
 {
   return valid_block.m_valid_block.get();
 }
 
+bool JitBaseBlockCache::WarmUp()
+{
+  if (m_warm_up_done)
+    return false;
+  m_warm_up_done = true;
+
+  const SConfig& config = SConfig::GetInstance();
+  if (!config.bJITDiskBlockCache || config.bEnableDebugging || config.bJITNoBlockCache)
+    return false;
+
+  if (!m_disk_cache.Open(m_jit.GetName()))
+    return false;
+
+  const std::vector<JitDiskCache::Entry> entries = m_disk_cache.TakePendingEntries();
+  if (entries.empty())
+    return false;
+
+  // The JITs compile the block at PC with the current MSR, so fake both for every entry.
+  const u32 old_pc = PC;
+  const u32 old_npc = NPC;
+  const u32 old_msr = MSR;
+  m_warming_up = true;
+  m_warm_up_interrupted = false;
+
+  size_t num_compiled = 0;
+  for (const JitDiskCache::Entry& entry : entries)
+  {
+    // Running out of code space means the cache was flushed underneath us; don't refill it.
+    if (m_warm_up_interrupted)
+      break;
+
+    // Skip entries that don't translate (the same way the analyzer reads the first
+    // instruction) before the JIT sees them, so that it never takes its ISI path.
+    MSR = (old_msr & ~JIT_CACHE_MSR_MASK) | entry.key.msr_bits;
+    const auto translated = PowerPC::JitCache_TranslateAddress(entry.key.effective_address);
+    if (!translated.valid || translated.address != entry.key.physical_address)
+      continue;
+
+    // The game may have loaded different code to the same place (e.g. overlays).
+    if (!JitDiskCache::IsCodeUnchanged(entry))
+      continue;
+
+    if (GetBlockFromStartAddress(entry.key.effective_address, MSR))
+      continue;
+
+    PC = entry.key.effective_address;
+    NPC = PC + 4;
+    m_jit.Jit(PC);
+    if (GetBlockFromStartAddress(entry.key.effective_address, MSR))
+      ++num_compiled;
+  }
+
+  m_warming_up = false;
+  PC = old_pc;
+  NPC = old_npc;
+  MSR = old_msr;
+
+  INFO_LOG(DYNA_REC, "Precompiled %zu of %zu blocks from the JIT disk cache", num_compiled,
+           entries.size());
+  return num_compiled != 0;
+}
+
 void JitBaseBlockCache::WriteDestroyBlock(const JitBlock& block)
 {
 }
@@ -303,14 +462,10 @@ void JitBaseBlockCache::LinkBlockExits(JitBlock& block)
 void JitBaseBlockCache::LinkBlock(JitBlock& block)
 {
   LinkBlockExits(block);
-  auto ppp = links_to.equal_range(block.effectiveAddress);
-
-  for (auto iter = ppp.first; iter != ppp.second; ++iter)
-  {
-    JitBlock& b2 = *iter->second;
-    if (block.msrBits == b2.msrBits)
-      LinkBlockExits(b2);
-  }
+  links_to.ForEach(block.effectiveAddress, [this, &block](JitBlock* b2) {
+    if (block.msrBits == b2->msrBits)
+      LinkBlockExits(*b2);
+  });
 }
 
 void JitBaseBlockCache::UnlinkBlock(const JitBlock& block)
@@ -322,14 +477,11 @@ void JitBaseBlockCache::UnlinkBlock(const JitBlock& block)
   }
 
   // Unlink all exits of other blocks which points to this block
-  auto ppp = links_to.equal_range(block.effectiveAddress);
-  for (auto iter = ppp.first; iter != ppp.second; ++iter)
-  {
-    JitBlock& sourceBlock = *iter->second;
-    if (sourceBlock.msrBits != block.msrBits)
-      continue;
+  links_to.ForEach(block.effectiveAddress, [this, &block](JitBlock* sourceBlock) {
+    if (sourceBlock->msrBits != block.msrBits)
+      return;
 
-    for (auto& e : sourceBlock.linkData)
+    for (auto& e : sourceBlock->linkData)
     {
       if (e.exitAddress == block.effectiveAddress)
       {
@@ -337,7 +489,7 @@ void JitBaseBlockCache::UnlinkBlock(const JitBlock& block)
         e.linkStatus = false;
       }
     }
-  }
+  });
 }
 
 void JitBaseBlockCache::DestroyBlock(JitBlock& block)
@@ -347,21 +499,20 @@ void JitBaseBlockCache::DestroyBlock(JitBlock& block)
 
   UnlinkBlock(block);
 
-  // Delete linking addresses
+  auto host_code = host_code_map.find(block.checkedEntry);
+  if (host_code != host_code_map.end() && host_code->second == &block)
+    host_code_map.erase(host_code);
+
+  // Delete linking addresses. There is one entry for every exit, even if several exits
+  // share a destination.
   for (const auto& e : block.linkData)
   {
-    auto it = links_to.equal_range(e.exitAddress);
-    while (it.first != it.second)
-    {
-      if (it.first->second == &block)
-        it.first = links_to.erase(it.first);
-      else
-        it.first++;
-    }
+    links_to.Erase(e.exitAddress, &block);
   }
 
   // Raise an signal if we are going to call this block again
   WriteDestroyBlock(block);
+  m_jit.OnBlockDestroyed(block);
 }
 
 JitBlock* JitBaseBlockCache::MoveBlockIntoFastCache(u32 addr, u32 msr)
@@ -387,3 +538,31 @@ size_t JitBaseBlockCache::FastLookupIndexForAddress(u32 address)
 {
   return (address >> 2) & FAST_BLOCK_MAP_MASK;
 }
+
+JitBlock* JitBaseBlockCache::NewBlock()
+{
+  if (m_free_blocks.empty())
+  {
+    m_block_chunks.emplace_back(new JitBlock[BLOCK_POOL_CHUNK_SIZE]);
+    JitBlock* chunk = m_block_chunks.back().get();
+    for (size_t i = BLOCK_POOL_CHUNK_SIZE; i-- > 0;)
+      m_free_blocks.push_back(&chunk[i]);
+  }
+
+  JitBlock* block = m_free_blocks.back();
+  m_free_blocks.pop_back();
+
+  // Keep the capacity of the vectors around; that's the point of pooling.
+  block->linkData.clear();
+  block->physical_addresses.clear();
+  block->profile_data = {};
+  block->fast_block_map_index = 0;
+  block->hintedEntry = nullptr;
+  block->entry_layout = 0;
+  return block;
+}
+
+void JitBaseBlockCache::FreeBlock(JitBlock& block)
+{
+  m_free_blocks.push_back(&block);
+}
@@ -14,6 +14,8 @@
 #include <vector>
 
 #include "Common/CommonTypes.h"
+#include "Core/PowerPC/JitCommon/JitBlockIndex.h"
+#include "Core/PowerPC/JitCommon/JitDiskCache.h"
 
 class JitBase;
 
@@ -33,6 +35,10 @@ struct JitBlock
   const u8* checkedEntry;
   // The normal entry point for the block, returned by Dispatch().
   const u8* normalEntry;
+  // Entry point for linked exits that have already loaded the registers listed in
+  // entry_layout (Jit64 register passing). Null if the block has no entry layout.
+  const u8* hintedEntry;
+  u64 entry_layout;
 
   // The effective address (PC) for the beginning of the block.
   u32 effectiveAddress;
@@ -58,11 +64,13 @@ struct JitBlock
     u32 exitAddress;
     bool linkStatus;  // is it already linked?
     bool call;
+    // The entry layout the exit has set up registers for, if any.
+    u64 entry_layout = 0;
   };
   std::vector<LinkData> linkData;
 
-  // This set stores all physical addresses of all occupied instructions.
-  std::set<u32> physical_addresses;
+  // The sorted physical addresses of all occupied instructions.
+  std::vector<u32> physical_addresses;
 
   // Block profiling data, structure is inlined in Jit.cpp
   struct ProfileData
@@ -141,6 +149,10 @@ public:
   // This might return nullptr if there is no such block.
   JitBlock* GetBlockFromStartAddress(u32 em_address, u32 msr);
 
+  // Returns the block whose code contains the given host address, or nullptr. Doesn't allocate,
+  // so the sampling profiler can call it while the CPU thread is interrupted in compiled code.
+  const JitBlock* GetBlockFromHostCode(const u8* address) const;
+
   // Get the normal entry for the block associated with the current program
   // counter. This will JIT code if necessary. (This is the reference
   // implementation; high-performance JITs will want to use a custom
@@ -149,9 +161,26 @@ public:
 
   void InvalidateICache(u32 address, u32 length, bool forced);
   void ErasePhysicalRange(u32 address, u32 length);
+  // Destroys the block and removes it from all indexes. Unlike invalidating its address range,
+  // this leaves other blocks covering the same code alone.
+  void EraseBlock(JitBlock& block);
+  // Called once something wrote to a page that was write-protected because it contains compiled
+  // code, never from within the fault handler itself.
+  void HandleCodePageWrite(u32 physical_address);
+  // Destroys every block whose host code starts in [start, end), so that the JIT can reuse
+  // that part of its code space. Returns the number of blocks destroyed.
+  size_t EraseCodeRange(const u8* start, const u8* end);
 
   u32* GetBlockBitSet() const;
 
+  // Compiles the blocks which the on-disk block cache recorded for the running game in
+  // earlier sessions. Only the first call after Init() does anything; JITs call this before
+  // compiling so that the game ID is known by then. Returns true if any block was compiled.
+  bool WarmUp();
+  // Warm-up compiles blocks the game has not asked for yet, so a JIT must not raise
+  // exceptions for them.
+  bool IsWarmingUp() const { return m_warming_up; }
+
 protected:
   JitBase& m_jit;
 
@@ -169,19 +198,41 @@ private:
   // Fast but risky block lookup based on fast_block_map.
   size_t FastLookupIndexForAddress(u32 address);
 
+  JitBlock* NewBlock();
+  void FreeBlock(JitBlock& block);
+
   // links_to hold all exit points of all valid blocks in a reverse way.
   // It is used to query all blocks which links to an address.
-  std::multimap<u32, JitBlock*> links_to;  // destination_PC -> number
+  JitBlockIndex links_to;  // destination_PC -> block
 
   // Map indexed by the physical address of the entry point.
   // This is used to query the block based on the current PC in a slow way.
-  std::multimap<u32, JitBlock> block_map;  // start_addr -> block
+  JitBlockIndex block_map;  // start_addr -> block
+
+  // Valid blocks indexed by the start of their host code.
+  std::map<const u8*, JitBlock*> host_code_map;  // checkedEntry -> block
 
   // Range of overlapping code indexed by a masked physical address.
   // This is used for invalidation of memory regions. The range is grouped
-  // in macro blocks of each 0x100 bytes.
+  // in macro blocks of each 0x100 bytes; a block has one entry per macro block it touches.
   static constexpr u32 BLOCK_RANGE_MAP_ELEMENTS = 0x100;
-  std::map<u32, std::set<JitBlock*>> block_range_map;
+  JitBlockIndex block_range_map;  // start_addr & range_mask -> block
+
+  // Blocks are allocated in chunks so that their addresses stay stable (the dispatcher and
+  // emitted code point at them) and so that freed blocks keep their vectors' capacity.
+  static constexpr size_t BLOCK_POOL_CHUNK_SIZE = 1024;
+  std::vector<std::unique_ptr<JitBlock[]>> m_block_chunks;
+  std::vector<JitBlock*> m_free_blocks;
+
+  // Scratch space for ErasePhysicalRange and EraseCodeRange, kept around to avoid reallocating on every icbi.
+  std::vector<JitBlock*> m_erase_candidates;
+
+  // Pages with compiled code are write-protected (see Memory::WriteProtectPhysicalPage) so that
+  // writes to them are noticed without waiting for an icbi. Pages which get written over and
+  // over, typically because they mix code and data, are given up on after a few faults.
+  static constexpr u8 MAX_CODE_PAGE_WRITE_FAULTS = 8;
+  bool m_code_page_tracking = false;
+  std::vector<u8> m_code_page_write_faults;  // physical page -> number of faults
 
   // This bitsets shows which cachelines overlap with any blocks.
   // It is used to provide a fast way to query if no icache invalidation is needed.
@@ -190,4 +241,10 @@ private:
   // This array is indexed with the masked PC and likely holds the correct block id.
   // This is used as a fast cache of block_map used in the assembly dispatcher.
   std::array<JitBlock*, FAST_BLOCK_MAP_ELEMENTS> fast_block_map;  // start_addr & mask -> number
+
+  // Persists the guest addresses of compiled blocks between sessions.
+  JitDiskCache m_disk_cache;
+  bool m_warm_up_done = false;
+  bool m_warming_up = false;
+  bool m_warm_up_interrupted = false;
 };
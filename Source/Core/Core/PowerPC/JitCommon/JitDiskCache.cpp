@@ -0,0 +1,210 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/JitCommon/JitDiskCache.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Common/Hash.h"
+#include "Common/Logging/Log.h"
+#include "Common/StringUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+
+class JitDiskCache::Reader final : public LinearDiskCacheReader<Key, u32>
+{
+public:
+  explicit Reader(JitDiskCache& cache) : m_cache(cache) {}
+  void Read(const Key& key, const u32* value, u32 value_size) override
+  {
+    // Entries written with different settings may describe differently shaped blocks.
+    if (key.config_hash != m_cache.m_config_hash || value_size == 0)
+    {
+      ++m_cache.m_num_stale_entries;
+      return;
+    }
+
+    // Later entries replace earlier ones for the same slot.
+    if (!m_cache.Insert(key, std::vector<u32>(value, value + value_size)))
+      ++m_cache.m_num_stale_entries;
+  }
+
+private:
+  JitDiskCache& m_cache;
+};
+
+bool JitDiskCache::Open(const std::string& jit_name)
+{
+  Close();
+
+  const std::string& game_id = SConfig::GetInstance().GetGameID();
+  if (game_id.empty())
+    return false;
+
+  const std::string directory = File::GetUserPath(D_CACHE_IDX) + "JitBlocks" DIR_SEP;
+  if (!File::IsDirectory(directory))
+    File::CreateFullPath(directory);
+
+  m_filename = directory + game_id + "-" + ReplaceAll(jit_name, " ", "") + ".cache";
+
+  m_config_hash = ComputeConfigHash();
+  Reader reader(*this);
+  m_file.OpenAndRead(m_filename, reader);
+  m_is_open = true;
+
+  m_pending.reserve(m_entries.size());
+  for (const auto& slot : m_entries)
+    m_pending.push_back(slot.second);
+
+  INFO_LOG(DYNA_REC, "Loaded %zu blocks from JIT disk cache %s", m_pending.size(),
+           m_filename.c_str());
+  return true;
+}
+
+void JitDiskCache::Close()
+{
+  if (m_is_open)
+  {
+    if (m_num_stale_entries != 0)
+      Compact();
+    m_file.Sync();
+    m_file.Close();
+  }
+
+  m_entries.clear();
+  m_num_stale_entries = 0;
+  m_pending.clear();
+  m_is_open = false;
+}
+
+bool JitDiskCache::Insert(const Key& key, std::vector<u32> physical_addresses)
+{
+  auto result = m_entries.emplace(Slot(key.effective_address, key.msr_bits), Entry());
+  Entry& entry = result.first->second;
+  if (!result.second)
+  {
+    if (entry.key.physical_address == key.physical_address &&
+        entry.key.code_hash == key.code_hash && entry.physical_addresses == physical_addresses)
+    {
+      return false;
+    }
+    ++m_num_stale_entries;
+  }
+
+  entry.key = key;
+  entry.physical_addresses = std::move(physical_addresses);
+  return true;
+}
+
+void JitDiskCache::Record(const JitBlock& block)
+{
+  if (!m_is_open)
+    return;
+
+  const std::vector<u32>& addresses = block.physical_addresses;
+  Key key{block.effectiveAddress, block.msrBits, block.physicalAddress, m_config_hash, 0};
+  if (addresses.empty() || !HashGuestCode(addresses.data(), addresses.size(), &key.code_hash))
+    return;
+
+  if (!Insert(key, addresses))
+    return;
+
+  // Self-modifying code can recompile the same blocks over and over, so don't let the file
+  // fill up with replaced entries until the game is closed.
+  if (m_num_stale_entries > m_entries.size())
+    Compact();
+  else
+    m_file.Append(key, addresses.data(), static_cast<u32>(addresses.size()));
+}
+
+void JitDiskCache::Compact()
+{
+  class NullReader final : public LinearDiskCacheReader<Key, u32>
+  {
+  public:
+    void Read(const Key& key, const u32* value, u32 value_size) override {}
+  };
+
+  m_file.Close();
+  File::Delete(m_filename);
+  NullReader reader;
+  m_file.OpenAndRead(m_filename, reader);
+  for (const auto& slot : m_entries)
+  {
+    const Entry& entry = slot.second;
+    m_file.Append(entry.key, entry.physical_addresses.data(),
+                  static_cast<u32>(entry.physical_addresses.size()));
+  }
+  m_num_stale_entries = 0;
+}
+
+std::vector<JitDiskCache::Entry> JitDiskCache::TakePendingEntries()
+{
+  std::vector<Entry> entries;
+  entries.swap(m_pending);
+  return entries;
+}
+
+bool JitDiskCache::IsCodeUnchanged(const Entry& entry)
+{
+  u32 hash;
+  return HashGuestCode(entry.physical_addresses.data(), entry.physical_addresses.size(), &hash) &&
+         hash == entry.key.code_hash;
+}
+
+u32 JitDiskCache::ComputeConfigHash()
+{
+  // Only settings which change how the analyzer carves up guest code matter here, since the
+  // blocks are recompiled from scratch with whatever settings are active at boot.
+  const SConfig& config = SConfig::GetInstance();
+  const u32 settings[] = {
+      VERSION,
+      config.bWii,
+      config.bMMU,
+      config.bFastmem,
+      config.bFPRF,
+      config.bAccurateNaNs,
+      config.bJITOff,
+      config.bJITNoBlockLinking,
+  };
+  return HashAdler32(reinterpret_cast<const u8*>(settings), sizeof(settings));
+}
+
+// Like Memory::GetPointer, but quietly fails for anything outside of RAM.
+static const u8* GetRAMPointer(u32 physical_address)
+{
+  const u32 address = physical_address & 0x3FFFFFFF;
+  if (address <= Memory::REALRAM_SIZE - sizeof(u32))
+    return Memory::m_pRAM + address;
+
+  if (Memory::m_pEXRAM && (address >> 28) == 0x1 &&
+      (address & 0x0FFFFFFF) <= Memory::EXRAM_SIZE - sizeof(u32))
+  {
+    return Memory::m_pEXRAM + (address & Memory::EXRAM_MASK);
+  }
+
+  return nullptr;
+}
+
+bool JitDiskCache::HashGuestCode(const u32* addresses, size_t count, u32* hash)
+{
+  std::vector<u32> code(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    const u8* pointer = GetRAMPointer(addresses[i]);
+    if (!pointer)
+      return false;
+    std::memcpy(&code[i], pointer, sizeof(u32));
+  }
+
+  *hash = HashAdler32(reinterpret_cast<const u8*>(code.data()), code.size() * sizeof(u32));
+  return true;
+}
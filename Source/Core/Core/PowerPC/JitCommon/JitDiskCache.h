@@ -0,0 +1,85 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/LinearDiskCache.h"
+
+struct JitBlock;
+
+// Remembers which guest blocks were compiled while a game was running, so that the
+// same blocks can be compiled up-front the next time that game is booted instead of
+// being discovered one dispatcher miss at a time.
+//
+// Host code is not stored: emitted blocks embed absolute pointers to ppcState, the far
+// code cache, trampolines and other blocks, so they would all need relocating. Instead,
+// each entry describes the guest block (entry point, MSR bits and the physical addresses
+// it covers) together with a hash of its instructions. At boot, entries whose guest code
+// still hashes to the same value are handed back to the JIT to be recompiled.
+class JitDiskCache
+{
+public:
+  // Bump this whenever the meaning of an entry changes.
+  static constexpr u32 VERSION = 1;
+
+  struct Key
+  {
+    u32 effective_address;
+    u32 msr_bits;
+    u32 physical_address;
+    u32 config_hash;
+    u32 code_hash;
+  };
+
+  struct Entry
+  {
+    Key key;
+    std::vector<u32> physical_addresses;
+  };
+
+  // Opens (or creates) the cache file for the running game and JIT core.
+  // Returns false if there is no game ID to key the file with.
+  bool Open(const std::string& jit_name);
+  void Close();
+  bool IsOpen() const { return m_is_open; }
+
+  // Stores a freshly compiled block in the cache, unless it is already known. There is one
+  // entry per entry point and MSR; a recompile with different code replaces the old entry.
+  void Record(const JitBlock& block);
+
+  // Returns the blocks loaded from disk which have not been compiled yet in this session.
+  std::vector<Entry> TakePendingEntries();
+
+  // Checks that the guest code described by an entry is still present in memory.
+  static bool IsCodeUnchanged(const Entry& entry);
+
+private:
+  class Reader;
+
+  // Entry point and MSR bits.
+  using Slot = std::pair<u32, u32>;
+
+  // Sets the entry for its slot, returning false if it was there already.
+  bool Insert(const Key& key, std::vector<u32> physical_addresses);
+  // Rewrites the file with only the current entries, dropping replaced ones.
+  void Compact();
+
+  static u32 ComputeConfigHash();
+  static bool HashGuestCode(const u32* addresses, size_t count, u32* hash);
+
+  LinearDiskCache<Key, u32> m_file;
+  std::string m_filename;
+  std::map<Slot, Entry> m_entries;
+  // How many entries in the file have been replaced by later ones.
+  size_t m_num_stale_entries = 0;
+  std::vector<Entry> m_pending;
+  u32 m_config_hash = 0;
+  bool m_is_open = false;
+};
@@ -0,0 +1,66 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/JitCommon/JitTraceProfile.h"
+
+#include <cinttypes>
+
+#include "Common/CommonTypes.h"
+#include "Common/Logging/Log.h"
+#include "Core/ConfigManager.h"
+#include "Core/PowerPC/JitInterface.h"
+
+void JitTraceProfile::Init()
+{
+  m_enabled = SConfig::GetInstance().bJITTraceFormation;
+  m_edges.clear();
+  m_num_retraced = 0;
+}
+
+void JitTraceProfile::Shutdown()
+{
+  if (m_enabled)
+  {
+    INFO_LOG(DYNA_REC, "Trace formation: %zu branches profiled, %" PRIu64 " re-formed",
+             m_edges.size(), m_num_retraced);
+  }
+  m_edges.clear();
+}
+
+JitTraceProfile::Edge* JitTraceProfile::GetEdge(u32 address)
+{
+  return &m_edges[address];
+}
+
+bool JitTraceProfile::IsBranchLikelyTaken(u32 address) const
+{
+  const auto it = m_edges.find(address);
+  if (it == m_edges.end())
+    return false;
+
+  const Edge& edge = it->second;
+  return edge.taken >= RETRACE_INTERVAL && edge.not_taken * 16 < edge.taken;
+}
+
+bool JitTraceProfile::IsTraceableBranch(UGeckoInstruction inst)
+{
+  return inst.OPCD == 16 && !inst.LK && (inst.BO & BO_DONT_DECREMENT_FLAG) &&
+         (inst.BO & BO_DONT_CHECK_CONDITION) == 0;
+}
+
+void JitTraceProfile::OnTakenBranch(JitTraceProfile* profile, u32 address)
+{
+  Edge& edge = profile->m_edges[address];
+  // Branches the analyzer refuses to follow (back into the block, for instance) stay hot;
+  // only try once so that their block isn't recompiled over and over.
+  if (edge.retraced || !profile->IsBranchLikelyTaken(address))
+    return;
+
+  edge.retraced = true;
+  ++profile->m_num_retraced;
+
+  // The calling block keeps running until it exits, which is fine: the code itself is only
+  // freed from the dispatcher, by a cache clear or when its code region is recycled.
+  JitInterface::InvalidateICache(address, 4, true);
+}
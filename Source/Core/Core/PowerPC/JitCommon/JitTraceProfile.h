@@ -0,0 +1,61 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <unordered_map>
+
+#include "Common/CommonTypes.h"
+#include "Core/PowerPC/Gekko.h"
+
+// Counts how often the conditional branches in compiled blocks are taken, so that blocks can
+// be re-formed as traces along their hot path.
+//
+// By default a block ends up being bounded by the first conditional branch that is usually
+// taken: the analyzer continues with the fall-through, and every run of the hot path leaves
+// the block through the taken exit. With trace formation enabled, the JIT counts both edges of
+// the conditional branches the analyzer could follow. When a branch turns out to be taken nearly always, the blocks
+// containing it are invalidated, and the analyzer then follows the taken path when they are
+// recompiled (OPTION_HOT_BRANCH_FOLLOW). The fall-through becomes a side exit in far code, and
+// the register caches stay live across what used to be a block boundary.
+class JitTraceProfile
+{
+public:
+  // How often a taken branch checks whether its block should be re-formed. Power of two, so
+  // that the emitted check is a single test of the counter.
+  static constexpr u32 RETRACE_INTERVAL = 1024;
+
+  struct Edge
+  {
+    u32 taken = 0;
+    u32 not_taken = 0;
+    // Set once the blocks containing this branch have been invalidated to be re-formed.
+    bool retraced = false;
+  };
+
+  void Init();
+  void Shutdown();
+
+  bool IsEnabled() const { return m_enabled; }
+
+  // Returns the counters for the branch at the given address. The result stays valid until
+  // Shutdown, so that emitted code can refer to it directly.
+  Edge* GetEdge(u32 address);
+
+  bool IsBranchLikelyTaken(u32 address) const;
+
+  // Only the branches the analyzer is able to follow are worth counting: bcx without LK and
+  // without a CTR decrement.
+  static bool IsTraceableBranch(UGeckoInstruction inst);
+
+  // Called by emitted code every RETRACE_INTERVAL times the branch at the given address is
+  // taken out of its block.
+  static void OnTakenBranch(JitTraceProfile* profile, u32 address);
+
+private:
+  bool m_enabled = false;
+  // Elements of an unordered_map never move, so emitted code can point into it.
+  std::unordered_map<u32, Edge> m_edges;
+  u64 m_num_retraced = 0;
+};
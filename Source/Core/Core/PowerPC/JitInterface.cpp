@@ -22,6 +22,7 @@
 #include "Common/MsgHandler.h"
 
 #include "Core/Core.h"
+#include "Core/HW/Memmap.h"
 #include "Core/PowerPC/CPUCoreBase.h"
 #include "Core/PowerPC/CachedInterpreter/CachedInterpreter.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
@@ -176,6 +177,11 @@ int GetHostCode(u32* address, const u8** code, u32* code_size)
 
 bool HandleFault(uintptr_t access_address, SContext* ctx)
 {
+  // Writes to pages with compiled code or tracked writes fault regardless of what code does them.
+  // This runs in the signal handler, so the affected blocks are only invalidated later on.
+  if (Memory::HandleWriteProtectionFault(access_address))
+    return true;
+
   // Prevent nullptr dereference on a crash with no JIT present
   if (!g_jit)
   {
@@ -185,6 +191,14 @@ bool HandleFault(uintptr_t access_address, SContext* ctx)
   return g_jit->HandleFault(access_address, ctx);
 }
 
+void HandleCodePageWrite(u32 physical_address)
+{
+  if (g_jit)
+    g_jit->GetBlockCache()->HandleCodePageWrite(physical_address);
+  else
+    Memory::UnWriteProtectPhysicalPage(physical_address, Memory::WRITE_PROTECT_JIT_CODE);
+}
+
 bool HandleStackFault()
 {
   if (!g_jit)
@@ -245,6 +259,14 @@ void CompileExceptionCheck(ExceptionType type)
       if (optype != OPTYPE_STORE && optype != OPTYPE_STOREFP && (optype != OPTYPE_STOREPS))
         return;
     }
+    // A block that speculated on GQR values has seen different ones. Unless this keeps
+    // happening, recompile it speculating on the current values.
+    if (type == ExceptionType::PairedQuantize && !g_jit->GQRGuardFailed(PC))
+    {
+      g_jit->GetBlockCache()->InvalidateICache(PC, 4, true);
+      return;
+    }
+
     exception_addresses->insert(PC);
 
     // Invalidate the JIT block so that it gets recompiled with the external exception check
@@ -35,6 +35,9 @@ int GetHostCode(u32* address, const u8** code, u32* code_size);
 // Memory Utilities
 bool HandleFault(uintptr_t access_address, SContext* ctx);
 bool HandleStackFault();
+// Drops the write protection of a page with compiled code, and invalidates the code if called
+// from the CPU thread.
+void HandleCodePageWrite(u32 physical_address);
 
 // Clearing CodeCache
 void ClearCache();
@@ -2,9 +2,13 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "Common/Atomic.h"
 #include "Common/BitUtils.h"
@@ -110,6 +114,19 @@ struct TranslateAddressResult
 template <const XCheckTLBFlag flag>
 static TranslateAddressResult TranslateAddress(u32 address);
 
+// Returns the host address of a data access if its page is in the fast TLB, or nullptr.
+template <typename T>
+static u8* LookupFastTLB(const XCheckTLBFlag flag, const u32 address)
+{
+  const FastTLBEntry& entry =
+      ppcState.fast_tlb[(address >> HW_PAGE_INDEX_SHIFT) & (FAST_TLB_SIZE - 1)];
+  const u32 tag = flag == FLAG_WRITE ? entry.write_tag : entry.read_tag;
+  // Tagging with the page of the last byte makes accesses that cross into the next page miss.
+  if (tag != ((address + sizeof(T) - 1) & ~u32(HW_PAGE_SIZE - 1)))
+    return nullptr;
+  return reinterpret_cast<u8*>(entry.host_offset + address);
+}
+
 // Nasty but necessary. Super Mario Galaxy pointer relies on this stuff.
 static u32 EFB_Read(const u32 addr)
 {
@@ -162,6 +179,11 @@ static void EFB_Write(u32 data, u32 addr)
 
 BatTable ibat_table;
 BatTable dbat_table;
+// Changes whenever ibat_table does, so that copies of it can tell whether they are current.
+static u32 s_ibat_generation = 1;
+// The last copy of ibat_table handed out by CopyInstructionTranslation, and its generation.
+static std::shared_ptr<const BatTable> s_ibat_snapshot;
+static u32 s_ibat_snapshot_generation = 0;
 
 static void GenerateDSIException(u32 _EffectiveAddress, bool _bWrite);
 
@@ -170,6 +192,16 @@ static T ReadFromHardware(u32 em_address)
 {
   if (!never_translate && UReg_MSR(MSR).DR)
   {
+    if (flag == FLAG_READ)
+    {
+      if (const u8* host_address = LookupFastTLB<T>(flag, em_address))
+      {
+        T value;
+        std::memcpy(&value, host_address, sizeof(T));
+        return bswap(value);
+      }
+    }
+
     auto translated_addr = TranslateAddress<flag>(em_address);
     if (!translated_addr.Success())
     {
@@ -258,6 +290,16 @@ static void WriteToHardware(u32 em_address, const T data)
 {
   if (!never_translate && UReg_MSR(MSR).DR)
   {
+    if (flag == FLAG_WRITE)
+    {
+      if (u8* host_address = LookupFastTLB<T>(flag, em_address))
+      {
+        const T swapped_data = bswap(data);
+        std::memcpy(host_address, &swapped_data, sizeof(T));
+        return;
+      }
+    }
+
     auto translated_addr = TranslateAddress<flag>(em_address);
     if (!translated_addr.Success())
     {
@@ -767,6 +809,22 @@ void ClearCacheLine(u32 address)
     WriteToHardware<FLAG_WRITE, u64, true>(address + i, 0);
 }
 
+// Like IsOptimizableRAMAddress, but for every address from start to last (inclusive). Used when
+// only some bits of an address are known at compile time.
+bool IsOptimizableRAMRange(u32 start, u32 last)
+{
+  // Don't bother with ranges spanning more than a handful of BAT pages.
+  if (last < start || (last >> BAT_INDEX_SHIFT) - (start >> BAT_INDEX_SHIFT) >= 8)
+    return false;
+
+  for (u32 page = start >> BAT_INDEX_SHIFT; page <= last >> BAT_INDEX_SHIFT; ++page)
+  {
+    if (!IsOptimizableRAMAddress(page << BAT_INDEX_SHIFT))
+      return false;
+  }
+  return true;
+}
+
 u32 IsOptimizableMMIOAccess(u32 address, u32 accessSize)
 {
   if (PowerPC::memchecks.HasAny())
@@ -944,8 +1002,48 @@ static void GenerateISIException(u32 _EffectiveAddress)
   WARN_LOG(POWERPC, "ISI exception at 0x%08x", PC);
 }
 
+static void ClearFastTLB()
+{
+  ppcState.fast_tlb.fill({});
+}
+
+static void UpdateFastTLB(const XCheckTLBFlag flag, const u32 address, const u32 physical_address)
+{
+  // Without the MMU, the JITs write SRs without telling us.
+  if (!SConfig::GetInstance().bMMU)
+    return;
+  if (flag != FLAG_READ && flag != FLAG_WRITE)
+    return;
+
+  const u32 page = address & ~u32(HW_PAGE_SIZE - 1);
+  const u32 physical_page = physical_address & ~u32(HW_PAGE_SIZE - 1);
+  u8* host_page;
+  if ((physical_page & 0xF8000000) == 0x00000000)
+    host_page = &Memory::m_pRAM[physical_page & Memory::RAM_MASK];
+  else if (Memory::m_pEXRAM && (physical_page >> 28) == 0x1 &&
+           (physical_page & 0x0FFFFFFF) < Memory::EXRAM_SIZE)
+    host_page = &Memory::m_pEXRAM[physical_page & 0x0FFFFFFF];
+  else
+    return;
+
+  // Accesses to watched pages have to go through the memcheck in Read_U32 etc.
+  if (PowerPC::memchecks.OverlapsMemcheck(page, HW_PAGE_SIZE))
+    return;
+
+  FastTLBEntry& entry = ppcState.fast_tlb[(address >> HW_PAGE_INDEX_SHIFT) & (FAST_TLB_SIZE - 1)];
+  const uintptr_t host_offset = reinterpret_cast<uintptr_t>(host_page) - page;
+  if (entry.read_tag != page || entry.host_offset != host_offset)
+    entry.write_tag = FastTLBEntry::INVALID_TAG;
+  entry.read_tag = page;
+  entry.host_offset = host_offset;
+  if (flag == FLAG_WRITE)
+    entry.write_tag = page;
+}
+
 void SDRUpdated()
 {
+  ClearFastTLB();
+
   u32 htabmask = SDR1_HTABMASK(PowerPC::ppcState.spr[SPR_SDR]);
   if (!Common::IsValidLowMask(htabmask))
   {
@@ -1044,32 +1142,33 @@ void InvalidateTLBEntry(u32 address)
   TLBEntry& tlbe_i = ppcState.tlb[1][entry_index];
   tlbe_i.tag[0] = TLBEntry::INVALID_TAG;
   tlbe_i.tag[1] = TLBEntry::INVALID_TAG;
+
+  // tlbie drops a whole congruence class of the TLB, so drop everything the fast TLB has cached
+  // from it.
+  for (u32 i = entry_index; i < FAST_TLB_SIZE; i += HW_PAGE_INDEX_MASK + 1)
+    ppcState.fast_tlb[i] = {};
 }
 
-// Page Address Translation
-static TranslateAddressResult TranslatePageAddress(const u32 address, const XCheckTLBFlag flag)
+void InvalidateFastTLB()
 {
-  // TLB cache
-  // This catches 99%+ of lookups in practice, so the actual page table entry code below doesn't
-  // benefit
-  // much from optimization.
-  u32 translatedAddress = 0;
-  TLBLookupResult res = LookupTLBPageAddress(flag, address, &translatedAddress);
-  if (res == TLB_FOUND)
-    return TranslateAddressResult{TranslateAddressResult::PAGE_TABLE_TRANSLATED, translatedAddress};
-
-  u32 sr = PowerPC::ppcState.sr[EA_SR(address)];
-
-  if (sr & 0x80000000)
-    return TranslateAddressResult{TranslateAddressResult::DIRECT_STORE_SEGMENT, 0};
-
-  // TODO: Handle KS/KP segment register flags.
+  ClearFastTLB();
+}
 
-  // No-execute segment register flag.
-  if ((flag == FLAG_OPCODE || flag == FLAG_OPCODE_NO_EXCEPTION) && (sr & 0x10000000))
-    return TranslateAddressResult{TranslateAddressResult::PAGE_FAULT, 0};
+void SRUpdated(u32 index)
+{
+  for (FastTLBEntry& entry : ppcState.fast_tlb)
+  {
+    if ((entry.read_tag >> 28) == index)
+      entry = {};
+  }
+}
 
-  u32 offset = EA_Offset(address);         // 12 bit
+// Page Address Translation
+// Looks for the page table entry mapping address in the segment described by sr, and returns the
+// physical address of the entry in pte_address.
+static bool FindPageTableEntry(u32 address, u32 sr, u32 pagetable_base, u32 pagetable_hashmask,
+                               u32* pte_address)
+{
   u32 page_index = EA_PageIndex(address);  // 16 bit
   u32 VSID = SR_VSID(sr);                  // 24 bit
   u32 api = EA_API(address);               //  6 bit (part of page_index)
@@ -1087,8 +1186,7 @@ static TranslateAddressResult TranslatePageAddress(const u32 address, const XChe
       pte1 |= PTE1_H << 24;
     }
 
-    u32 pteg_addr =
-        ((hash & PowerPC::ppcState.pagetable_hashmask) << 6) | PowerPC::ppcState.pagetable_base;
+    u32 pteg_addr = ((hash & pagetable_hashmask) << 6) | pagetable_base;
 
     for (int i = 0; i < 8; i++, pteg_addr += 8)
     {
@@ -1097,46 +1195,136 @@ static TranslateAddressResult TranslatePageAddress(const u32 address, const XChe
 
       if (pte1 == pteg)
       {
-        UPTE2 PTE2;
-        PTE2.Hex = Common::swap32(&Memory::physical_base[pteg_addr + 4]);
-
-        // set the access bits
-        switch (flag)
-        {
-        case FLAG_NO_EXCEPTION:
-        case FLAG_OPCODE_NO_EXCEPTION:
-          break;
-        case FLAG_READ:
-          PTE2.R = 1;
-          break;
-        case FLAG_WRITE:
-          PTE2.R = 1;
-          PTE2.C = 1;
-          break;
-        case FLAG_OPCODE:
-          PTE2.R = 1;
-          break;
-        }
-
-        if (!IsNoExceptionFlag(flag))
-        {
-          const u32 swapped_pte2 = Common::swap32(PTE2.Hex);
-          std::memcpy(&Memory::physical_base[pteg_addr + 4], &swapped_pte2, sizeof(u32));
-        }
-
-        // We already updated the TLB entry if this was caused by a C bit.
-        if (res != TLB_UPDATE_C)
-          UpdateTLBEntry(flag, PTE2, address);
-
-        return TranslateAddressResult{TranslateAddressResult::PAGE_TABLE_TRANSLATED,
-                                      (PTE2.RPN << 12) | offset};
+        *pte_address = pteg_addr;
+        return true;
       }
     }
   }
-  return TranslateAddressResult{TranslateAddressResult::PAGE_FAULT, 0};
+  return false;
 }
 
-static void UpdateBATs(BatTable& bat_table, u32 base_spr)
+static TranslateAddressResult TranslatePageAddress(const u32 address, const XCheckTLBFlag flag)
+{
+  // TLB cache
+  // This catches 99%+ of lookups in practice, so the actual page table entry code below doesn't
+  // benefit
+  // much from optimization.
+  u32 translatedAddress = 0;
+  TLBLookupResult res = LookupTLBPageAddress(flag, address, &translatedAddress);
+  if (res == TLB_FOUND)
+  {
+    UpdateFastTLB(flag, address, translatedAddress);
+    return TranslateAddressResult{TranslateAddressResult::PAGE_TABLE_TRANSLATED, translatedAddress};
+  }
+
+  u32 sr = PowerPC::ppcState.sr[EA_SR(address)];
+
+  if (sr & 0x80000000)
+    return TranslateAddressResult{TranslateAddressResult::DIRECT_STORE_SEGMENT, 0};
+
+  // TODO: Handle KS/KP segment register flags.
+
+  // No-execute segment register flag.
+  if ((flag == FLAG_OPCODE || flag == FLAG_OPCODE_NO_EXCEPTION) && (sr & 0x10000000))
+    return TranslateAddressResult{TranslateAddressResult::PAGE_FAULT, 0};
+
+  u32 offset = EA_Offset(address);  // 12 bit
+  u32 pteg_addr;
+  if (!FindPageTableEntry(address, sr, PowerPC::ppcState.pagetable_base,
+                          PowerPC::ppcState.pagetable_hashmask, &pteg_addr))
+  {
+    return TranslateAddressResult{TranslateAddressResult::PAGE_FAULT, 0};
+  }
+
+  UPTE2 PTE2;
+  PTE2.Hex = Common::swap32(&Memory::physical_base[pteg_addr + 4]);
+
+  // set the access bits
+  switch (flag)
+  {
+  case FLAG_NO_EXCEPTION:
+  case FLAG_OPCODE_NO_EXCEPTION:
+    break;
+  case FLAG_READ:
+    PTE2.R = 1;
+    break;
+  case FLAG_WRITE:
+    PTE2.R = 1;
+    PTE2.C = 1;
+    break;
+  case FLAG_OPCODE:
+    PTE2.R = 1;
+    break;
+  }
+
+  if (!IsNoExceptionFlag(flag))
+  {
+    const u32 swapped_pte2 = Common::swap32(PTE2.Hex);
+    std::memcpy(&Memory::physical_base[pteg_addr + 4], &swapped_pte2, sizeof(u32));
+  }
+
+  // We already updated the TLB entry if this was caused by a C bit.
+  if (res != TLB_UPDATE_C)
+    UpdateTLBEntry(flag, PTE2, address);
+  UpdateFastTLB(flag, address, (PTE2.RPN << 12) | offset);
+
+  return TranslateAddressResult{TranslateAddressResult::PAGE_TABLE_TRANSLATED,
+                                (PTE2.RPN << 12) | offset};
+}
+
+namespace
+{
+// Games regularly rewrite their BATs with the values they already hold, and only a few entries
+// of a BAT table are ever mapped. Tables are therefore rebuilt in a second buffer and compared
+// and copied only where an entry was mapped before or is mapped now. The new entries are copied
+// rather than swapping the buffers, as Jit64 embeds the address of dbat_table in its code.
+class BatTableBuilder
+{
+public:
+  explicit BatTableBuilder(BatTable& table) : m_table(table) {}
+
+  void Map(u32 index, u32 entry)
+  {
+    if (m_next[index] == 0)
+      m_next_mapped.push_back(index);
+    m_next[index] = entry;
+  }
+
+  // Makes the table hold exactly what was mapped since the last call. Returns whether anything
+  // changed.
+  bool Commit()
+  {
+    const auto differs = [this](u32 index) { return m_table[index] != m_next[index]; };
+    const bool changed = std::any_of(m_mapped.begin(), m_mapped.end(), differs) ||
+                         std::any_of(m_next_mapped.begin(), m_next_mapped.end(), differs);
+    if (changed)
+    {
+      for (u32 index : m_mapped)
+        m_table[index] = 0;
+      for (u32 index : m_next_mapped)
+        m_table[index] = m_next[index];
+    }
+
+    for (u32 index : m_next_mapped)
+      m_next[index] = 0;
+    m_mapped.swap(m_next_mapped);
+    m_next_mapped.clear();
+    return changed;
+  }
+
+private:
+  BatTable& m_table;
+  // Always zero, except for the entries in m_next_mapped.
+  BatTable m_next{};
+  std::vector<u32> m_mapped;
+  std::vector<u32> m_next_mapped;
+};
+}  // Anonymous namespace
+
+static BatTableBuilder s_ibat_builder(ibat_table);
+static BatTableBuilder s_dbat_builder(dbat_table);
+
+static void UpdateBATs(BatTableBuilder& bat_table, u32 base_spr)
 {
   // TODO: Separate BATs for MSR.PR==0 and MSR.PR==1
   // TODO: Handle PP/WIMG settings.
@@ -1203,13 +1391,13 @@ static void UpdateBATs(BatTable& bat_table, u32 base_spr)
           valid_bit &= ~BAT_PHYSICAL_BIT;
 
         // (BEPI | j) == (BEPI & ~BL) | (j & BL).
-        bat_table[virtual_address >> BAT_INDEX_SHIFT] = physical_address | valid_bit;
+        bat_table.Map(virtual_address >> BAT_INDEX_SHIFT, physical_address | valid_bit);
       }
     }
   }
 }
 
-static void UpdateFakeMMUBat(BatTable& bat_table, u32 start_addr)
+static void UpdateFakeMMUBat(BatTableBuilder& bat_table, u32 start_addr)
 {
   for (u32 i = 0; i < (0x10000000 >> BAT_INDEX_SHIFT); ++i)
   {
@@ -1222,46 +1410,55 @@ static void UpdateFakeMMUBat(BatTable& bat_table, u32 start_addr)
     if (PowerPC::memchecks.OverlapsMemcheck(e_address << BAT_INDEX_SHIFT, BAT_PAGE_SIZE))
       flags &= ~BAT_PHYSICAL_BIT;
 
-    bat_table[e_address] = p_address | flags;
+    bat_table.Map(e_address, p_address | flags);
   }
 }
 
 void DBATUpdated()
 {
-  dbat_table = {};
-  UpdateBATs(dbat_table, SPR_DBAT0U);
+  // BATs take precedence over the page table, and memchecks are added and removed through here.
+  ClearFastTLB();
+
+  UpdateBATs(s_dbat_builder, SPR_DBAT0U);
   bool extended_bats = SConfig::GetInstance().bWii && HID4.SBE;
   if (extended_bats)
-    UpdateBATs(dbat_table, SPR_DBAT4U);
+    UpdateBATs(s_dbat_builder, SPR_DBAT4U);
   if (Memory::m_pFakeVMEM)
   {
     // In Fake-MMU mode, insert some extra entries into the BAT tables.
-    UpdateFakeMMUBat(dbat_table, 0x40000000);
-    UpdateFakeMMUBat(dbat_table, 0x70000000);
+    UpdateFakeMMUBat(s_dbat_builder, 0x40000000);
+    UpdateFakeMMUBat(s_dbat_builder, 0x70000000);
   }
+  const bool changed = s_dbat_builder.Commit();
 
 #ifndef _ARCH_32
   Memory::UpdateLogicalMemory(dbat_table);
 #endif
 
   // IsOptimizable*Address and dcbz depends on the BAT mapping, so we need a flush here.
-  JitInterface::ClearSafe();
+  if (changed)
+    JitInterface::ClearSafe();
 }
 
 void IBATUpdated()
 {
-  ibat_table = {};
-  UpdateBATs(ibat_table, SPR_IBAT0U);
+  UpdateBATs(s_ibat_builder, SPR_IBAT0U);
   bool extended_bats = SConfig::GetInstance().bWii && HID4.SBE;
   if (extended_bats)
-    UpdateBATs(ibat_table, SPR_IBAT4U);
+    UpdateBATs(s_ibat_builder, SPR_IBAT4U);
   if (Memory::m_pFakeVMEM)
   {
     // In Fake-MMU mode, insert some extra entries into the BAT tables.
-    UpdateFakeMMUBat(ibat_table, 0x40000000);
-    UpdateFakeMMUBat(ibat_table, 0x70000000);
+    UpdateFakeMMUBat(s_ibat_builder, 0x40000000);
+    UpdateFakeMMUBat(s_ibat_builder, 0x70000000);
+  }
+
+  // Blocks are looked up by their translated address.
+  if (s_ibat_builder.Commit())
+  {
+    ++s_ibat_generation;
+    JitInterface::ClearSafe();
   }
-  JitInterface::ClearSafe();
 }
 
 // Translate effective address using BAT or PAT.  Returns 0 if the address cannot be translated.
@@ -1277,4 +1474,71 @@ static TranslateAddressResult TranslateAddress(u32 address)
   return TranslatePageAddress(address, flag);
 }
 
+bool IsInstructionTranslationCurrent(const InstructionTranslation& translation)
+{
+  return translation.generation == s_ibat_generation &&
+         translation.relocate == static_cast<bool>(UReg_MSR(MSR).IR) &&
+         translation.sdr1 == PowerPC::ppcState.spr[SPR_SDR] &&
+         std::equal(translation.sr.begin(), translation.sr.end(), PowerPC::ppcState.sr);
+}
+
+void CopyInstructionTranslation(InstructionTranslation* translation)
+{
+  translation->generation = s_ibat_generation;
+  translation->relocate = UReg_MSR(MSR).IR;
+  translation->sdr1 = PowerPC::ppcState.spr[SPR_SDR];
+  translation->pagetable_base = PowerPC::ppcState.pagetable_base;
+  translation->pagetable_hashmask = PowerPC::ppcState.pagetable_hashmask;
+  std::copy(std::begin(PowerPC::ppcState.sr), std::end(PowerPC::ppcState.sr),
+            translation->sr.begin());
+  translation->ibat_table = nullptr;
+  if (!translation->relocate)
+    return;
+
+  if (!s_ibat_snapshot || s_ibat_snapshot_generation != s_ibat_generation)
+  {
+    s_ibat_snapshot = std::make_shared<const BatTable>(ibat_table);
+    s_ibat_snapshot_generation = s_ibat_generation;
+  }
+  translation->ibat_table = s_ibat_snapshot;
+}
+
+TryReadInstResult HostTryReadInstruction(const u32 address,
+                                         const InstructionTranslation& translation)
+{
+  u32 physical_address = address;
+  bool from_bat = true;
+  if (translation.relocate && !TranslateBatAddess(*translation.ibat_table, &physical_address))
+  {
+    // Same as TranslatePageAddress, without the TLB.
+    const u32 sr = translation.sr[EA_SR(address)];
+    u32 pte_address;
+    if ((sr & 0x80000000) || (sr & 0x10000000) ||
+        !FindPageTableEntry(address, sr, translation.pagetable_base,
+                            translation.pagetable_hashmask, &pte_address))
+    {
+      return TryReadInstResult{false, false, 0, 0};
+    }
+
+    UPTE2 PTE2;
+    PTE2.Hex = Common::swap32(&Memory::physical_base[pte_address + 4]);
+    physical_address = (PTE2.RPN << 12) | EA_Offset(address);
+    from_bat = false;
+  }
+
+  u32 hex;
+  const u32 segment = physical_address >> 28;
+  if (Memory::m_pFakeVMEM && ((physical_address & 0xFE000000) == 0x7E000000))
+    hex = Common::swap32(&Memory::m_pFakeVMEM[physical_address & Memory::FAKEVMEM_MASK]);
+  else if (segment == 0x0 && (physical_address & 0x0FFFFFFF) < Memory::REALRAM_SIZE)
+    hex = Memory::Read_U32(physical_address);
+  else if (Memory::m_pEXRAM && segment == 0x1 &&
+           (physical_address & 0x0FFFFFFF) < Memory::EXRAM_SIZE)
+    hex = Memory::Read_U32(physical_address);
+  else
+    return TryReadInstResult{false, false, 0, 0};
+
+  return TryReadInstResult{true, from_bat, hex, physical_address};
+}
+
 }  // namespace
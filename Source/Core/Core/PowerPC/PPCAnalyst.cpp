@@ -5,16 +5,19 @@
 #include "Core/PowerPC/PPCAnalyst.h"
 
 #include <algorithm>
+#include <array>
 #include <map>
 #include <queue>
 #include <string>
 #include <vector>
 
 #include "Common/Assert.h"
+#include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Common/StringUtil.h"
 #include "Core/ConfigManager.h"
+#include "Core/HLE/HLE.h"
 #include "Core/PowerPC/PPCSymbolDB.h"
 #include "Core/PowerPC/PPCTables.h"
 #include "Core/PowerPC/PowerPC.h"
@@ -541,12 +544,82 @@ void PPCAnalyzer::ReorderInstructions(u32 instructions, CodeOp* code)
     ReorderInstructionsCore(instructions, code, false, REORDER_CMP);
 }
 
+static bool IsConditionalBranch(UGeckoInstruction inst)
+{
+  return inst.OPCD == 16 || (inst.OPCD == 19 && (inst.SUBOP10 == 16 || inst.SUBOP10 == 528));
+}
+
+static bool IsCRLogicalOp(UGeckoInstruction inst)
+{
+  if (inst.OPCD != 19)
+    return false;
+
+  switch (inst.SUBOP10)
+  {
+  case 33:   // crnor
+  case 129:  // crandc
+  case 193:  // crxor
+  case 225:  // crnand
+  case 257:  // crand
+  case 289:  // creqv
+  case 417:  // crorc
+  case 449:  // cror
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Which CR fields the instruction reads and which it completely overwrites.
+void PPCAnalyzer::SetCRStats(CodeOp* code, const GekkoOPInfo* opinfo)
+{
+  const UGeckoInstruction inst = code->inst;
+  code->crIn = BitSet8(0);
+  code->crOut = BitSet8(0);
+
+  // Not from outputCR0/outputCR1: blr sets those too, so that the JITs don't keep the flags
+  // around for CR0/CR1, but it doesn't write CR. Whatever it returns to can read CR.
+  if ((opinfo->flags & FL_SET_CR0) || ((opinfo->flags & FL_RC_BIT) && inst.Rc))
+    code->crOut[0] = true;
+  if ((opinfo->flags & FL_SET_CR1) || ((opinfo->flags & FL_RC_BIT_F) && inst.Rc))
+    code->crOut[1] = true;
+
+  if (inst.OPCD == 31 && inst.SUBOP10 == 144)  // mtcrf
+  {
+    for (int field = 0; field < 8; ++field)
+      code->crOut[field] = ((inst.CRM >> (7 - field)) & 1) != 0;
+  }
+  else if (opinfo->flags & FL_SET_CRn)
+  {
+    code->crOut[inst.CRFD] = true;
+  }
+
+  if (IsConditionalBranch(inst))
+  {
+    if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
+      code->crIn[inst.BI >> 2] = true;
+  }
+  else if (IsCRLogicalOp(inst))
+  {
+    // Only one bit of the destination field is written, so it is read as well.
+    code->crIn[inst.CRBA >> 2] = true;
+    code->crIn[inst.CRBB >> 2] = true;
+    code->crIn[inst.CRBD >> 2] = true;
+    code->crOut[inst.CRBD >> 2] = true;
+  }
+  else if (inst.OPCD == 19 && inst.SUBOP10 == 0)  // mcrf
+  {
+    code->crIn[inst.CRFS] = true;
+  }
+  else if (inst.OPCD == 31 && inst.SUBOP10 == 19)  // mfcr
+  {
+    code->crIn = BitSet8(0xFF);
+  }
+}
+
 void PPCAnalyzer::SetInstructionStats(CodeBlock* block, CodeOp* code, const GekkoOPInfo* opinfo,
                                       u32 index)
 {
-  code->wantsCR0 = false;
-  code->wantsCR1 = false;
-
   if (opinfo->flags & FL_USE_FPU)
     block->m_fpa->any = true;
 
@@ -569,6 +642,8 @@ void PPCAnalyzer::SetInstructionStats(CodeBlock* block, CodeOp* code, const Gekk
   else
     code->outputCR1 = (opinfo->flags & FL_SET_CR1) ? true : false;
 
+  SetCRStats(code, opinfo);
+
   code->wantsFPRF = (opinfo->flags & FL_READ_FPRF) ? true : false;
   code->outputFPRF = (opinfo->flags & FL_SET_FPRF) ? true : false;
   code->canEndBlock = (opinfo->flags & FL_ENDBLOCK) ? true : false;
@@ -682,6 +757,12 @@ void PPCAnalyzer::SetInstructionStats(CodeBlock* block, CodeOp* code, const Gekk
   }
 }
 
+PPCAnalyzer::PPCAnalyzer()
+    : m_options(0), m_read_instruction(PowerPC::TryReadInstruction),
+      m_hook_lookup(HLE::GetFirstFunctionIndex)
+{
+}
+
 u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32 blockSize)
 {
   // Clear block stats
@@ -714,7 +795,7 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
 
   for (u32 i = 0; i < blockSize; ++i)
   {
-    auto result = PowerPC::TryReadInstruction(address);
+    auto result = m_read_instruction(address);
     if (!result.valid)
     {
       if (i == 0)
@@ -804,6 +885,27 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
       }
     }
 
+    if (!follow && HasOption(OPTION_HOT_BRANCH_FOLLOW) && m_branch_predictor &&
+        numFollows < BRANCH_FOLLOWING_THRESHOLD && blockSize > 1 && inst.OPCD == 16 &&
+        !inst.LK && (inst.BO & BO_DONT_DECREMENT_FLAG) &&
+        (inst.BO & BO_DONT_CHECK_CONDITION) == 0 && m_branch_predictor(address))
+    {
+      // bcx that is usually taken: continue along the taken path. Branches back into the
+      // trace are left alone, loops are handled by block linking.
+      const u32 target = SignExt16(inst.BD << 2) + (inst.AA ? 0 : address);
+      const bool in_trace = std::any_of(code, code + i + 1, [target](const CodeOp& op) {
+        return op.address == target;
+      });
+      if (!in_trace)
+      {
+        follow = true;
+        destination = target;
+        code[i].branchIsFollowed = true;
+        // Same as for conditional continue below.
+        found_call = false;
+      }
+    }
+
     if (HasOption(OPTION_CONDITIONAL_CONTINUE))
     {
       if (inst.OPCD == 16 &&
@@ -866,28 +968,43 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
     block->m_broken = true;
   }
 
+  // Only the first floating point instruction of a block checks for the FPU being disabled.
+  u32 first_fpu_instruction = block->m_num_instructions;
+  for (u32 i = 0; i < block->m_num_instructions; i++)
+  {
+    if (code[i].opinfo->flags & FL_USE_FPU)
+    {
+      first_fpu_instruction = i;
+      break;
+    }
+  }
+
   // Scan for flag dependencies; assume the next block (or any branch that can leave the block)
   // wants flags, to be safe.
-  bool wantsCR0 = true, wantsCR1 = true, wantsFPRF = true, wantsCA = true;
+  bool wantsFPRF = true, wantsCA = true;
+  BitSet8 wantsCR = BitSet8(0xFF);
   BitSet32 fprInUse, gprInUse, gprInReg, fprInXmm;
   for (int i = block->m_num_instructions - 1; i >= 0; i--)
   {
-    bool opWantsCR0 = code[i].wantsCR0;
-    bool opWantsCR1 = code[i].wantsCR1;
     bool opWantsFPRF = code[i].wantsFPRF;
     bool opWantsCA = code[i].wantsCA;
-    code[i].wantsCR0 = wantsCR0 || code[i].canEndBlock;
-    code[i].wantsCR1 = wantsCR1 || code[i].canEndBlock;
     code[i].wantsFPRF = wantsFPRF || code[i].canEndBlock;
     code[i].wantsCA = wantsCA || code[i].canEndBlock;
-    wantsCR0 |= opWantsCR0 || code[i].canEndBlock;
-    wantsCR1 |= opWantsCR1 || code[i].canEndBlock;
     wantsFPRF |= opWantsFPRF || code[i].canEndBlock;
     wantsCA |= opWantsCA || code[i].canEndBlock;
-    wantsCR0 &= !code[i].outputCR0 || opWantsCR0;
-    wantsCR1 &= !code[i].outputCR1 || opWantsCR1;
     wantsFPRF &= !code[i].outputFPRF || opWantsFPRF;
     wantsCA &= !code[i].outputCA || opWantsCA;
+    // Exception handlers see all of CR, so anything that can raise one needs the CR fields set
+    // by the instructions before it. It doesn't need its own outputs though: if it raises an
+    // exception, it doesn't get to write them.
+    const bool canCauseException =
+        (code[i].opinfo->flags & FL_LOADSTORE) || static_cast<u32>(i) == first_fpu_instruction;
+    // Whatever runs after a block exit can read all of CR, including the fields written before
+    // the exit, so nothing an exit writes is ever dropped.
+    code[i].crDiscardable = code[i].canEndBlock ? BitSet8(0) : ~wantsCR & code[i].crOut;
+    wantsCR = (wantsCR & ~code[i].crOut) | code[i].crIn;
+    if (code[i].canEndBlock || canCauseException)
+      wantsCR = BitSet8(0xFF);
     code[i].gprInUse = gprInUse;
     code[i].fprInUse = fprInUse;
     code[i].gprInReg = gprInReg;
@@ -968,7 +1085,238 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
   block->m_gqr_used = gqrUsed;
   block->m_gqr_modified = gqrModified;
   block->m_gpr_inputs = gprBlockInputs;
+
+  PropagateKnownBits(block, code);
+  if (HasOption(OPTION_IDLE_LOOP_DETECTION))
+    FindIdleLoop(block, code);
   return address;
 }
 
+// Whether an instruction can be executed any number of times in a polling loop without
+// anything but the registers it writes changing.
+static bool IsIdleLoopSafe(const CodeOp& op)
+{
+  const UGeckoInstruction inst = op.inst;
+  if (op.opinfo->flags & (FL_SET_CA | FL_READ_CA | FL_SET_OE | FL_USE_FPU))
+    return false;
+
+  // Branches that leave the loop are fine as long as they only do that: LK and the CTR
+  // decrement change state on every iteration.
+  if (IsConditionalBranch(inst))
+    return !inst.LK && (inst.BO & BO_DONT_DECREMENT_FLAG);
+
+  switch (op.opinfo->type)
+  {
+  case OPTYPE_INTEGER:
+  case OPTYPE_CR:
+    return true;
+  case OPTYPE_LOAD:
+    // lwarx sets a reservation, and the string loads write a variable number of registers.
+    // The address has to be known so the JIT can check that it isn't MMIO.
+    return !(op.opinfo->flags & FL_EVIL) && op.addressKnownMask != 0;
+  case OPTYPE_SPR:
+    return inst.OPCD == 31 && inst.SUBOP10 == 339;  // mfspr
+  case OPTYPE_SYSTEM:
+    // mfcr, mfmsr, mftb, mcrf
+    return (inst.OPCD == 31 && (inst.SUBOP10 == 19 || inst.SUBOP10 == 83 || inst.SUBOP10 == 371)) ||
+           (inst.OPCD == 19 && inst.SUBOP10 == 0);
+  default:
+    return false;
+  }
+}
+
+// Finds a branch back to the start of the block where everything before it is an idle loop:
+// no stores or other side effects, and no state carried from one iteration to the next, so
+// every iteration does the same as the last one until memory (or the time base) changes.
+// Such loops usually wait for an interrupt or for hardware to finish something, which can
+// only happen at a CoreTiming event.
+void PPCAnalyzer::FindIdleLoop(CodeBlock* block, CodeOp* code)
+{
+  BitSet32 gpr_read;
+  BitSet32 gpr_written;
+  BitSet8 cr_read;
+  BitSet8 cr_written;
+
+  for (u32 i = 0; i < block->m_num_instructions; i++)
+  {
+    CodeOp& op = code[i];
+    if (op.skip)
+      return;
+
+    const bool is_bx = op.inst.OPCD == 18;
+    const bool is_bcx = op.inst.OPCD == 16 && (op.inst.BO & BO_DONT_DECREMENT_FLAG);
+    if ((is_bx || is_bcx) && !op.inst.LK && !op.branchIsFollowed &&
+        EvaluateBranchTarget(op.inst, op.address) == block->m_address)
+    {
+      gpr_read |= op.regsIn & ~gpr_written;
+      cr_read |= op.crIn & ~cr_written;
+      // A value that is read before it is written depends on the previous iteration.
+      op.branchIsIdleLoop = !(gpr_read & gpr_written) && !(cr_read & cr_written);
+      return;
+    }
+
+    if (!IsIdleLoopSafe(op))
+      return;
+
+    gpr_read |= op.regsIn & ~gpr_written;
+    gpr_written |= op.regsOut;
+    cr_read |= op.crIn & ~cr_written;
+    cr_written |= op.crOut;
+  }
+}
+
+namespace
+{
+// Which bits of a value are known at compile time (mask), and what they are (value). Bits
+// outside the mask are always zero in value.
+struct KnownBits
+{
+  u32 mask;
+  u32 value;
+
+  static KnownBits Constant(u32 value) { return {0xFFFFFFFF, value}; }
+  static KnownBits Unknown() { return {0, 0}; }
+};
+
+KnownBits KnownAdd(KnownBits a, KnownBits b)
+{
+  // The bits below the lowest unknown bit of either operand don't depend on anything unknown;
+  // the carry out of an unknown bit could change everything above it.
+  const u32 unknown = ~(a.mask & b.mask);
+  const u32 known = unknown ? (unknown & (0 - unknown)) - 1 : 0xFFFFFFFF;
+  return {known, (a.value + b.value) & known};
+}
+
+KnownBits KnownOr(KnownBits a, KnownBits b)
+{
+  // A bit is known if it is known on both sides, or known to be one on either side.
+  const u32 ones = a.value | b.value;
+  return {(a.mask & b.mask) | ones, ones};
+}
+
+KnownBits KnownAnd(KnownBits a, KnownBits b)
+{
+  const u32 zeros = (a.mask & ~a.value) | (b.mask & ~b.value);
+  const u32 mask = (a.mask & b.mask) | zeros;
+  return {mask, a.value & b.value & mask};
+}
+
+KnownBits KnownXor(KnownBits a, KnownBits b)
+{
+  const u32 mask = a.mask & b.mask;
+  return {mask, (a.value ^ b.value) & mask};
+}
+
+u32 RotateMask(u32 mb, u32 me)
+{
+  const u32 mask = (0xFFFFFFFF >> mb) ^ (me >= 31 ? 0 : 0xFFFFFFFF >> (me + 1));
+  return mb > me ? ~mask : mask;
+}
+
+bool IsIndexedLoadStore(const CodeOp& op)
+{
+  return op.inst.OPCD == 31 && (op.opinfo->flags & FL_LOADSTORE);
+}
+
+bool IsDisplacementLoadStore(const CodeOp& op)
+{
+  return op.inst.OPCD >= 32 && op.inst.OPCD <= 55;
+}
+
+// The value an instruction writes to its single output register, as far as it is known.
+KnownBits EvaluateKnownBits(const CodeOp& op, const std::array<KnownBits, 32>& regs)
+{
+  const UGeckoInstruction inst = op.inst;
+  const KnownBits a0 = inst.RA ? regs[inst.RA] : KnownBits::Constant(0);
+  switch (inst.OPCD)
+  {
+  case 14:  // addi
+    return KnownAdd(a0, KnownBits::Constant(static_cast<u32>(inst.SIMM_16)));
+  case 15:  // addis
+    return KnownAdd(a0, KnownBits::Constant(static_cast<u32>(inst.SIMM_16) << 16));
+  case 24:  // ori
+    return KnownOr(regs[inst.RS], KnownBits::Constant(inst.UIMM));
+  case 25:  // oris
+    return KnownOr(regs[inst.RS], KnownBits::Constant(inst.UIMM << 16));
+  case 26:  // xori
+    return KnownXor(regs[inst.RS], KnownBits::Constant(inst.UIMM));
+  case 27:  // xoris
+    return KnownXor(regs[inst.RS], KnownBits::Constant(inst.UIMM << 16));
+  case 28:  // andi.
+    return KnownAnd(regs[inst.RS], KnownBits::Constant(inst.UIMM));
+  case 29:  // andis.
+    return KnownAnd(regs[inst.RS], KnownBits::Constant(inst.UIMM << 16));
+  case 21:  // rlwinmx
+  {
+    const KnownBits s = regs[inst.RS];
+    const u32 mask = RotateMask(inst.MB, inst.ME);
+    return {(_rotl(s.mask, inst.SH) & mask) | ~mask, _rotl(s.value, inst.SH) & mask};
+  }
+  case 31:
+    switch (inst.SUBOP10)
+    {
+    case 28:  // andx
+      return KnownAnd(regs[inst.RS], regs[inst.RB]);
+    case 444:  // orx
+      return KnownOr(regs[inst.RS], regs[inst.RB]);
+    case 316:  // xorx
+      return KnownXor(regs[inst.RS], regs[inst.RB]);
+    case 266:  // addx
+      return KnownAdd(regs[inst.RA], regs[inst.RB]);
+    }
+    break;
+  }
+  return KnownBits::Unknown();
+}
+}  // namespace
+
+// Forward pass working out which bits of each GPR are known at compile time, for the effective
+// addresses of loads and stores. This catches constant addresses (lis/ori and friends) even
+// when the JIT's register cache has lost track of them, and high bits that tell which memory
+// region an access goes to.
+void PPCAnalyzer::PropagateKnownBits(CodeBlock* block, CodeOp* code)
+{
+  std::array<KnownBits, 32> regs;
+  regs.fill(KnownBits::Unknown());
+
+  for (u32 i = 0; i < block->m_num_instructions; i++)
+  {
+    CodeOp& op = code[i];
+
+    // HLE hooks can change any register at the start of a function; the functions in a block
+    // start where branch following made it jump.
+    if (op.isBranchTarget ||
+        (i > 0 && op.address != code[i - 1].address + 4 &&
+         m_hook_lookup(op.address) != 0))
+    {
+      regs.fill(KnownBits::Unknown());
+    }
+
+    KnownBits address = KnownBits::Unknown();
+    const KnownBits a0 = op.inst.RA ? regs[op.inst.RA] : KnownBits::Constant(0);
+    if (IsDisplacementLoadStore(op))
+      address = KnownAdd(a0, KnownBits::Constant(static_cast<u32>(op.inst.SIMM_16)));
+    else if (IsIndexedLoadStore(op))
+      address = KnownAdd(a0, regs[op.inst.RB]);
+    op.addressKnownMask = address.mask;
+    op.addressKnownBits = address.value;
+
+    if (!op.regsOut)
+      continue;
+
+    // Only single-output instructions are tracked; update forms of loads and stores write
+    // their effective address to rA, and everything else becomes unknown.
+    const bool single_output = op.regsOut.Count() == 1;
+    const bool update = (op.opinfo->flags & FL_LOADSTORE) && (op.opinfo->flags & FL_OUT_A) &&
+                        (IsDisplacementLoadStore(op) || IsIndexedLoadStore(op));
+    KnownBits result = single_output && !(op.opinfo->flags & FL_LOADSTORE) ?
+                           EvaluateKnownBits(op, regs) :
+                           KnownBits::Unknown();
+    for (int reg : op.regsOut)
+      regs[reg] = result;
+    if (update)
+      regs[op.inst.RA] = address;
+  }
+}
+
 }  // namespace
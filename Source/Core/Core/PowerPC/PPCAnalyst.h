@@ -6,9 +6,11 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <functional>
 #include <map>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Common/BitSet.h"
@@ -18,6 +20,11 @@
 class PPCSymbolDB;
 struct Symbol;
 
+namespace PowerPC
+{
+struct TryReadInstResult;
+}
+
 namespace PPCAnalyst
 {
 struct CodeOp  // 16B
@@ -32,8 +39,6 @@ struct CodeOp  // 16B
   BitSet32 fregsIn;
   s8 fregOut;
   bool isBranchTarget;
-  bool wantsCR0;
-  bool wantsCR1;
   bool wantsFPRF;
   bool wantsCA;
   bool wantsCAInFlags;
@@ -44,6 +49,21 @@ struct CodeOp  // 16B
   bool canEndBlock;
   bool skipLRStack;
   bool skip;  // followed BL-s for example
+  // A conditional branch whose taken path continues in this block; see OPTION_HOT_BRANCH_FOLLOW.
+  bool branchIsFollowed;
+  // A branch back to the start of the block that repeats a loop without side effects, so the
+  // loop can only be left once something outside the CPU changes; see OPTION_IDLE_LOOP_DETECTION.
+  bool branchIsIdleLoop;
+  // For loads and stores, which bits of the effective address are known at compile time
+  // (addressKnownMask) and what they are (addressKnownBits). See PropagateKnownBits.
+  u32 addressKnownMask;
+  u32 addressKnownBits;
+  bool HasConstantAddress() const { return addressKnownMask == 0xFFFFFFFF; }
+  // which CR fields this instruction reads, and which it overwrites entirely
+  BitSet8 crIn;
+  BitSet8 crOut;
+  // which CR fields this instruction writes that are overwritten before anything can read them
+  BitSet8 crDiscardable;
   // which registers are still needed after this instruction in this block
   BitSet32 fprInUse;
   BitSet32 gprInUse;
@@ -166,6 +186,13 @@ struct CodeBlock
 
 class PPCAnalyzer
 {
+public:
+  using InstructionReader = std::function<PowerPC::TryReadInstResult(u32 address)>;
+  // Returns the index of the HLE function hooked at the given address, or 0.
+  using HookLookup = u32 (*)(u32 address);
+  // Returns true if the conditional branch at the given address is expected to be taken.
+  using BranchPredictor = std::function<bool(u32 address)>;
+
 private:
   enum ReorderType
   {
@@ -176,11 +203,18 @@ private:
 
   void ReorderInstructionsCore(u32 instructions, CodeOp* code, bool reverse, ReorderType type);
   void ReorderInstructions(u32 instructions, CodeOp* code);
+  void SetCRStats(CodeOp* code, const GekkoOPInfo* opinfo);
+  void PropagateKnownBits(CodeBlock* block, CodeOp* code);
+  void FindIdleLoop(CodeBlock* block, CodeOp* code);
   void SetInstructionStats(CodeBlock* block, CodeOp* code, const GekkoOPInfo* opinfo, u32 index);
 
   // Options
   u32 m_options;
 
+  InstructionReader m_read_instruction;
+  HookLookup m_hook_lookup;
+  BranchPredictor m_branch_predictor;
+
 public:
   enum AnalystOption
   {
@@ -218,13 +252,31 @@ public:
 
     // Reorder cror instructions next to their associated fcmp.
     OPTION_CROR_MERGE = (1 << 6),
+
+    // Follow conditional branches the branch predictor expects to be taken, turning the block
+    // into a trace along the hot path. The fall-through becomes a side exit.
+    // Requires JIT support (CodeOp::branchIsFollowed) and a branch predictor.
+    OPTION_HOT_BRANCH_FOLLOW = (1 << 7),
+
+    // Look for polling loops which only read memory and registers until some value changes,
+    // and mark the branch that repeats them (CodeOp::branchIsIdleLoop). Loads need a known
+    // address. If the JIT finds that they all go to RAM, it can skip ahead to the next
+    // CoreTiming event instead of spinning.
+    OPTION_IDLE_LOOP_DETECTION = (1 << 8),
   };
 
-  PPCAnalyzer() : m_options(0) {}
+  PPCAnalyzer();
   // Option setting/getting
   void SetOption(AnalystOption option) { m_options |= option; }
   void ClearOption(AnalystOption option) { m_options &= ~(option); }
   bool HasOption(AnalystOption option) const { return !!(m_options & option); }
+  // Instructions are read with PowerPC::TryReadInstruction unless told otherwise. That goes
+  // through the emulated instruction cache, so it may only be used on the CPU thread.
+  void SetInstructionReader(InstructionReader reader) { m_read_instruction = std::move(reader); }
+  // Hooks are looked up with HLE::GetFirstFunctionIndex unless told otherwise, which may only be
+  // done on the CPU thread as well.
+  void SetHookLookup(HookLookup lookup) { m_hook_lookup = lookup; }
+  void SetBranchPredictor(BranchPredictor predictor) { m_branch_predictor = std::move(predictor); }
   u32 Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32 blockSize);
 };
 
@@ -497,6 +497,10 @@ void CheckExceptions()
 
 void CheckExternalExceptions()
 {
+  // Every CPU core gets here at the end of a timeslice, which the fault handler forces when the
+  // CPU writes to write-protected memory.
+  Memory::ProcessWriteProtectionFaults();
+
   u32 exceptions = ppcState.Exceptions;
 
   // EXTERNAL INTERRUPT
@@ -6,6 +6,7 @@
 
 #include <array>
 #include <cstddef>
+#include <memory>
 #include <tuple>
 #include <vector>
 
@@ -52,6 +53,24 @@ struct TLBEntry
   u8 recent = 0;
 };
 
+// A direct-mapped cache of page table translations of data accesses to RAM, which lets the JITs
+// and the memory access functions go from an effective address to a host pointer with a single
+// probe. Entries are only filled after the regular translation has set the referenced bit (and,
+// for write_tag, the changed bit) of the PTE, and are dropped on tlbie and on SR, SDR1 and BAT
+// updates.
+constexpr u32 FAST_TLB_SIZE = 4096;
+
+struct FastTLBEntry
+{
+  // Tags are page aligned, so this never matches.
+  static constexpr u32 INVALID_TAG = 1;
+
+  u32 read_tag = INVALID_TAG;
+  u32 write_tag = INVALID_TAG;
+  // Added to the effective address to get the host address.
+  uintptr_t host_offset = 0;
+};
+
 // This contains the entire state of the emulated PowerPC "Gekko" CPU.
 struct PowerPCState
 {
@@ -125,6 +144,8 @@ struct PowerPCState
   u32 pagetable_base;
   u32 pagetable_hashmask;
 
+  std::array<FastTLBEntry, FAST_TLB_SIZE> fast_tlb;
+
   InstructionCache iCache;
 };
 
@@ -277,7 +298,9 @@ void ClearCacheLine(u32 address);  // Zeroes 32 bytes; address should be 32-byte
 
 // TLB functions
 void SDRUpdated();
+void SRUpdated(u32 index);
 void InvalidateTLBEntry(u32 address);
+void InvalidateFastTLB();
 void DBATUpdated();
 void IBATUpdated();
 
@@ -285,6 +308,7 @@ void IBATUpdated();
 // it's safe to optimize a read or write to this address to an unguarded
 // memory access.  Does not consider page tables.
 bool IsOptimizableRAMAddress(u32 address);
+bool IsOptimizableRAMRange(u32 start, u32 last);
 u32 IsOptimizableMMIOAccess(u32 address, u32 accessSize);
 bool IsOptimizableGatherPipeWrite(u32 address);
 
@@ -312,6 +336,27 @@ inline bool TranslateBatAddess(const BatTable& bat_table, u32* address)
   *address = (bat_result & BAT_RESULT_MASK) | (*address & (BAT_PAGE_SIZE - 1));
   return true;
 }
+
+// A copy of the state instruction address translation depends on, for translating on other
+// threads without racing with the CPU thread.
+struct InstructionTranslation
+{
+  u32 generation = 0;
+  bool relocate = false;
+  u32 sdr1 = 0;
+  u32 pagetable_base = 0;
+  u32 pagetable_hashmask = 0;
+  std::array<u32, 16> sr{};
+  // Only set when relocating. Copies made while the BATs stay the same share one table.
+  std::shared_ptr<const BatTable> ibat_table;
+};
+// Both must be called on the CPU thread.
+bool IsInstructionTranslationCurrent(const InstructionTranslation& translation);
+void CopyInstructionTranslation(InstructionTranslation* translation);
+// Like TryReadInstruction, but translates with the given copy of the translation state, leaves
+// the emulated instruction cache and the TLB alone and only reads code from RAM. Usable off the
+// CPU thread, at the price of a possibly stale view.
+TryReadInstResult HostTryReadInstruction(u32 address, const InstructionTranslation& translation);
 }  // namespace
 
 enum CRBits
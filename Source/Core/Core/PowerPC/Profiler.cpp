@@ -4,9 +4,43 @@
 
 #include "Core/PowerPC/Profiler.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/Logging/Log.h"
+#include "Common/MsgHandler.h"
 #include "Common/PerformanceCounter.h"
+#include "Common/StringUtil.h"
+#include "Common/Swap.h"
+#include "Common/Thread.h"
+#include "Core/Core.h"
+#include "Core/HW/Memmap.h"
+#include "Core/MachineContext.h"
+#include "Core/PowerPC/JitCommon/JitBase.h"
 #include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PPCSymbolDB.h"
+#include "Core/PowerPC/PowerPC.h"
+
+#if defined(_WIN32) && defined(_M_X86_64)
+#define SAMPLING_SUPPORTED
+#include <windows.h>
+#elif defined(__linux__) && !defined(_M_GENERIC)
+#define SAMPLING_SUPPORTED
+#include <pthread.h>
+#include <signal.h>
+#endif
 
 namespace Profiler
 {
@@ -17,4 +51,298 @@ void WriteProfileResults(const std::string& filename)
   JitInterface::WriteProfileResults(filename);
 }
 
+namespace
+{
+constexpr u32 MAX_STACK_DEPTH = 32;
+constexpr u32 SAMPLE_RING_SIZE = 4096;
+
+struct Sample
+{
+  u32 depth;
+  // Guest addresses, innermost first.
+  std::array<u32, MAX_STACK_DEPTH> frames;
+};
+
+// Filled by CaptureSample and drained by the sampler thread. CaptureSample runs in a signal
+// handler on the CPU thread, or on the sampler thread while the CPU thread is suspended, so it
+// must not allocate or take locks.
+std::array<Sample, SAMPLE_RING_SIZE> s_ring;
+std::atomic<u32> s_ring_head{0};
+std::atomic<u32> s_ring_tail{0};
+std::atomic<u64> s_dropped_samples{0};
+
+std::mutex s_samples_lock;
+std::map<std::vector<u32>, u64> s_samples;  // stack -> number of samples
+
+std::mutex s_cpu_thread_lock;
+std::atomic<bool> s_cpu_thread_registered{false};
+#if defined(_WIN32)
+HANDLE s_cpu_thread = nullptr;
+#elif defined(SAMPLING_SUPPORTED)
+pthread_t s_cpu_thread;
+#endif
+
+std::atomic<bool> s_sampling{false};
+std::thread s_sampler_thread;
+
+// Reads a word of the guest stack straight from MEM1, where stacks live in practically every
+// game, as going through address translation isn't safe from a signal handler.
+bool ReadStackWord(u32 address, u32* value)
+{
+  const u32 segment = address >> 28;
+  const u32 offset = address & 0x0FFFFFFF;
+  if ((segment != 0x8 && segment != 0xC) || (offset & 3) || offset >= Memory::REALRAM_SIZE ||
+      !Memory::m_pRAM)
+  {
+    return false;
+  }
+  u32 word;
+  std::memcpy(&word, Memory::m_pRAM + offset, sizeof(word));
+  *value = Common::swap32(word);
+  return true;
+}
+
+u32 GuestPCFromHost(const u8* host_pc)
+{
+  // Compiled code doesn't keep PC up to date, but the block it is in says where it is. The block
+  // cache isn't being modified while the CPU thread is in compiled code, so it can be read here.
+  // Anywhere else PC is as accurate as the last write-back, which the interpreter and the
+  // fallbacks do for every instruction.
+  if (g_jit && g_jit->IsInCodeSpace(host_pc))
+  {
+    if (const JitBlock* block = g_jit->GetBlockCache()->GetBlockFromHostCode(host_pc))
+      return block->effectiveAddress;
+  }
+  return PowerPC::ppcState.pc;
+}
+
+void CaptureSample(const u8* host_pc)
+{
+  if (!s_cpu_thread_registered.load(std::memory_order_relaxed))
+    return;
+
+  const u32 head = s_ring_head.load(std::memory_order_relaxed);
+  if (head - s_ring_tail.load(std::memory_order_acquire) == SAMPLE_RING_SIZE)
+  {
+    s_dropped_samples.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  Sample& sample = s_ring[head % SAMPLE_RING_SIZE];
+  u32 depth = 0;
+  sample.frames[depth++] = GuestPCFromHost(host_pc);
+
+  // In leaf functions, and before the prologue has saved it, LR is the only record of the
+  // caller. Elsewhere it points into the current function or repeats the first saved LR; both
+  // fold away when the stacks are written.
+  const u32 lr = PowerPC::ppcState.spr[SPR_LR];
+  if (lr != 0)
+    sample.frames[depth++] = lr - 4;
+
+  u32 sp;
+  u32 saved_lr;
+  if (ReadStackWord(PowerPC::ppcState.gpr[1], &sp))
+  {
+    while (depth < MAX_STACK_DEPTH && sp != 0 && ReadStackWord(sp + 4, &saved_lr) && saved_lr != 0)
+    {
+      sample.frames[depth++] = saved_lr - 4;
+      if (!ReadStackWord(sp, &sp))
+        break;
+    }
+  }
+  sample.depth = depth;
+
+  s_ring_head.store(head + 1, std::memory_order_release);
+}
+
+#if defined(SAMPLING_SUPPORTED) && !defined(_WIN32)
+void SampleSignalHandler(int, siginfo_t*, void* raw_context)
+{
+  const int saved_errno = errno;
+  const SContext* ctx = &static_cast<ucontext_t*>(raw_context)->uc_mcontext;
+#if _M_X86_64
+  CaptureSample(reinterpret_cast<const u8*>(ctx->CTX_RIP));
+#else
+  CaptureSample(reinterpret_cast<const u8*>(ctx->CTX_PC));
+#endif
+  errno = saved_errno;
+}
+
+void InstallSignalHandler()
+{
+  // The handler stays installed once sampling has been used, so that a signal which is still
+  // pending when sampling stops can't kill the process.
+  static bool installed = false;
+  if (installed)
+    return;
+
+  struct sigaction sa = {};
+  sa.sa_sigaction = &SampleSignalHandler;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGPROF, &sa, nullptr);
+  installed = true;
+}
+#endif
+
+void InterruptCPUThread()
+{
+  std::lock_guard<std::mutex> lk(s_cpu_thread_lock);
+  if (!s_cpu_thread_registered.load())
+    return;
+
+#if defined(_WIN32) && defined(SAMPLING_SUPPORTED)
+  if (SuspendThread(s_cpu_thread) == static_cast<DWORD>(-1))
+    return;
+  CONTEXT context = {};
+  context.ContextFlags = CONTEXT_CONTROL;
+  if (GetThreadContext(s_cpu_thread, &context))
+    CaptureSample(reinterpret_cast<const u8*>(context.CTX_RIP));
+  ResumeThread(s_cpu_thread);
+#elif defined(SAMPLING_SUPPORTED)
+  pthread_kill(s_cpu_thread, SIGPROF);
+#endif
+}
+
+void DrainSamples()
+{
+  std::lock_guard<std::mutex> lk(s_samples_lock);
+  u32 tail = s_ring_tail.load(std::memory_order_relaxed);
+  const u32 head = s_ring_head.load(std::memory_order_acquire);
+  for (; tail != head; ++tail)
+  {
+    const Sample& sample = s_ring[tail % SAMPLE_RING_SIZE];
+    ++s_samples[std::vector<u32>(sample.frames.begin(), sample.frames.begin() + sample.depth)];
+  }
+  s_ring_tail.store(tail, std::memory_order_release);
+}
+
+void SamplerThread(u32 interval_us)
+{
+  Common::SetCurrentThreadName("Sampling profiler");
+
+  while (s_sampling.load())
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+    if (Core::GetState() == Core::State::Running)
+      InterruptCPUThread();
+    DrainSamples();
+  }
+  DrainSamples();
+}
+
+std::string FoldedFunctionName(u32 address)
+{
+  const Symbol* symbol = g_symbolDB.GetSymbolFromAddr(address);
+  std::string name = symbol ? symbol->name : StringFromFormat("%08x", address);
+  // ';' separates frames and a space separates the count.
+  std::replace(name.begin(), name.end(), ';', ':');
+  std::replace(name.begin(), name.end(), ' ', '_');
+  return name;
+}
+}  // namespace
+
+void StartSampling(u32 interval_us)
+{
+#ifdef SAMPLING_SUPPORTED
+  if (s_sampling.exchange(true))
+    return;
+
+  {
+    std::lock_guard<std::mutex> lk(s_samples_lock);
+    s_samples.clear();
+  }
+  s_ring_tail.store(s_ring_head.load());
+  s_dropped_samples.store(0);
+
+#ifndef _WIN32
+  InstallSignalHandler();
+#endif
+  s_sampler_thread = std::thread(SamplerThread, interval_us);
+#else
+  WARN_LOG(POWERPC, "The sampling profiler isn't supported on this platform.");
+#endif
+}
+
+void StopSampling()
+{
+  if (!s_sampling.exchange(false))
+    return;
+
+  s_sampler_thread.join();
+  std::lock_guard<std::mutex> lk(s_samples_lock);
+  INFO_LOG(POWERPC, "Sampling profiler stopped: %zu distinct stacks, %" PRIu64 " samples dropped",
+           s_samples.size(), s_dropped_samples.load());
+}
+
+bool IsSampling()
+{
+  return s_sampling.load();
+}
+
+void WriteFoldedStacks(const std::string& filename)
+{
+  std::map<std::string, u64> folded;
+  {
+    std::lock_guard<std::mutex> lk(s_samples_lock);
+    for (const auto& entry : s_samples)
+    {
+      std::string line;
+      std::string previous;
+      for (auto frame = entry.first.rbegin(); frame != entry.first.rend(); ++frame)
+      {
+        // Recursion and the LR duplicates described in CaptureSample show up as the same
+        // function twice in a row.
+        std::string name = FoldedFunctionName(*frame);
+        if (name == previous)
+          continue;
+        if (!line.empty())
+          line += ';';
+        line += name;
+        previous = std::move(name);
+      }
+      folded[line] += entry.second;
+    }
+  }
+
+  File::IOFile f(filename, "w");
+  if (!f)
+  {
+    PanicAlert("Failed to open %s", filename.c_str());
+    return;
+  }
+  for (const auto& entry : folded)
+    fprintf(f.GetHandle(), "%s %" PRIu64 "\n", entry.first.c_str(), entry.second);
+}
+
+void RegisterCPUThread()
+{
+#ifdef SAMPLING_SUPPORTED
+  std::lock_guard<std::mutex> lk(s_cpu_thread_lock);
+#ifdef _WIN32
+  if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(),
+                       &s_cpu_thread, THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT, FALSE, 0))
+  {
+    return;
+  }
+#else
+  s_cpu_thread = pthread_self();
+#endif
+  s_cpu_thread_registered.store(true);
+#endif
+}
+
+void UnregisterCPUThread()
+{
+#ifdef SAMPLING_SUPPORTED
+  std::lock_guard<std::mutex> lk(s_cpu_thread_lock);
+  if (!s_cpu_thread_registered.exchange(false))
+    return;
+#ifdef _WIN32
+  CloseHandle(s_cpu_thread);
+  s_cpu_thread = nullptr;
+#endif
+#endif
+}
+
 }  // namespace
@@ -37,4 +37,21 @@ namespace Profiler
 extern bool g_ProfileBlocks;
 
 void WriteProfileResults(const std::string& filename);
+
+// Sampling profiler. While it runs, a helper thread interrupts the CPU thread every interval_us
+// microseconds of host time and records the guest function it is in, along with the guest call
+// stack found by following the back chain from r1. Nothing is added to the emitted code, so it
+// costs nothing while stopped. Supported on Windows (x86-64) and Linux.
+void StartSampling(u32 interval_us = 1000);
+void StopSampling();
+bool IsSampling();
+// Writes the samples taken by the last sampling run as folded stacks: one line per distinct
+// stack, with the function names from the outermost inwards separated by ';', followed by the
+// number of samples. flamegraph.pl and most flame graph viewers read this format directly.
+void WriteFoldedStacks(const std::string& filename);
+
+// Called by the CPU thread when it starts and stops running guest code, so that the sampler
+// knows which thread to interrupt.
+void RegisterCPUThread();
+void UnregisterCPUThread();
 }
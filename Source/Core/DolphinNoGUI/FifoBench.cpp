@@ -0,0 +1,360 @@
+// Copyright 2018 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Replays a FIFO log headlessly a number of times and reports how long each frame spent in the
+// different parts of the video pipeline, as JSON so that results can be compared between builds.
+
+#include <OptionParser.h>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Event.h"
+#include "Common/Flag.h"
+#include "Common/StringUtil.h"
+
+#include "Core/Boot/Boot.h"
+#include "Core/BootManager.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/FifoPlayer/FifoDataFile.h"
+#include "Core/FifoPlayer/FifoPlayer.h"
+#include "Core/Host.h"
+
+#include "UICommon/UICommon.h"
+
+#include "VideoCommon/Statistics.h"
+
+static Common::Flag s_running{true};
+static Common::Event s_update_event;
+
+void Host_NotifyMapLoaded()
+{
+}
+void Host_RefreshDSPDebuggerWindow()
+{
+}
+
+void Host_Message(int id)
+{
+  if (id == WM_USER_STOP)
+  {
+    s_running.Clear();
+    s_update_event.Set();
+  }
+}
+
+void* Host_GetRenderHandle()
+{
+  return nullptr;
+}
+
+void Host_UpdateTitle(const std::string& title)
+{
+}
+
+void Host_UpdateDisasmDialog()
+{
+}
+
+void Host_UpdateMainFrame()
+{
+  s_update_event.Set();
+}
+
+void Host_RequestRenderWindowSize(int width, int height)
+{
+}
+
+bool Host_UINeedsControllerState()
+{
+  return false;
+}
+
+bool Host_RendererHasFocus()
+{
+  return false;
+}
+
+bool Host_RendererIsFullscreen()
+{
+  return false;
+}
+
+void Host_ShowVideoConfig(void*, const std::string&)
+{
+}
+
+void Host_YieldToUI()
+{
+}
+
+void Host_UpdateProgressDialog(const char* caption, int position, int total)
+{
+}
+
+namespace
+{
+struct FrameResult
+{
+  u32 loop;
+  u32 frame;
+  u64 total_ns;
+  StageTiming::StageTimes stage_ns;
+};
+
+using Clock = std::chrono::steady_clock;
+}  // namespace
+
+// Only touched by the CPU thread while the log is playing, and by the main thread after it stops.
+static std::vector<FrameResult> s_results;
+static u32 s_frames_per_loop = 0;
+static u32 s_frames_to_record = 0;
+static u32 s_frames_written = 0;
+static Clock::time_point s_frame_start;
+
+static void OnFrameWritten()
+{
+  // This is called before each frame is written, so everything since the last call belongs to
+  // the previous frame.
+  const Clock::time_point now = Clock::now();
+  const StageTiming::StageTimes times = StageTiming::TakeTimes();
+
+  if (s_frames_written > 0 && s_results.size() < s_frames_to_record)
+  {
+    const u32 index = s_frames_written - 1;
+    const u64 total_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - s_frame_start).count();
+    s_results.push_back({index / s_frames_per_loop, index % s_frames_per_loop, total_ns, times});
+
+    if (s_results.size() == s_frames_to_record)
+    {
+      s_running.Clear();
+      s_update_event.Set();
+    }
+  }
+
+  s_frame_start = now;
+  s_frames_written++;
+}
+
+static std::string EscapeJSON(const std::string& str)
+{
+  std::string result;
+  for (char c : str)
+  {
+    if (c == '"' || c == '\\')
+      result += '\\';
+    if (static_cast<u8>(c) < 0x20)
+      result += StringFromFormat("\\u%04x", c);
+    else
+      result += c;
+  }
+  return result;
+}
+
+static std::string StageTimesToJSON(const StageTiming::StageTimes& times)
+{
+  std::string result;
+  for (size_t i = 0; i < StageTiming::NUM_STAGES; i++)
+  {
+    result += StringFromFormat("%s\"%s_ns\": %" PRIu64, i ? ", " : "",
+                               StageTiming::GetStageName(static_cast<VideoStage>(i)), times[i]);
+  }
+  return result;
+}
+
+static std::string ResultsToJSON(const std::string& file, const std::string& backend, u32 loops,
+                                 u32 warmup_loops)
+{
+  // Averages leave out the warmup loops, which include compiling shaders and decoding every
+  // texture for the first time.
+  u64 measured_frames = 0;
+  u64 total_ns = 0;
+  StageTiming::StageTimes stage_ns{};
+  std::vector<u64> frame_times;
+  for (const FrameResult& result : s_results)
+  {
+    if (result.loop < warmup_loops)
+      continue;
+
+    measured_frames++;
+    total_ns += result.total_ns;
+    frame_times.push_back(result.total_ns);
+    for (size_t i = 0; i < StageTiming::NUM_STAGES; i++)
+      stage_ns[i] += result.stage_ns[i];
+  }
+
+  if (measured_frames)
+  {
+    total_ns /= measured_frames;
+    for (u64& ns : stage_ns)
+      ns /= measured_frames;
+  }
+
+  u64 median_ns = 0;
+  if (!frame_times.empty())
+  {
+    auto middle = frame_times.begin() + frame_times.size() / 2;
+    std::nth_element(frame_times.begin(), middle, frame_times.end());
+    median_ns = *middle;
+  }
+
+  std::string json = "{\n";
+  json += StringFromFormat("  \"file\": \"%s\",\n", EscapeJSON(file).c_str());
+  json += StringFromFormat("  \"backend\": \"%s\",\n", EscapeJSON(backend).c_str());
+  json += StringFromFormat("  \"frames_per_loop\": %u,\n", s_frames_per_loop);
+  json += StringFromFormat("  \"loops\": %u,\n", loops);
+  json += StringFromFormat("  \"warmup_loops\": %u,\n", warmup_loops);
+  json += StringFromFormat("  \"mean\": {\"frames\": %" PRIu64 ", \"total_ns\": %" PRIu64
+                           ", \"median_total_ns\": %" PRIu64 ", %s},\n",
+                           measured_frames, total_ns, median_ns,
+                           StageTimesToJSON(stage_ns).c_str());
+  json += "  \"frames\": [\n";
+  for (size_t i = 0; i < s_results.size(); i++)
+  {
+    const FrameResult& result = s_results[i];
+    json += StringFromFormat("    {\"loop\": %u, \"frame\": %u, \"total_ns\": %" PRIu64 ", %s}%s\n",
+                             result.loop, result.frame, result.total_ns,
+                             StageTimesToJSON(result.stage_ns).c_str(),
+                             i + 1 < s_results.size() ? "," : "");
+  }
+  json += "  ]\n}\n";
+  return json;
+}
+
+int main(int argc, char* argv[])
+{
+  auto parser = std::make_unique<optparse::OptionParser>();
+  parser->usage("usage: %prog [options]... FIFO_LOG");
+  parser->add_option("-u", "--user").action("store").help("User folder path");
+  parser->add_option("-v", "--video_backend")
+      .action("store")
+      .set_default("Null")
+      .help("Video backend to replay with (Null or \"Software Renderer\")");
+  parser->add_option("-l", "--loops")
+      .action("store")
+      .type("int")
+      .set_default(10)
+      .help("Number of times to replay the log");
+  parser->add_option("-w", "--warmup")
+      .action("store")
+      .type("int")
+      .set_default(1)
+      .help("Number of loops to leave out of the averages");
+  parser->add_option("-o", "--output")
+      .action("store")
+      .help("Write the JSON results to a file instead of stdout");
+
+  optparse::Values& options = parser->parse_args(argc, argv);
+  const std::vector<std::string> args = parser->args();
+  if (args.size() != 1)
+  {
+    parser->print_help();
+    return 1;
+  }
+
+  const std::string file = args.front();
+  const std::string backend = static_cast<const char*>(options.get("video_backend"));
+  const u32 loops = std::max(static_cast<int>(options.get("loops")), 1);
+  const u32 warmup_loops = std::min<u32>(std::max(static_cast<int>(options.get("warmup")), 0),
+                                         loops - 1);
+
+  std::unique_ptr<BootParameters> boot = BootParameters::GenerateFromFile(file);
+  if (!boot || !std::holds_alternative<BootParameters::DFF>(boot->parameters))
+  {
+    fprintf(stderr, "%s is not a FIFO log\n", file.c_str());
+    return 1;
+  }
+
+  std::string user_directory;
+  if (options.is_set("user"))
+    user_directory = static_cast<const char*>(options.get("user"));
+
+  UICommon::SetUserDirectory(user_directory);
+  UICommon::Init();
+
+  // Run the GPU on the CPU thread, so that each frame's work happens between two calls of the
+  // frame callback, and don't let the frame limiter add idle time.
+  SConfig& config = SConfig::GetInstance();
+  config.m_strVideoBackend = backend;
+  config.bCPUThread = false;
+  config.m_EmulationSpeed = 0.0f;
+  config.bLoopFifoReplay = true;
+
+  Core::SetOnStateChangedCallback([](Core::State state) {
+    if (state == Core::State::Uninitialized)
+    {
+      s_running.Clear();
+      s_update_event.Set();
+    }
+  });
+
+  FifoPlayer& player = FifoPlayer::GetInstance();
+  player.SetFileLoadedCallback([&player, loops] {
+    if (player.GetFile())
+    {
+      s_frames_per_loop = player.GetFile()->GetFrameCount();
+      s_frames_to_record = s_frames_per_loop * loops;
+    }
+  });
+  player.SetFrameWrittenCallback(OnFrameWritten);
+
+  StageTiming::g_enabled = true;
+
+  if (!BootManager::BootCore(std::move(boot)))
+  {
+    fprintf(stderr, "Could not boot %s\n", file.c_str());
+    UICommon::Shutdown();
+    return 1;
+  }
+
+  while (s_running.IsSet())
+  {
+    Core::HostDispatchJobs();
+    s_update_event.WaitFor(std::chrono::milliseconds(100));
+  }
+
+  Core::Stop();
+  Core::Shutdown();
+
+  player.SetFileLoadedCallback(nullptr);
+  player.SetFrameWrittenCallback(nullptr);
+  StageTiming::g_enabled = false;
+
+  UICommon::Shutdown();
+
+  if (s_results.size() < s_frames_to_record || s_frames_to_record == 0)
+  {
+    fprintf(stderr, "Playback stopped after %zu of %u frames\n", s_results.size(),
+            s_frames_to_record);
+    return 1;
+  }
+
+  const std::string json = ResultsToJSON(file, backend, loops, warmup_loops);
+  if (options.is_set("output"))
+  {
+    const std::string path = static_cast<const char*>(options.get("output"));
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (!out)
+    {
+      fprintf(stderr, "Could not open %s for writing\n", path.c_str());
+      return 1;
+    }
+    std::fputs(json.c_str(), out);
+    std::fclose(out);
+  }
+  else
+  {
+    std::fputs(json.c_str(), stdout);
+  }
+
+  return 0;
+}
@@ -160,6 +160,25 @@ void CCodeWindow::OnProfilerMenu(wxCommandEvent& event)
         wxExecute(OpenCommand, wxEXEC_SYNC);
     }
     break;
+  case IDM_SAMPLE_PROFILE:
+    if (GetParentMenuBar()->IsChecked(IDM_SAMPLE_PROFILE) && Core::IsRunning())
+    {
+      Profiler::StartSampling();
+    }
+    else
+    {
+      Profiler::StopSampling();
+      GetParentMenuBar()->Check(IDM_SAMPLE_PROFILE, false);
+    }
+    break;
+  case IDM_WRITE_FOLDED_STACKS:
+  {
+    std::string filename = File::GetUserPath(D_DUMP_IDX) + "Debug/profiler.folded";
+    File::CreateFullPath(filename);
+    Profiler::WriteFoldedStacks(filename);
+    Parent->StatusBarMessage("Wrote sampled stacks to %s", filename.c_str());
+    break;
+  }
   }
 }
 
@@ -255,6 +255,8 @@ enum
   // Profiler
   IDM_PROFILE_BLOCKS,
   IDM_WRITE_PROFILE,
+  IDM_SAMPLE_PROFILE,
+  IDM_WRITE_FOLDED_STACKS,
   // --------------------------------------------------------------
 
   // --------------------------------------------------------------
@@ -513,6 +513,9 @@ wxMenu* MainMenuBar::CreateProfilerMenu() const
   profiler_menu->AppendCheckItem(IDM_PROFILE_BLOCKS, _("&Profile Blocks"));
   profiler_menu->AppendSeparator();
   profiler_menu->Append(IDM_WRITE_PROFILE, _("&Write to profile.txt, Show"));
+  profiler_menu->AppendSeparator();
+  profiler_menu->AppendCheckItem(IDM_SAMPLE_PROFILE, _("&Sample Host Time"));
+  profiler_menu->Append(IDM_WRITE_FOLDED_STACKS, _("Write Samples as &Folded Stacks"));
 
   return profiler_menu;
 }
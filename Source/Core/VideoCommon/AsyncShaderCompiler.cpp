@@ -209,7 +209,9 @@ void AsyncShaderCompiler::WorkerThreadRun()
   std::unique_lock<std::mutex> pending_lock(m_pending_work_lock);
   while (!m_exit_flag.IsSet())
   {
-    m_worker_thread_wake.wait(pending_lock);
+    // Work may have been queued before this thread started waiting.
+    m_worker_thread_wake.wait(pending_lock,
+                              [&] { return !m_pending_work.empty() || m_exit_flag.IsSet(); });
 
     while (!m_pending_work.empty() && !m_exit_flag.IsSet())
     {
@@ -10,6 +10,7 @@
 #include "Common/CommonTypes.h"
 #include "VideoCommon/DriverDetails.h"
 #include "VideoCommon/LightingShaderGen.h"
+#include "VideoCommon/Statistics.h"
 #include "VideoCommon/VideoCommon.h"
 #include "VideoCommon/VideoConfig.h"
 #include "VideoCommon/XFMemory.h"
@@ -27,6 +28,7 @@ bool geometry_shader_uid_data::IsPassthrough() const
 
 GeometryShaderUid GetGeometryShaderUid(PrimitiveType primitive_type)
 {
+  StageTiming::ScopedTimer timer(VideoStage::ShaderUid);
   ShaderUid<geometry_shader_uid_data> out;
   geometry_shader_uid_data* uid_data = out.GetUidData<geometry_shader_uid_data>();
   memset(uid_data, 0, sizeof(geometry_shader_uid_data));
@@ -27,6 +27,7 @@
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/Statistics.h"
 #include "VideoCommon/VertexLoaderManager.h"
+#include "VideoCommon/VertexLoaderPool.h"
 #include "VideoCommon/VideoCommon.h"
 #include "VideoCommon/XFMemory.h"
 
@@ -83,6 +84,7 @@ void Init()
 template <bool is_preprocess>
 u8* Run(DataReader src, u32* cycles, bool in_display_list)
 {
+  StageTiming::ScopedTimer timer(VideoStage::OpcodeDecode, !is_preprocess);
   u32 totalCycles = 0;
   u8* opcodeStart;
   while (true)
@@ -255,6 +257,10 @@ u8* Run(DataReader src, u32* cycles, bool in_display_list)
   }
 
 end:
+  // The vertices are read from src, which may be reused once we return.
+  if (!is_preprocess)
+    VertexLoaderPool::WaitForAll();
+
   if (cycles)
   {
     *cycles = totalCycles;
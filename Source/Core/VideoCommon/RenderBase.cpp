@@ -59,6 +59,7 @@
 #include "VideoCommon/Statistics.h"
 #include "VideoCommon/TextureCacheBase.h"
 #include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/VertexLoaderPool.h"
 #include "VideoCommon/VertexManagerBase.h"
 #include "VideoCommon/VertexShaderManager.h"
 #include "VideoCommon/VideoConfig.h"
@@ -97,9 +98,14 @@ Renderer::Renderer(int backbuffer_width, int backbuffer_height)
 
   m_surface_handle = Host_GetRenderHandle();
   m_last_host_config_bits = ShaderHostConfig::GetCurrent().bits;
+
+  VertexLoaderPool::SetNumThreads(g_ActiveConfig.GetVertexLoaderThreads());
 }
 
-Renderer::~Renderer() = default;
+Renderer::~Renderer()
+{
+  VertexLoaderPool::SetNumThreads(0);
+}
 
 void Renderer::RenderToXFB(u32 xfbAddr, const EFBRectangle& sourceRc, u32 fbStride, u32 fbHeight,
                            float Gamma)
@@ -652,7 +658,10 @@ void Renderer::Swap(u32 xfbAddr, u32 fbWidth, u32 fbStride, u32 fbHeight, const
       m_last_xfb_region = xfb_rect;
 
       // TODO: merge more generic parts into VideoCommon
-      g_renderer->SwapImpl(xfb_entry->texture.get(), xfb_rect, ticks, xfb_entry->gamma);
+      {
+        StageTiming::ScopedTimer timer(VideoStage::BackendSubmission);
+        g_renderer->SwapImpl(xfb_entry->texture.get(), xfb_rect, ticks, xfb_entry->gamma);
+      }
 
       m_fps_counter.Update();
       update_frame_count = true;
@@ -674,6 +683,9 @@ void Renderer::Swap(u32 xfbAddr, u32 fbWidth, u32 fbStride, u32 fbHeight, const
   // New frame
   stats.ResetFrame();
 
+  // The backend has picked up any config changes by now.
+  VertexLoaderPool::SetNumThreads(g_ActiveConfig.GetVertexLoaderThreads());
+
   Core::Callback_VideoCopiedToXFB(update_frame_count);
 }
 
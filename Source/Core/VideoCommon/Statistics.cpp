@@ -2,20 +2,94 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
 #include <cstring>
 #include <string>
 #include <utility>
 
 #include "Common/StringUtil.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/MMIO.h"
+#include "Core/HW/Memmap.h"
 #include "VideoCommon/Statistics.h"
 #include "VideoCommon/VertexLoaderManager.h"
 #include "VideoCommon/VideoConfig.h"
 
 Statistics stats;
 
+namespace StageTiming
+{
+bool g_enabled = false;
+
+static std::array<std::atomic<u64>, NUM_STAGES> s_stage_times;
+static thread_local ScopedTimer* s_current_timer = nullptr;
+
+static u64 GetTimeNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+const char* GetStageName(VideoStage stage)
+{
+  static constexpr std::array<const char*, NUM_STAGES> names = {
+      {"opcode_decode", "vertex_loading", "texture_decode", "shader_uid", "backend_submission"}};
+  return names[static_cast<size_t>(stage)];
+}
+
+StageTimes TakeTimes()
+{
+  StageTimes times;
+  for (size_t i = 0; i < NUM_STAGES; i++)
+    times[i] = s_stage_times[i].exchange(0, std::memory_order_relaxed);
+  return times;
+}
+
+void ScopedTimer::Start(VideoStage stage)
+{
+  m_active = true;
+  m_stage = stage;
+  m_parent = s_current_timer;
+  s_current_timer = this;
+  m_start = GetTimeNs();
+}
+
+void ScopedTimer::Stop()
+{
+  const u64 elapsed = GetTimeNs() - m_start;
+  s_stage_times[static_cast<size_t>(m_stage)].fetch_add(elapsed - m_nested,
+                                                        std::memory_order_relaxed);
+  if (m_parent)
+    m_parent->m_nested += elapsed;
+  s_current_timer = m_parent;
+}
+}
+
+static u64 GetMMIOSlowReads()
+{
+  return Memory::mmio_mapping ? Memory::mmio_mapping->GetNumSlowReads() : 0;
+}
+
+static u64 GetMMIOSlowWrites()
+{
+  return Memory::mmio_mapping ? Memory::mmio_mapping->GetNumSlowWrites() : 0;
+}
+
+// The counters can go back when they are reset, so this never goes below zero.
+static u64 CountSince(u64 now, u64 start)
+{
+  return now > start ? now - start : 0;
+}
+
 void Statistics::ResetFrame()
 {
   memset(&thisFrame, 0, sizeof(ThisFrame));
+  idleTicksAtFrameStart = CoreTiming::GetIdleTicks();
+  mmioSlowReadsAtFrameStart = GetMMIOSlowReads();
+  mmioSlowWritesAtFrameStart = GetMMIOSlowWrites();
 }
 
 void Statistics::SwapDL()
@@ -47,6 +121,8 @@ std::string Statistics::ToString()
   str += StringFromFormat("Textures created: %i\n", stats.numTexturesCreated);
   str += StringFromFormat("Textures uploaded: %i\n", stats.numTexturesUploaded);
   str += StringFromFormat("Textures alive: %i\n", stats.numTexturesAlive);
+  str += StringFromFormat("Textures hashed: %i\n", stats.thisFrame.numTexturesHashed);
+  str += StringFromFormat("Texture hashes skipped: %i\n", stats.thisFrame.numTextureHashesSkipped);
   str += StringFromFormat("pshaders created: %i\n", stats.numPixelShadersCreated);
   str += StringFromFormat("pshaders alive: %i\n", stats.numPixelShadersAlive);
   str += StringFromFormat("vshaders created: %i\n", stats.numVertexShadersCreated);
@@ -67,6 +143,14 @@ std::string Statistics::ToString()
   str += StringFromFormat("Index streamed: %i kB\n", stats.thisFrame.bytesIndexStreamed / 1024);
   str += StringFromFormat("Uniform streamed: %i kB\n", stats.thisFrame.bytesUniformStreamed / 1024);
   str += StringFromFormat("Vertex Loaders: %i\n", stats.numVertexLoaders);
+  // Read from the CPU thread without synchronization, like the idle skip figure in the title.
+  // Loading a state can take the idle counter back, and restarting emulation resets the MMIO ones.
+  str += StringFromFormat("Idle cycles skipped: %" PRIu64 "\n",
+                          CountSince(CoreTiming::GetIdleTicks(), stats.idleTicksAtFrameStart));
+  str += StringFromFormat("MMIO slow reads: %" PRIu64 "\n",
+                          CountSince(GetMMIOSlowReads(), stats.mmioSlowReadsAtFrameStart));
+  str += StringFromFormat("MMIO slow writes: %" PRIu64 "\n",
+                          CountSince(GetMMIOSlowWrites(), stats.mmioSlowWritesAtFrameStart));
 
   std::string vertex_list = VertexLoaderManager::VertexLoadersToString();
 
@@ -4,8 +4,11 @@
 
 #pragma once
 
+#include <array>
 #include <string>
 
+#include "Common/CommonTypes.h"
+
 struct Statistics
 {
   int numPixelShadersCreated;
@@ -59,10 +62,17 @@ struct Statistics
     int rasterizedPixels;
     int numTrianglesDrawn;
     int numVerticesLoaded;
+    int numTexturesHashed;
+    int numTextureHashesSkipped;
     int tevPixelsIn;
     int tevPixelsOut;
   };
   ThisFrame thisFrame;
+  // CoreTiming::GetIdleTicks() when the current frame started.
+  u64 idleTicksAtFrameStart;
+  // MMIO::Mapping::GetNumSlowReads()/GetNumSlowWrites() when the current frame started.
+  u64 mmioSlowReadsAtFrameStart;
+  u64 mmioSlowWritesAtFrameStart;
   void ResetFrame();
   static void SwapDL();
 
@@ -72,6 +82,60 @@ struct Statistics
 
 extern Statistics stats;
 
+// Parts of the video pipeline that CPU time can be attributed to with StageTiming::ScopedTimer.
+enum class VideoStage : u32
+{
+  OpcodeDecode,
+  VertexLoading,
+  TextureDecode,
+  ShaderUid,
+  BackendSubmission,
+  NumStages
+};
+
+namespace StageTiming
+{
+constexpr size_t NUM_STAGES = static_cast<size_t>(VideoStage::NumStages);
+using StageTimes = std::array<u64, NUM_STAGES>;
+
+// Timing reads the clock a few times per draw, so it is off unless a tool turns it on.
+extern bool g_enabled;
+
+const char* GetStageName(VideoStage stage);
+
+// Returns the nanoseconds spent in each stage since the last call and starts counting from zero.
+// Time spent in a nested stage only counts towards the innermost one.
+StageTimes TakeTimes();
+
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(VideoStage stage, bool active = true)
+  {
+    if (g_enabled && active)
+      Start(stage);
+  }
+  ~ScopedTimer()
+  {
+    if (m_active)
+      Stop();
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+  void Start(VideoStage stage);
+  void Stop();
+
+  bool m_active = false;
+  VideoStage m_stage;
+  u64 m_start;
+  u64 m_nested = 0;
+  ScopedTimer* m_parent;
+};
+}
+
 #define STATISTICS
 
 #ifdef STATISTICS
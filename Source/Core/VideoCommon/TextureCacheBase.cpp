@@ -3,11 +3,14 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "Common/Align.h"
 #include "Common/Assert.h"
@@ -40,6 +43,10 @@ static const u64 TEXHASH_INVALID = 0;
 // Sonic the Fighters (inside Sonic Gems Collection) loops a 64 frames animation
 static const int TEXTURE_KILL_THRESHOLD = 64;
 static const int TEXTURE_POOL_KILL_THRESHOLD = 3;
+// Smaller textures are quicker to decode than to hand over to a worker thread
+static const u32 ASYNC_DECODE_MIN_TEXELS = 128 * 128;
+// Largest mip level used as a placeholder, which is decoded right away
+static const u32 MAX_MIP_PLACEHOLDER_SIZE = 64;
 
 std::unique_ptr<TextureCacheBase> g_texture_cache;
 
@@ -78,9 +85,12 @@ TextureCacheBase::TextureCacheBase()
 
   HiresTexture::Init();
 
-  SetHash64Function();
+  SetHash64Function(backup_config.vector_texture_hash);
 
   InvalidateAllBindPoints();
+
+  async_decoder = std::make_unique<VideoCommon::AsyncShaderCompiler>();
+  async_decoder->StartWorkerThreads(backup_config.texture_decoder_threads);
 }
 
 void TextureCacheBase::Invalidate()
@@ -97,14 +107,20 @@ void TextureCacheBase::Invalidate()
   }
   textures_by_address.clear();
   textures_by_hash.clear();
+  tracked_hashes.clear();
+
+  // Textures that are still being decoded will be thrown away once they're done.
+  pending_decodes.clear();
 
   texture_pool.clear();
 }
 
 TextureCacheBase::~TextureCacheBase()
 {
+  async_decoder->StopWorkerThreads();
   HiresTexture::Shutdown();
   Invalidate();
+  async_decoder->RetrieveWorkItems();
   Common::FreeAlignedMemory(temp);
   temp = nullptr;
 }
@@ -122,14 +138,29 @@ void TextureCacheBase::OnConfigChanged(VideoConfig& config)
       config.bTexFmtOverlayEnable != backup_config.texfmt_overlay ||
       config.bTexFmtOverlayCenter != backup_config.texfmt_overlay_center ||
       config.bHiresTextures != backup_config.hires_textures ||
-      config.bEnableGPUTextureDecoding != backup_config.gpu_texture_decoding)
+      config.bEnableGPUTextureDecoding != backup_config.gpu_texture_decoding ||
+      config.bVectorTextureHash != backup_config.vector_texture_hash)
   {
     Invalidate();
+    SetHash64Function(config.bVectorTextureHash);
 
+    // The worker threads read the overlay options while decoding. Nothing they are working on
+    // is needed anymore after the invalidation.
+    RetrieveDecodedTextures(true);
     TexDecoder_SetTexFmtOverlayOptions(g_ActiveConfig.bTexFmtOverlayEnable,
                                        g_ActiveConfig.bTexFmtOverlayCenter);
   }
 
+  if (config.bTextureWriteTracking != backup_config.texture_write_tracking)
+    tracked_hashes.clear();
+
+  if (config.GetTextureDecoderThreads() != backup_config.texture_decoder_threads)
+  {
+    // Queued work isn't picked up while the threads are being replaced.
+    RetrieveDecodedTextures(true);
+    async_decoder->ResizeWorkerThreads(config.GetTextureDecoderThreads());
+  }
+
   if ((config.stereo_mode != StereoMode::Off) != backup_config.stereo_3d ||
       config.bStereoEFBMonoDepth != backup_config.efb_mono_depth)
   {
@@ -143,6 +174,23 @@ void TextureCacheBase::OnConfigChanged(VideoConfig& config)
 
 void TextureCacheBase::Cleanup(int _frameCount)
 {
+  // Don't show placeholders for more than the configured number of frames.
+  if (!pending_decodes.empty())
+  {
+    const int max_frames = std::max(g_ActiveConfig.iTexturePlaceholderFrames, 1);
+    std::vector<u64> expired;
+    for (auto& pending : pending_decodes)
+    {
+      if (++pending.second.frames_waited >= max_frames)
+        expired.push_back(pending.first);
+    }
+
+    if (expired.empty())
+      RetrieveDecodedTextures(false);
+    else
+      WaitForDecodedTextures(expired);
+  }
+
   TexAddrCache::iterator iter = textures_by_address.begin();
   TexAddrCache::iterator tcend = textures_by_address.end();
   while (iter != tcend)
@@ -185,6 +233,23 @@ void TextureCacheBase::Cleanup(int _frameCount)
     }
   }
 
+  // Forget the hashes of memory that has been written since, every now and then.
+  if (_frameCount % TEXTURE_KILL_THRESHOLD == 0)
+  {
+    for (auto iter3 = tracked_hashes.begin(); iter3 != tracked_hashes.end();)
+    {
+      if (Memory::WasPhysicalRangeWritten(iter3->first.first, iter3->first.second,
+                                          iter3->second.write_stamp))
+      {
+        iter3 = tracked_hashes.erase(iter3);
+      }
+      else
+      {
+        ++iter3;
+      }
+    }
+  }
+
   TexPool::iterator iter2 = texture_pool.begin();
   TexPool::iterator tcend2 = texture_pool.end();
   while (iter2 != tcend2)
@@ -225,6 +290,40 @@ void TextureCacheBase::SetBackupConfig(const VideoConfig& config)
   backup_config.stereo_3d = config.stereo_mode != StereoMode::Off;
   backup_config.efb_mono_depth = config.bStereoEFBMonoDepth;
   backup_config.gpu_texture_decoding = config.bEnableGPUTextureDecoding;
+  backup_config.texture_write_tracking = config.bTextureWriteTracking;
+  backup_config.vector_texture_hash = config.bVectorTextureHash;
+  backup_config.texture_decoder_threads = config.GetTextureDecoderThreads();
+}
+
+u64 TextureCacheBase::HashTextureMemory(u32 address, const u8* data, u32 size, int sample_size,
+                                        bool from_tmem)
+{
+  if (from_tmem || !g_ActiveConfig.bTextureWriteTracking)
+  {
+    INCSTAT(stats.thisFrame.numTexturesHashed);
+    return GetHash64(data, size, sample_size);
+  }
+
+  const auto key = std::make_pair(address, size);
+  const auto iter = tracked_hashes.find(key);
+  if (iter != tracked_hashes.end() &&
+      !Memory::WasPhysicalRangeWritten(address, size, iter->second.write_stamp))
+  {
+    INCSTAT(stats.thisFrame.numTextureHashesSkipped);
+    return iter->second.hash;
+  }
+
+  // Tracking has to start before hashing, or a write in between would go unnoticed.
+  const u64 write_stamp = Memory::TrackPhysicalWrites(address, size);
+  const u64 hash = GetHash64(data, size, sample_size);
+  INCSTAT(stats.thisFrame.numTexturesHashed);
+
+  if (write_stamp != 0)
+    tracked_hashes[key] = {hash, write_stamp};
+  else if (iter != tracked_hashes.end())
+    tracked_hashes.erase(iter);
+
+  return hash;
 }
 
 TextureCacheBase::TCacheEntry*
@@ -302,6 +401,10 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
   // on each EFB copy.
   if (!entry_to_update->may_have_overlapping_textures)
     return entry_to_update;
+
+  // Wait for the texture to be decoded, or the decoded data would overwrite the updates.
+  if (entry_to_update->decode_pending)
+    return entry_to_update;
   entry_to_update->may_have_overlapping_textures = false;
 
   const bool isPaletteTexture = IsColorIndexed(entry_to_update->format.texfmt);
@@ -470,10 +573,19 @@ static u32 CalculateLevelSize(u32 level_0_size, u32 level)
 
 void TextureCacheBase::BindTextures()
 {
+  if (!pending_decodes.empty())
+    RetrieveDecodedTextures(false);
+
   for (size_t i = 0; i < bound_textures.size(); ++i)
   {
     if (IsValidBindPoint(static_cast<u32>(i)) && bound_textures[i])
-      bound_textures[i]->texture->Bind(static_cast<u32>(i));
+    {
+      const TCacheEntry* entry = bound_textures[i];
+      if (entry->decode_pending)
+        entry->placeholder_texture->Bind(static_cast<u32>(i));
+      else
+        entry->texture->Bind(static_cast<u32>(i));
+    }
   }
 }
 
@@ -613,8 +725,239 @@ private:
   std::vector<Level> levels;
 };
 
+class TextureCacheBase::DecodeWorkItem final : public VideoCommon::AsyncShaderCompiler::WorkItem
+{
+public:
+  DecodeWorkItem(TextureCacheBase* cache, u64 entry_id, const u8* src_data, u32 src_size,
+                 TextureFormat format, const u8* tlut, u32 palette_size, TLUTFormat tlut_format,
+                 u32 width, u32 height, u32 levels)
+      : m_cache(cache), m_entry_id(entry_id), m_format(format), m_tlut_format(tlut_format)
+  {
+    const u32 block_width = TexDecoder_GetBlockWidthInTexels(format);
+    const u32 block_height = TexDecoder_GetBlockHeightInTexels(format);
+
+    size_t decoded_size = 0;
+    u32 src_offset = 0;
+    for (u32 level = 0; level < levels; level++)
+    {
+      Level info;
+      info.width = CalculateLevelSize(width, level);
+      info.height = CalculateLevelSize(height, level);
+      info.expanded_width = Common::AlignUp(info.width, block_width);
+      info.expanded_height = Common::AlignUp(info.height, block_height);
+      info.src_offset = src_offset;
+      info.offset = decoded_size;
+      info.size = info.expanded_width * info.expanded_height * sizeof(u32);
+      m_levels.push_back(info);
+
+      src_offset +=
+          TexDecoder_GetTextureSizeInBytes(info.expanded_width, info.expanded_height, format);
+      decoded_size += info.size;
+    }
+
+    // The game can change the source data and the palette before we get to it, so keep a copy.
+    // Decoding needs space for downsampling at the end, like in GetTexture.
+    const size_t downsample_size = m_levels[0].size * 5 / 16;
+    m_downsample_offset = decoded_size;
+    m_src_offset = Common::AlignUp(m_downsample_offset + downsample_size, 16);
+    m_tlut_offset = Common::AlignUp(m_src_offset + src_size, 16);
+    m_buffer = static_cast<u8*>(Common::AllocateAlignedMemory(m_tlut_offset + palette_size, 16));
+    std::memcpy(m_buffer + m_src_offset, src_data, src_size);
+    std::memcpy(m_buffer + m_tlut_offset, tlut, palette_size);
+  }
+
+  ~DecodeWorkItem() override { Common::FreeAlignedMemory(m_buffer); }
+
+  bool Compile() override
+  {
+    const u8* tlut = m_buffer + m_tlut_offset;
+    ArbitraryMipmapDetector arbitrary_mip_detector;
+    for (const Level& level : m_levels)
+    {
+      u8* dst = m_buffer + level.offset;
+      TexDecoder_Decode(dst, m_buffer + m_src_offset + level.src_offset, level.expanded_width,
+                        level.expanded_height, m_format, tlut, m_tlut_format);
+      arbitrary_mip_detector.AddLevel(level.width, level.height, level.expanded_width, dst);
+    }
+
+    m_has_arbitrary_mips =
+        arbitrary_mip_detector.HasArbitraryMipmaps(m_buffer + m_downsample_offset);
+    return true;
+  }
+
+  void Retrieve() override
+  {
+    // The entry may have been invalidated while this was being decoded.
+    auto iter = m_cache->pending_decodes.find(m_entry_id);
+    if (iter == m_cache->pending_decodes.end())
+      return;
+
+    TCacheEntry* entry = iter->second.entry;
+    m_cache->pending_decodes.erase(iter);
+
+    for (u32 i = 0; i < m_levels.size(); i++)
+    {
+      const Level& level = m_levels[i];
+      entry->texture->Load(i, level.width, level.height, level.expanded_width,
+                           m_buffer + level.offset, level.size);
+    }
+
+    entry->has_arbitrary_mips = m_has_arbitrary_mips;
+    entry->decode_pending = false;
+
+    auto config = entry->placeholder_texture->GetConfig();
+    m_cache->texture_pool.emplace(config, TexPoolEntry(std::move(entry->placeholder_texture)));
+
+    // EFB copies to the same memory were left out while the texture was pending.
+    m_cache->DoPartialTextureUpdates(entry, m_buffer + m_tlut_offset, m_tlut_format);
+  }
+
+private:
+  struct Level
+  {
+    u32 width;
+    u32 height;
+    u32 expanded_width;
+    u32 expanded_height;
+    u32 src_offset;
+    size_t offset;
+    size_t size;
+  };
+
+  TextureCacheBase* m_cache;
+  u64 m_entry_id;
+  TextureFormat m_format;
+  TLUTFormat m_tlut_format;
+  std::vector<Level> m_levels;
+  u8* m_buffer = nullptr;
+  size_t m_downsample_offset = 0;
+  size_t m_src_offset = 0;
+  size_t m_tlut_offset = 0;
+  bool m_has_arbitrary_mips = false;
+};
+
+bool TextureCacheBase::CanDecodeAsync(u32 width, u32 height, bool from_tmem) const
+{
+  // Textures from tmem are left out, since RGBA8 and the mip levels are split between banks.
+  // Dumped textures need their data right away.
+  return async_decoder->HasWorkerThreads() && !from_tmem && !g_ActiveConfig.bDumpTextures &&
+         width * height >= ASYNC_DECODE_MIN_TEXELS;
+}
+
+std::unique_ptr<AbstractTexture>
+TextureCacheBase::TakePlaceholderFromEntry(TCacheEntry* entry, u32 width, u32 height)
+{
+  if (entry->IsCopy() || entry->tmem_only || entry->native_width != width ||
+      entry->native_height != height)
+  {
+    return nullptr;
+  }
+
+  // Bound textures are kept for the tmem cache emulation when they're invalidated.
+  for (size_t i = 0; i < bound_textures.size(); ++i)
+  {
+    if (bound_textures[i] == entry && IsValidBindPoint(static_cast<u32>(i)))
+      return nullptr;
+  }
+
+  if (entry->decode_pending)
+    return std::move(entry->placeholder_texture);
+
+  return std::move(entry->texture);
+}
+
+std::unique_ptr<AbstractTexture>
+TextureCacheBase::CreateMipPlaceholder(const u8* src_data, TextureFormat texformat,
+                                       const u8* tlut, TLUTFormat tlutfmt, u32 width, u32 height,
+                                       u32 levels)
+{
+  if (levels < 2)
+    return nullptr;
+
+  const u32 bsw = TexDecoder_GetBlockWidthInTexels(texformat);
+  const u32 bsh = TexDecoder_GetBlockHeightInTexels(texformat);
+
+  // Find the largest mip level that's small enough to decode right away.
+  u32 level = 0;
+  u32 mip_width, mip_height, expanded_mip_width, expanded_mip_height;
+  for (;; level++)
+  {
+    if (level == levels)
+      return nullptr;
+
+    mip_width = CalculateLevelSize(width, level);
+    mip_height = CalculateLevelSize(height, level);
+    expanded_mip_width = Common::AlignUp(mip_width, bsw);
+    expanded_mip_height = Common::AlignUp(mip_height, bsh);
+    if (std::max(mip_width, mip_height) <= MAX_MIP_PLACEHOLDER_SIZE)
+      break;
+
+    src_data +=
+        TexDecoder_GetTextureSizeInBytes(expanded_mip_width, expanded_mip_height, texformat);
+  }
+
+  if (level == 0)
+    return nullptr;
+
+  TextureConfig config;
+  config.width = mip_width;
+  config.height = mip_height;
+  std::unique_ptr<AbstractTexture> placeholder = AllocateTexture(config);
+  if (!placeholder)
+    return nullptr;
+
+  const size_t decoded_size = expanded_mip_width * expanded_mip_height * sizeof(u32);
+  CheckTempSize(decoded_size);
+  TexDecoder_Decode(temp, src_data, expanded_mip_width, expanded_mip_height, texformat, tlut,
+                    tlutfmt);
+  placeholder->Load(0, mip_width, mip_height, expanded_mip_width, temp, decoded_size);
+  return placeholder;
+}
+
+void TextureCacheBase::QueueTextureDecode(TCacheEntry* entry,
+                                          std::unique_ptr<AbstractTexture> placeholder,
+                                          const u8* src_data, u32 src_size,
+                                          TextureFormat texformat, const u8* tlut,
+                                          u32 palette_size, TLUTFormat tlutfmt, u32 width,
+                                          u32 height, u32 levels)
+{
+  entry->placeholder_texture = std::move(placeholder);
+  entry->decode_pending = true;
+  pending_decodes.emplace(entry->id, PendingDecode{entry, 0});
+
+  async_decoder->QueueWorkItem(VideoCommon::AsyncShaderCompiler::CreateWorkItem<DecodeWorkItem>(
+      this, entry->id, src_data, src_size, texformat, tlut, palette_size, tlutfmt, width, height,
+      levels));
+}
+
+void TextureCacheBase::RetrieveDecodedTextures(bool wait)
+{
+  if (wait)
+    async_decoder->WaitUntilCompletion();
+
+  async_decoder->RetrieveWorkItems();
+}
+
+void TextureCacheBase::WaitForDecodedTextures(const std::vector<u64>& entry_ids)
+{
+  // DecodeWorkItem::Retrieve removes an entry from pending_decodes once its texture is loaded.
+  const auto is_pending = [this](u64 id) { return pending_decodes.count(id) != 0; };
+  for (;;)
+  {
+    // Once the workers are idle, everything they decoded is waiting to be retrieved.
+    const bool workers_busy = async_decoder->HasPendingWork();
+    async_decoder->RetrieveWorkItems();
+    if (!workers_busy || std::none_of(entry_ids.begin(), entry_ids.end(), is_pending))
+      return;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
 TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
 {
+  StageTiming::ScopedTimer timer(VideoStage::TextureDecode);
+
   // if this stage was not invalidated by changes to texture registers, keep the current texture
   if (IsValidBindPoint(stage) && bound_textures[stage])
   {
@@ -727,7 +1070,8 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
 
   // TODO: This doesn't hash GB tiles for preloaded RGBA8 textures (instead, it's hashing more data
   // from the low tmem bank than it should)
-  base_hash = GetHash64(src_data, texture_size, textureCacheSafetyColorSampleSize);
+  base_hash = HashTextureMemory(address, src_data, texture_size, textureCacheSafetyColorSampleSize,
+                                from_tmem);
   u32 palette_size = 0;
   if (isPaletteTexture)
   {
@@ -894,9 +1238,17 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
     }
   }
 
+  const bool can_decode_async = CanDecodeAsync(width, height, from_tmem);
+  std::unique_ptr<AbstractTexture> placeholder;
+
   // If at least one entry was not used for the same frame, overwrite the oldest one
   if (temp_frameCount != 0x7fffffff)
   {
+    // This is most likely the previous version of the same texture, so show it while the new one
+    // is being decoded.
+    if (can_decode_async)
+      placeholder = TakePlaceholderFromEntry(oldest_entry->second, nativeW, nativeH);
+
     // pool this texture and make a new one later
     InvalidateTexture(oldest_entry);
   }
@@ -932,6 +1284,23 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
                        g_texture_cache->SupportsGPUTextureDecode(texformat, tlutfmt) &&
                        !(from_tmem && texformat == TextureFormat::RGBA8);
 
+  const u8* tlut = &texMem[tlutaddr];
+  bool decode_async = false;
+  if (can_decode_async && !hires_tex && !decode_on_gpu)
+  {
+    if (!placeholder)
+    {
+      placeholder =
+          CreateMipPlaceholder(src_data, texformat, tlut, tlutfmt, width, height, tex_levels);
+    }
+    decode_async = placeholder != nullptr;
+  }
+  else if (placeholder)
+  {
+    auto placeholder_config = placeholder->GetConfig();
+    texture_pool.emplace(placeholder_config, TexPoolEntry(std::move(placeholder)));
+  }
+
   // create the entry/texture
   TextureConfig config;
   config.width = width;
@@ -947,7 +1316,6 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
   if (!entry)
     return nullptr;
 
-  const u8* tlut = &texMem[tlutaddr];
   if (hires_tex)
   {
     const auto& level = hires_tex->m_levels[0];
@@ -960,7 +1328,13 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
 
   if (!hires_tex)
   {
-    if (decode_on_gpu)
+    if (decode_async)
+    {
+      QueueTextureDecode(entry, std::move(placeholder), src_data,
+                         texture_size + additional_mips_size, texformat, tlut, palette_size,
+                         tlutfmt, width, height, texLevels);
+    }
+    else if (decode_on_gpu)
     {
       u32 row_stride = bytes_per_block * (expandedWidth / bsw);
       g_texture_cache->DecodeTextureOnGPU(entry, 0, src_data, texture_size, texformat, width,
@@ -1039,7 +1413,7 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
                            level.data.get(), level.data_size);
     }
   }
-  else
+  else if (!decode_async)
   {
     // load mips - TODO: Loading mipmaps from tmem is untested!
     src_data += texture_size;
@@ -1218,8 +1592,9 @@ std::optional<TextureLookupInformation> TextureCacheBase::ComputeTextureInformat
 
   // TODO: This doesn't hash GB tiles for preloaded RGBA8 textures (instead, it's hashing more data
   // from the low tmem bank than it should)
-  tex_info.base_hash = GetHash64(tex_info.src_data, tex_info.total_bytes,
-                                 tex_info.texture_cache_safety_color_sample_size);
+  tex_info.base_hash = HashTextureMemory(tex_info.address, tex_info.src_data, tex_info.total_bytes,
+                                         tex_info.texture_cache_safety_color_sample_size,
+                                         tex_info.from_tmem);
 
   tex_info.is_palette_texture = IsColorIndexed(tex_format);
 
@@ -1859,6 +2234,8 @@ void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, EFBCopyFormat dstF
   const u32 bytes_per_row = num_blocks_x * bytes_per_block;
   const u32 covered_range = num_blocks_y * dstStride;
 
+  Memory::NotifyPhysicalWrite(dstAddr, covered_range);
+
   if (copy_to_ram)
   {
     EFBCopyParams format(srcFormat, dstFormat, is_depth_copy, isIntensity, y_scale);
@@ -2162,8 +2539,24 @@ TextureCacheBase::InvalidateTexture(TexAddrCache::iterator iter)
     }
   }
 
-  auto config = entry->texture->GetConfig();
-  texture_pool.emplace(config, TexPoolEntry(std::move(entry->texture)));
+  if (entry->decode_pending)
+  {
+    pending_decodes.erase(entry->id);
+    entry->decode_pending = false;
+  }
+
+  if (entry->placeholder_texture)
+  {
+    auto config = entry->placeholder_texture->GetConfig();
+    texture_pool.emplace(config, TexPoolEntry(std::move(entry->placeholder_texture)));
+  }
+
+  // The texture may have been taken as a placeholder for the texture replacing this one.
+  if (entry->texture)
+  {
+    auto config = entry->texture->GetConfig();
+    texture_pool.emplace(config, TexPoolEntry(std::move(entry->texture)));
+  }
 
   return textures_by_address.erase(iter);
 }
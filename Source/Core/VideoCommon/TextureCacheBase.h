@@ -13,9 +13,11 @@
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "VideoCommon/AbstractTexture.h"
+#include "VideoCommon/AsyncShaderCompiler.h"
 #include "VideoCommon/BPMemory.h"
 #include "VideoCommon/TextureConfig.h"
 #include "VideoCommon/TextureDecoder.h"
@@ -126,6 +128,7 @@ public:
                                       // content, aren't just downscaled
     bool should_force_safe_hashing = false;  // for XFB
     bool is_xfb_copy = false;
+    bool decode_pending = false;  // the texture is still being decoded on a worker thread
     float y_scale = 1.0f;
     float gamma = 1.0f;
     u64 id;
@@ -139,6 +142,9 @@ public:
     // used to delete textures which haven't been used for TEXTURE_KILL_THRESHOLD frames
     int frameCount = FRAMECOUNT_INVALID;
 
+    // Bound instead of texture while decode_pending is set
+    std::unique_ptr<AbstractTexture> placeholder_texture;
+
     // Keep an iterator to the entry in textures_by_hash, so it does not need to be searched when
     // removing the cache entry
     std::multimap<u64, TCacheEntry*>::iterator textures_by_hash_iter;
@@ -296,8 +302,30 @@ private:
 
   void SetBackupConfig(const VideoConfig& config);
 
+  // Hashes texture data like GetHash64, reusing the last hash of the same memory if it hasn't been
+  // written since.
+  u64 HashTextureMemory(u32 address, const u8* data, u32 size, int sample_size, bool from_tmem);
+
   TCacheEntry* ApplyPaletteToEntry(TCacheEntry* entry, u8* palette, TLUTFormat tlutfmt);
 
+  // Large textures can be decoded on worker threads while a placeholder is bound in their place,
+  // either the texture that was previously at the same address, or one of the smaller mip levels.
+  class DecodeWorkItem;
+  bool CanDecodeAsync(u32 width, u32 height, bool from_tmem) const;
+  std::unique_ptr<AbstractTexture> TakePlaceholderFromEntry(TCacheEntry* entry, u32 width,
+                                                            u32 height);
+  std::unique_ptr<AbstractTexture> CreateMipPlaceholder(const u8* src_data, TextureFormat texformat,
+                                                        const u8* tlut, TLUTFormat tlutfmt,
+                                                        u32 width, u32 height, u32 levels);
+  void QueueTextureDecode(TCacheEntry* entry, std::unique_ptr<AbstractTexture> placeholder,
+                          const u8* src_data, u32 src_size, TextureFormat texformat,
+                          const u8* tlut, u32 palette_size, TLUTFormat tlutfmt, u32 width,
+                          u32 height, u32 levels);
+  // Uploads finished textures. If wait is set, waits for all queued textures first.
+  void RetrieveDecodedTextures(bool wait);
+  // Uploads finished textures, waiting until the textures of the given entries are among them.
+  void WaitForDecodedTextures(const std::vector<u64>& entry_ids);
+
   TCacheEntry* DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* palette,
                                        TLUTFormat tlutfmt);
 
@@ -327,6 +355,24 @@ private:
   TexAddrCache textures_by_address;
   TexHashCache textures_by_hash;
   TexPool texture_pool;
+
+  // Hashes of texture memory whose writes are tracked (see Memory::TrackPhysicalWrites), so that
+  // binding the same memory again doesn't need to look at it until something writes to it.
+  struct TrackedHash
+  {
+    u64 hash;
+    u64 write_stamp;
+  };
+  std::map<std::pair<u32, u32>, TrackedHash> tracked_hashes;  // (address, size) -> hash
+
+  // Not a shader compiler, but the same worker pool works for decoding textures.
+  std::unique_ptr<VideoCommon::AsyncShaderCompiler> async_decoder;
+  struct PendingDecode
+  {
+    TCacheEntry* entry;
+    int frames_waited;
+  };
+  std::unordered_map<u64, PendingDecode> pending_decodes;  // entry id -> entry
   u64 last_entry_id = 0;
 
   // Backup configuration values
@@ -341,6 +387,9 @@ private:
     bool stereo_3d;
     bool efb_mono_depth;
     bool gpu_texture_decoding;
+    bool texture_write_tracking;
+    bool vector_texture_hash;
+    u32 texture_decoder_threads;
   };
   BackupConfig backup_config = {};
 };
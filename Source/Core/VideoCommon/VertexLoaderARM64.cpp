@@ -4,6 +4,7 @@
 
 #include "VideoCommon/VertexLoaderARM64.h"
 #include "Common/CommonTypes.h"
+#include "Common/JitRegister.h"
 #include "VideoCommon/DataReader.h"
 #include "VideoCommon/VertexLoaderManager.h"
 
@@ -43,6 +44,9 @@ VertexLoaderARM64::VertexLoaderARM64(const TVtxDesc& vtx_desc, const VAT& vtx_at
   ClearCodeSpace();
   GenerateVertexLoader();
   WriteProtect();
+
+  const std::string name = ToString();
+  JitRegister::Register(region, GetCodePtr(), "%s", name.c_str());
 }
 
 void VertexLoaderARM64::GetVertexAddr(int array, u64 attribute, ARM64Reg reg)
@@ -610,7 +614,6 @@ void VertexLoaderARM64::GenerateVertexLoader()
 
 int VertexLoaderARM64::RunVertices(DataReader src, DataReader dst, int count)
 {
-  m_numLoadedVertices += count;
   return ((int (*)(u8 * src, u8 * dst, int count))region)(src.GetPointer(), dst.GetPointer(),
                                                           count);
 }
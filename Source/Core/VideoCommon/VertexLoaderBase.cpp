@@ -72,6 +72,24 @@ void VertexLoaderBase::SetVAT(const VAT& vat)
   m_VtxAttr.texCoord[7].Frac = vat.g2.Tex7Frac;
 };
 
+bool VertexLoaderBase::HasSkippedVertices(const u8* src, int count) const
+{
+  if (!(m_VtxDesc.Position & MASK_INDEXED))
+    return false;
+
+  // The position index follows the matrix indices.
+  const int offset = m_VtxDesc.PosMatIdx + m_VtxDesc.Tex0MatIdx + m_VtxDesc.Tex1MatIdx +
+                     m_VtxDesc.Tex2MatIdx + m_VtxDesc.Tex3MatIdx + m_VtxDesc.Tex4MatIdx +
+                     m_VtxDesc.Tex5MatIdx + m_VtxDesc.Tex6MatIdx + m_VtxDesc.Tex7MatIdx;
+  const u8* index = src + offset;
+  for (int i = 0; i < count; i++, index += m_VertexSize)
+  {
+    if (index[0] == 0xFF && (m_VtxDesc.Position == INDEX8 || index[1] == 0xFF))
+      return true;
+  }
+  return false;
+}
+
 std::string VertexLoaderBase::ToString() const
 {
   std::string dest;
@@ -179,7 +197,6 @@ public:
                 m_VtxDesc.Hex, m_vat.g0.Hex, m_vat.g1.Hex, m_vat.g2.Hex);
 
     memcpy(dst.GetPointer(), buffer_a.data(), count_a * m_native_vtx_decl.stride);
-    m_numLoadedVertices += count;
     return count_a;
   }
   std::string GetName() const override { return "CompareLoader"; }
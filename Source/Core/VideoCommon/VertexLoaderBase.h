@@ -66,6 +66,14 @@ public:
 
   virtual bool IsInitialized() = 0;
 
+  // Whether RunVertices can be called from several threads at once. The only state such loaders
+  // may write is the zfreeze position cache.
+  virtual bool CanRunInParallel() const { return false; }
+
+  // Whether any of the count vertices at src has an index of 0xFF/0xFFFF for its position. These
+  // vertices are skipped, so RunVertices writes fewer vertices than it's given.
+  bool HasSkippedVertices(const u8* src, int count) const;
+
   // For debugging / profiling
   std::string ToString() const;
 
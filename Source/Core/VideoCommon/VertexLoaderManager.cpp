@@ -22,6 +22,7 @@
 #include "VideoCommon/Statistics.h"
 #include "VideoCommon/VertexLoaderBase.h"
 #include "VideoCommon/VertexLoaderManager.h"
+#include "VideoCommon/VertexLoaderPool.h"
 #include "VideoCommon/VertexManagerBase.h"
 #include "VideoCommon/VertexShaderManager.h"
 
@@ -56,6 +57,7 @@ void Init()
 
 void Clear()
 {
+  VertexLoaderPool::WaitForAll();
   std::lock_guard<std::mutex> lk(s_vertex_loader_map_lock);
   s_vertex_loader_map.clear();
   s_native_vertex_map.clear();
@@ -67,6 +69,9 @@ void UpdateVertexArrayPointers()
   if (!g_main_cp_state.bases_dirty)
     return;
 
+  // Queued vertices are loaded with the current pointers.
+  VertexLoaderPool::WaitForAll();
+
   // Some games such as Burnout 2 can put invalid addresses into
   // the array base registers. (see issue 8591)
   // But the vertex arrays with invalid addresses aren't actually enabled.
@@ -262,6 +267,8 @@ int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src, bo
   if (is_preprocess)
     return size;
 
+  StageTiming::ScopedTimer timer(VideoStage::VertexLoading);
+
   // If the native vertex format changed, force a flush.
   if (loader->m_native_vertex_format != s_current_vtx_fmt ||
       loader->m_native_components != g_current_components)
@@ -280,7 +287,18 @@ int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src, bo
   DataReader dst = g_vertex_manager->PrepareForAdditionalData(
       primitive, count, loader->m_native_vtx_decl.stride, cullall);
 
-  count = loader->RunVertices(src, dst, count);
+  loader->m_numLoadedVertices += count;
+  if (VertexLoaderPool::GetNumThreads() != 0 && loader->CanRunInParallel() &&
+      !loader->HasSkippedVertices(src.GetPointer(), count))
+  {
+    VertexLoaderPool::Load(loader, src.GetPointer(), dst.GetPointer(), count);
+  }
+  else
+  {
+    // The position cache has to end up with the vertices of the last draw.
+    VertexLoaderPool::WaitForAll();
+    count = loader->RunVertices(src, dst, count);
+  }
 
   IndexGenerator::AddIndices(primitive, count);
 
@@ -353,6 +371,9 @@ void LoadCPReg(u32 sub_cmd, u32 value, bool is_preprocess)
     break;
 
   case 0xB0:
+    // The vertex loaders read the strides directly.
+    if (update_global_state)
+      VertexLoaderPool::WaitForAll();
     state->array_strides[sub_cmd & 0xF] = value & 0xFF;
     break;
   }
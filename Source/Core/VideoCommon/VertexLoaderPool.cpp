@@ -0,0 +1,246 @@
+// Copyright 2018 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "VideoCommon/VertexLoaderPool.h"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Thread.h"
+#include "VideoCommon/DataReader.h"
+#include "VideoCommon/Statistics.h"
+#include "VideoCommon/VertexLoaderBase.h"
+
+namespace VertexLoaderPool
+{
+namespace
+{
+struct Draw
+{
+  VertexLoaderBase* loader;
+  const u8* src;
+  u8* dst;
+  int count;
+};
+
+using Batch = std::vector<Draw>;
+
+// Draws are split into chunks of this many vertices, and smaller draws are batched up to it, so
+// that queueing is cheap compared to loading.
+constexpr int BATCH_VERTICES = 1024;
+
+// Covers the largest native vertex, plus the 4 bytes the loaders may write past its end.
+constexpr size_t MAX_NATIVE_VERTEX_SIZE = 256;
+}  // namespace
+
+static std::vector<std::thread> s_workers;
+static std::mutex s_lock;
+static std::condition_variable s_work_available;
+static std::condition_variable s_work_done;
+static std::deque<Batch> s_queue;
+static u32 s_batches_in_flight = 0;
+static bool s_exit_workers = false;
+
+// Only accessed by the GPU thread.
+static Batch s_batch;
+static int s_batch_vertices = 0;
+static bool s_pending = false;
+
+// The draws whose last vertices are in position_cache and position_matrix_index after loading
+// everything in order, oldest first. A draw writes one entry for each of its last three vertices,
+// so each draw here writes more entries than the ones after it.
+static std::array<Draw, 3> s_zfreeze_draws;
+static size_t s_num_zfreeze_draws = 0;
+
+static void LoadDraw(const Draw& draw)
+{
+  // The loaders can write a few bytes past the last vertex. Loading in order overwrites them
+  // with the next vertex, but that may already have been loaded by another thread here, so load
+  // the last vertex into a scratch buffer instead.
+  const u32 stride = draw.loader->m_native_vtx_decl.stride;
+  const int vertex_size = draw.loader->m_VertexSize;
+  const u8* src_end = draw.src + draw.count * vertex_size;
+  u8* const dst_end = draw.dst + draw.count * stride;
+
+  if (draw.count > 1)
+  {
+    draw.loader->RunVertices(DataReader(const_cast<u8*>(draw.src), const_cast<u8*>(src_end)),
+                             DataReader(draw.dst, dst_end), draw.count - 1);
+  }
+
+  std::array<u8, MAX_NATIVE_VERTEX_SIZE> last;
+  const u8* last_src = src_end - vertex_size;
+  draw.loader->RunVertices(DataReader(const_cast<u8*>(last_src), const_cast<u8*>(src_end)),
+                           DataReader(last.data(), last.data() + last.size()), 1);
+  std::memcpy(dst_end - stride, last.data(), stride);
+}
+
+static void LoadBatch(const Batch& batch)
+{
+  for (const Draw& draw : batch)
+    LoadDraw(draw);
+}
+
+static void WorkerThread(u32 index)
+{
+  Common::SetCurrentThreadName(("Vertex loader " + std::to_string(index)).c_str());
+
+  std::unique_lock<std::mutex> lock(s_lock);
+  while (true)
+  {
+    s_work_available.wait(lock, [] { return s_exit_workers || !s_queue.empty(); });
+    if (s_queue.empty())
+      return;
+
+    Batch batch = std::move(s_queue.front());
+    s_queue.pop_front();
+    s_batches_in_flight++;
+
+    lock.unlock();
+    LoadBatch(batch);
+    lock.lock();
+
+    s_batches_in_flight--;
+    if (s_batches_in_flight == 0 && s_queue.empty())
+      s_work_done.notify_all();
+  }
+}
+
+static void QueueBatch()
+{
+  if (s_batch.empty())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_queue.push_back(std::move(s_batch));
+  }
+  s_work_available.notify_one();
+
+  s_batch.clear();
+  s_batch_vertices = 0;
+}
+
+static void AddToBatch(const Draw& draw)
+{
+  s_batch.push_back(draw);
+  s_batch_vertices += draw.count;
+  if (s_batch_vertices >= BATCH_VERTICES)
+    QueueBatch();
+}
+
+static void TrackZFreezeDraw(const Draw& draw)
+{
+  // The new draw overwrites every entry written by draws with at most as many vertices.
+  const int entries = std::min(draw.count, 3);
+  auto end = std::remove_if(
+      s_zfreeze_draws.begin(), s_zfreeze_draws.begin() + s_num_zfreeze_draws,
+      [entries](const Draw& other) { return std::min(other.count, 3) <= entries; });
+  s_num_zfreeze_draws = end - s_zfreeze_draws.begin();
+  s_zfreeze_draws[s_num_zfreeze_draws++] = draw;
+}
+
+static void RestoreZFreezeState()
+{
+  // The workers wrote the position cache in whatever order they finished in. Reload the last
+  // vertices of the draws that would have written it last, in order, to get the right values.
+  std::array<u8, 3 * MAX_NATIVE_VERTEX_SIZE> scratch;
+  for (size_t i = 0; i < s_num_zfreeze_draws; i++)
+  {
+    const Draw& draw = s_zfreeze_draws[i];
+    const int count = std::min(draw.count, 3);
+    const int vertex_size = draw.loader->m_VertexSize;
+    u8* src = const_cast<u8*>(draw.src) + (draw.count - count) * vertex_size;
+    draw.loader->RunVertices(DataReader(src, src + count * vertex_size),
+                             DataReader(scratch.data(), scratch.data() + scratch.size()), count);
+  }
+  s_num_zfreeze_draws = 0;
+}
+
+void SetNumThreads(u32 num_threads)
+{
+  if (num_threads == s_workers.size())
+    return;
+
+  WaitForAll();
+
+  if (!s_workers.empty())
+  {
+    {
+      std::lock_guard<std::mutex> lock(s_lock);
+      s_exit_workers = true;
+    }
+    s_work_available.notify_all();
+    for (std::thread& worker : s_workers)
+      worker.join();
+    s_workers.clear();
+    s_exit_workers = false;
+  }
+
+  for (u32 i = 0; i < num_threads; i++)
+    s_workers.emplace_back(WorkerThread, i);
+}
+
+u32 GetNumThreads()
+{
+  return static_cast<u32>(s_workers.size());
+}
+
+void Load(VertexLoaderBase* loader, const u8* src, u8* dst, int count)
+{
+  if (count <= 0)
+    return;
+
+  const int vertex_size = loader->m_VertexSize;
+  const u32 stride = loader->m_native_vtx_decl.stride;
+  for (int first = 0; first < count; first += BATCH_VERTICES)
+  {
+    AddToBatch({loader, src + first * vertex_size, dst + first * stride,
+                std::min(count - first, BATCH_VERTICES)});
+  }
+
+  TrackZFreezeDraw({loader, src, dst, count});
+  s_pending = true;
+}
+
+void WaitForAll()
+{
+  if (!s_pending)
+    return;
+
+  StageTiming::ScopedTimer timer(VideoStage::VertexLoading);
+
+  // Load the unfinished batch here instead of waking up a worker, then help with the rest.
+  LoadBatch(s_batch);
+  s_batch.clear();
+  s_batch_vertices = 0;
+
+  std::unique_lock<std::mutex> lock(s_lock);
+  while (!s_queue.empty())
+  {
+    Batch batch = std::move(s_queue.front());
+    s_queue.pop_front();
+    s_batches_in_flight++;
+
+    lock.unlock();
+    LoadBatch(batch);
+    lock.lock();
+
+    s_batches_in_flight--;
+  }
+  s_work_done.wait(lock, [] { return s_batches_in_flight == 0; });
+  lock.unlock();
+
+  RestoreZFreezeState();
+  s_pending = false;
+}
+}
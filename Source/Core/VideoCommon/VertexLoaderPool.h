@@ -0,0 +1,30 @@
+// Copyright 2018 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+class VertexLoaderBase;
+
+// Loads vertices on worker threads while the GPU thread keeps decoding the command stream.
+//
+// The GPU thread still reserves vertex buffer space and generates indices for every draw in
+// order, so only filling in the vertex data is deferred. Everything that reads the loaded
+// vertices or changes state the loaders read must call WaitForAll first.
+namespace VertexLoaderPool
+{
+// Starts or stops worker threads so that num_threads of them are running. With no threads,
+// nothing is ever queued.
+void SetNumThreads(u32 num_threads);
+u32 GetNumThreads();
+
+// Queues loading count vertices from src to dst. The loader must be able to run in parallel, and
+// none of the vertices may be skipped, since the caller has to know how many are written.
+void Load(VertexLoaderBase* loader, const u8* src, u8* dst, int count);
+
+// Blocks until all queued vertices have been loaded, and leaves the zfreeze position cache as if
+// they had been loaded in order. Only call this from the GPU thread.
+void WaitForAll();
+}
@@ -14,6 +14,7 @@ public:
 protected:
   std::string GetName() const override { return "VertexLoaderX64"; }
   bool IsInitialized() override { return true; }
+  bool CanRunInParallel() const override { return true; }
   int RunVertices(DataReader src, DataReader dst, int count) override;
 
 private:
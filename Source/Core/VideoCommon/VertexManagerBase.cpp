@@ -25,8 +25,10 @@
 #include "VideoCommon/PixelShaderManager.h"
 #include "VideoCommon/RenderBase.h"
 #include "VideoCommon/SamplerCommon.h"
+#include "VideoCommon/Statistics.h"
 #include "VideoCommon/TextureCacheBase.h"
 #include "VideoCommon/VertexLoaderManager.h"
+#include "VideoCommon/VertexLoaderPool.h"
 #include "VideoCommon/VertexShaderManager.h"
 #include "VideoCommon/VideoBackendBase.h"
 #include "VideoCommon/VideoConfig.h"
@@ -272,6 +274,8 @@ void VertexManagerBase::Flush()
   if (m_is_flushed)
     return;
 
+  VertexLoaderPool::WaitForAll();
+
   // loading a state will invalidate BP, so check for it
   g_video_backend->CheckInvalidState();
 
@@ -387,7 +391,10 @@ void VertexManagerBase::Flush()
 
     if (PerfQueryBase::ShouldEmulate())
       g_perf_query->EnableQuery(bpmem.zcontrol.early_ztest ? PQG_ZCOMP_ZCOMPLOC : PQG_ZCOMP);
-    g_vertex_manager->vFlush();
+    {
+      StageTiming::ScopedTimer timer(VideoStage::BackendSubmission);
+      g_vertex_manager->vFlush();
+    }
     if (PerfQueryBase::ShouldEmulate())
       g_perf_query->DisableQuery(bpmem.zcontrol.early_ztest ? PQG_ZCOMP_ZCOMPLOC : PQG_ZCOMP);
   }
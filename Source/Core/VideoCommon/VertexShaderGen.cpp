@@ -9,6 +9,7 @@
 #include "VideoCommon/BPMemory.h"
 #include "VideoCommon/LightingShaderGen.h"
 #include "VideoCommon/NativeVertexFormat.h"
+#include "VideoCommon/Statistics.h"
 #include "VideoCommon/VertexLoaderManager.h"
 #include "VideoCommon/VertexShaderGen.h"
 #include "VideoCommon/VideoCommon.h"
@@ -17,6 +18,7 @@
 
 VertexShaderUid GetVertexShaderUid()
 {
+  StageTiming::ScopedTimer timer(VideoStage::ShaderUid);
   VertexShaderUid out;
   vertex_shader_uid_data* uid_data = out.GetUidData<vertex_shader_uid_data>();
   memset(uid_data, 0, sizeof(*uid_data));
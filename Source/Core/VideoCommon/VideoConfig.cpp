@@ -67,6 +67,8 @@ void VideoConfig::Refresh()
     aspect_mode = config_aspect_mode;
   bCrop = Config::Get(Config::GFX_CROP);
   iSafeTextureCache_ColorSamples = Config::Get(Config::GFX_SAFE_TEXTURE_CACHE_COLOR_SAMPLES);
+  bTextureWriteTracking = Config::Get(Config::GFX_TEXTURE_WRITE_TRACKING);
+  bVectorTextureHash = Config::Get(Config::GFX_VECTOR_TEXTURE_HASH);
   bShowFPS = Config::Get(Config::GFX_SHOW_FPS);
   bShowNetPlayPing = Config::Get(Config::GFX_SHOW_NETPLAY_PING);
   bShowNetPlayMessages = Config::Get(Config::GFX_SHOW_NETPLAY_MESSAGES);
@@ -107,6 +109,9 @@ void VideoConfig::Refresh()
   bPrecompileUberShaders = Config::Get(Config::GFX_PRECOMPILE_UBER_SHADERS);
   iShaderCompilerThreads = Config::Get(Config::GFX_SHADER_COMPILER_THREADS);
   iShaderPrecompilerThreads = Config::Get(Config::GFX_SHADER_PRECOMPILER_THREADS);
+  iVertexLoaderThreads = Config::Get(Config::GFX_VERTEX_LOADER_THREADS);
+  iTextureDecoderThreads = Config::Get(Config::GFX_TEXTURE_DECODER_THREADS);
+  iTexturePlaceholderFrames = Config::Get(Config::GFX_TEXTURE_PLACEHOLDER_FRAMES);
 
   bZComploc = Config::Get(Config::GFX_SW_ZCOMPLOC);
   bZFreeze = Config::Get(Config::GFX_SW_ZFREEZE);
@@ -200,6 +205,23 @@ u32 VideoConfig::GetShaderPrecompilerThreads() const
     return GetNumAutoShaderCompilerThreads();
 }
 
+u32 VideoConfig::GetVertexLoaderThreads() const
+{
+  if (iVertexLoaderThreads >= 0)
+    return static_cast<u32>(iVertexLoaderThreads);
+
+  // The CPU and GPU threads already keep two cores busy. We use clamp(cpus - 2, 1, 4).
+  return static_cast<u32>(std::min(std::max(cpu_info.num_cores - 2, 1), 4));
+}
+
+u32 VideoConfig::GetTextureDecoderThreads() const
+{
+  if (iTextureDecoderThreads >= 0)
+    return static_cast<u32>(iTextureDecoderThreads);
+  else
+    return GetNumAutoShaderCompilerThreads();
+}
+
 bool VideoConfig::CanPrecompileUberShaders() const
 {
   // We don't want to precompile ubershaders if they're never going to be used.
@@ -121,6 +121,10 @@ struct VideoConfig final
   bool bImmediateXFB;
   bool bCopyEFBScaled;
   int iSafeTextureCache_ColorSamples;
+  // Skip rehashing textures whose memory is known not to have been written.
+  bool bTextureWriteTracking;
+  // Hash whole textures with the AVX2/NEON hash instead of CRC32, where available.
+  bool bVectorTextureHash;
   ProjectionHackConfig phack;
   float fAspectRatioHackW, fAspectRatioHackH;
   bool bEnablePixelLighting;
@@ -186,6 +190,19 @@ struct VideoConfig final
   int iShaderCompilerThreads;
   int iShaderPrecompilerThreads;
 
+  // Number of threads loading vertices while the GPU thread decodes the command stream.
+  // 0 loads them on the GPU thread.
+  // -1 uses an automatic number based on the CPU threads.
+  int iVertexLoaderThreads;
+
+  // Number of threads decoding large textures, which are replaced by a placeholder until they
+  // are done. 0 decodes them on the GPU thread.
+  // -1 uses an automatic number based on the CPU threads.
+  int iTextureDecoderThreads;
+
+  // Maximum number of frames that a placeholder can be shown for, before waiting for the decode.
+  int iTexturePlaceholderFrames;
+
   // Static config per API
   // TODO: Move this out of VideoConfig
   struct
@@ -247,6 +264,8 @@ struct VideoConfig final
   bool UseVertexRounding() const { return bVertexRounding && iEFBScale != 1; }
   u32 GetShaderCompilerThreads() const;
   u32 GetShaderPrecompilerThreads() const;
+  u32 GetVertexLoaderThreads() const;
+  u32 GetTextureDecoderThreads() const;
   bool CanPrecompileUberShaders() const;
   bool CanBackgroundCompileShaders() const;
 };
@@ -0,0 +1,88 @@
+// Copyright 2018 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/Hash.h"
+
+static std::vector<u8> RandomData(size_t size)
+{
+  std::mt19937 generator(1234);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<u8> data(size);
+  std::generate(data.begin(), data.end(), [&] { return static_cast<u8>(distribution(generator)); });
+  return data;
+}
+
+TEST(Hash, VectorMatchesGeneric)
+{
+  SetHash64Function(true);
+  if (!IsHash64Vectorized())
+    return;
+
+  const std::vector<u8> data = RandomData(70000);
+  for (u32 len : {8, 64, 255, 256, 257, 1023, 1024, 1025, 1088, 4096, 4099, 65536, 70000})
+    EXPECT_EQ(GetVectorHash64Generic(data.data(), len), GetHash64(data.data(), len, 0)) << len;
+}
+
+TEST(Hash, DetectsChanges)
+{
+  SetHash64Function();
+
+  std::vector<u8> data = RandomData(64 * 1024);
+  const u64 hash = GetHash64(data.data(), static_cast<u32>(data.size()), 0);
+  EXPECT_EQ(hash, GetHash64(data.data(), static_cast<u32>(data.size()), 0));
+
+  for (size_t offset : {size_t(0), size_t(1), size_t(1000), size_t(1024), data.size() - 1})
+  {
+    data[offset] ^= 0x10;
+    EXPECT_NE(hash, GetHash64(data.data(), static_cast<u32>(data.size()), 0)) << offset;
+    data[offset] ^= 0x10;
+  }
+
+  // Moving tiles around must change the hash, even within a block of stripes.
+  std::swap_ranges(data.begin(), data.begin() + 64, data.begin() + 128);
+  EXPECT_NE(hash, GetHash64(data.data(), static_cast<u32>(data.size()), 0));
+  std::swap_ranges(data.begin(), data.begin() + 64, data.begin() + 128);
+  std::swap_ranges(data.begin(), data.begin() + 1024, data.begin() + 4096);
+  EXPECT_NE(hash, GetHash64(data.data(), static_cast<u32>(data.size()), 0));
+}
+
+// Run with --gtest_also_run_disabled_tests to print throughput numbers.
+TEST(Hash, DISABLED_Throughput)
+{
+  constexpr u32 MAX_SIZE = 4 * 1024 * 1024;
+  const std::vector<u8> data = RandomData(MAX_SIZE);
+
+  for (u32 size = 4 * 1024; size <= MAX_SIZE; size *= 4)
+  {
+    const u32 iterations = std::max(256 * 1024 * 1024 / size, 4u);
+    const auto measure = [&](auto hash_function) {
+      u64 result = 0;
+      const auto start = std::chrono::steady_clock::now();
+      for (u32 i = 0; i < iterations; i++)
+        result += hash_function();
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      EXPECT_NE(result, 0u);
+      return static_cast<double>(size) * iterations / elapsed.count() / (1024 * 1024 * 1024);
+    };
+
+    SetHash64Function();
+    const double full = measure([&] { return GetHash64(data.data(), size, 0); });
+    const double sampled = measure([&] { return GetHash64(data.data(), size, 128); });
+    SetHash64Function(true);
+    const double vector = measure([&] { return GetHash64(data.data(), size, 0); });
+    const double generic = measure([&] { return GetVectorHash64Generic(data.data(), size); });
+    std::printf("%7u KiB: %6.2f GiB/s, 128 samples %6.2f GiB/s, vector %6.2f GiB/s, "
+                "generic %6.2f GiB/s\n",
+                size / 1024, full, sampled, vector, generic);
+  }
+}
@@ -6,6 +6,8 @@
 
 #include <array>
 #include <bitset>
+#include <chrono>
+#include <cstdio>
 #include <string>
 
 #include "Common/Config/Config.h"
@@ -347,3 +349,77 @@ TEST(CoreTiming, Overclocking)
   SConfig::GetInstance().m_OCFactor = 1.0;
   AdvanceAndCheck(4, MAX_SLICE_LENGTH);
 }
+
+TEST(CoreTiming, FarFuture)
+{
+  ScopeInit guard;
+
+  CoreTiming::EventType* cb_a = CoreTiming::RegisterEvent("callbackA", CallbackTemplate<0>);
+  CoreTiming::EventType* cb_b = CoreTiming::RegisterEvent("callbackB", CallbackTemplate<1>);
+
+  // Enter slice 0
+  CoreTiming::Advance();
+
+  // Further ahead than the levels of the timing wheel reach.
+  constexpr s64 FAR_AWAY = s64(1) << 33;
+  CoreTiming::ScheduleEvent(FAR_AWAY + 100, cb_a, CB_IDS[0]);
+  CoreTiming::ScheduleEvent(FAR_AWAY, cb_b, CB_IDS[1]);
+  EXPECT_EQ(MAX_SLICE_LENGTH, PowerPC::ppcState.downcount);
+
+  // Skip to the slice which ends right at cb_b.
+  CoreTiming::g.global_timer += FAR_AWAY - MAX_SLICE_LENGTH;
+  AdvanceAndCheck(1, 100);
+  AdvanceAndCheck(0, MAX_SLICE_LENGTH);
+}
+
+namespace BenchmarkTest
+{
+static u64 s_events_run = 0;
+
+static void CountingCallback(u64 userdata, s64 lateness)
+{
+  ++s_events_run;
+}
+}
+
+// Not a correctness test: reports how long scheduling and removing events takes, so that
+// changes to the scheduler's data structures can be compared.
+// Run with --gtest_also_run_disabled_tests to print the numbers.
+TEST(CoreTiming, DISABLED_Benchmark)
+{
+  using namespace BenchmarkTest;
+
+  ScopeInit guard;
+
+  constexpr int NUM_TYPES = 64;
+  constexpr u32 OPERATIONS = 2000000;
+  std::array<CoreTiming::EventType*, NUM_TYPES> types;
+  for (int i = 0; i < NUM_TYPES; ++i)
+    types[i] = CoreTiming::RegisterEvent("benchmark" + std::to_string(i), CountingCallback);
+
+  // Enter slice 0
+  CoreTiming::Advance();
+
+  s_events_run = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (u32 i = 0; i < OPERATIONS; ++i)
+  {
+    CoreTiming::ScheduleEvent(100 + i * 7919 % 100000, types[i * 7 % NUM_TYPES], i);
+    if (i % 3 == 0)
+      CoreTiming::RemoveEvent(types[i * 13 % NUM_TYPES]);
+    if (i % 16 == 0)
+    {
+      PowerPC::ppcState.downcount = 0;
+      CoreTiming::Advance();
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  printf("schedule/remove/advance: %llu ns per operation, %llu events run\n",
+         static_cast<unsigned long long>(
+             std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() /
+             OPERATIONS),
+         static_cast<unsigned long long>(s_events_run));
+
+  EXPECT_NE(0u, s_events_run);
+}
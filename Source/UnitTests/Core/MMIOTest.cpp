@@ -138,3 +138,94 @@ TEST_F(MappingTest, ReadWriteComplex)
   EXPECT_TRUE(read_called);
   EXPECT_TRUE(write_called);
 }
+
+// Records which handling method a read handler ended up with.
+template <typename T>
+class ReadMethodRecorder : public MMIO::ReadHandlingMethodVisitor<T>
+{
+public:
+  void VisitConstant(T value) override { method = "constant"; }
+  void VisitDirect(const T* addr, u32 mask) override
+  {
+    method = "direct";
+    direct_addr = addr;
+    direct_mask = mask;
+  }
+  void VisitComplex(const std::function<T(u32)>* lambda) override { method = "complex"; }
+
+  std::string method;
+  const T* direct_addr = nullptr;
+  u32 direct_mask = 0;
+};
+
+TEST_F(MappingTest, ReadWriteToSmallerDirect)
+{
+  u32 target = 0;
+
+  m_mapping->Register(0x0C001234, MMIO::DirectRead<u16>(MMIO::Utils::HighPart(&target), 0x00FF),
+                      MMIO::DirectWrite<u16>(MMIO::Utils::HighPart(&target), 0x00FF));
+  m_mapping->Register(0x0C001236, MMIO::DirectRead<u16>(MMIO::Utils::LowPart(&target)),
+                      MMIO::DirectWrite<u16>(MMIO::Utils::LowPart(&target)));
+  m_mapping->Register(0x0C001234, MMIO::ReadToSmaller<u32>(m_mapping, 0x0C001234, 0x0C001236),
+                      MMIO::WriteToSmaller<u32>(m_mapping, 0x0C001234, 0x0C001236));
+
+  // Two Direct halves of the same variable are combined into a single Direct access.
+  ReadMethodRecorder<u32> recorder;
+  m_mapping->GetHandlerForRead<u32>(0x0C001234).Visit(recorder);
+  EXPECT_EQ("direct", recorder.method);
+  EXPECT_EQ(&target, recorder.direct_addr);
+  EXPECT_EQ(0x00FFFFFFu, recorder.direct_mask);
+
+  m_mapping->Write<u32>(0x0C001234, 0x12345678);
+  EXPECT_EQ(0x00345678u, target);
+  EXPECT_EQ(0x00345678u, m_mapping->Read<u32>(0x0C001234));
+}
+
+TEST_F(MappingTest, ReadToSmallerComplex)
+{
+  u16 high = 0x1234;
+  m_mapping->Register(0x0C001234, MMIO::DirectRead<u16>(&high), MMIO::Nop<u16>());
+  m_mapping->Register(0x0C001236, MMIO::ComplexRead<u16>([](u32) { return 0x5678; }),
+                      MMIO::Nop<u16>());
+  m_mapping->Register(0x0C001234, MMIO::ReadToSmaller<u32>(m_mapping, 0x0C001234, 0x0C001236),
+                      MMIO::WriteToSmaller<u32>(m_mapping, 0x0C001234, 0x0C001236));
+
+  ReadMethodRecorder<u32> recorder;
+  m_mapping->GetHandlerForRead<u32>(0x0C001234).Visit(recorder);
+  EXPECT_EQ("complex", recorder.method);
+  EXPECT_EQ(0x12345678u, m_mapping->Read<u32>(0x0C001234));
+}
+
+TEST_F(MappingTest, ReadToLargerDirect)
+{
+  u32 target = 0x12345678;
+  m_mapping->Register(0x0C001234, MMIO::DirectRead<u32>(&target, 0xFFF0FFFF), MMIO::Nop<u32>());
+  m_mapping->Register(0x0C001234, MMIO::ReadToLarger<u16>(m_mapping, 0x0C001234, 16),
+                      MMIO::Nop<u16>());
+  m_mapping->Register(0x0C001236, MMIO::ReadToLarger<u16>(m_mapping, 0x0C001234, 0),
+                      MMIO::Nop<u16>());
+
+  ReadMethodRecorder<u16> recorder;
+  m_mapping->GetHandlerForRead<u16>(0x0C001234).Visit(recorder);
+  EXPECT_EQ("direct", recorder.method);
+  EXPECT_EQ(0xFFF0u, recorder.direct_mask);
+
+  EXPECT_EQ(0x1230, m_mapping->Read<u16>(0x0C001234));
+  EXPECT_EQ(0x5678, m_mapping->Read<u16>(0x0C001236));
+}
+
+TEST_F(MappingTest, SlowAccessCounts)
+{
+  m_mapping->Register(0x0C001234, MMIO::Constant<u16>(0), MMIO::Nop<u16>());
+
+  for (int i = 0; i < 3; ++i)
+    m_mapping->Read<u16>(0x0C001234);
+  m_mapping->Write<u16>(0x0C001236, 0);
+
+  // Counters are kept per 32 bit register.
+  EXPECT_EQ(3u, m_mapping->GetSlowReadCount(0x0C001234));
+  EXPECT_EQ(1u, m_mapping->GetSlowWriteCount(0x0C001234));
+  EXPECT_EQ(0u, m_mapping->GetSlowReadCount(0x0C001238));
+  EXPECT_EQ(3u, m_mapping->GetNumSlowReads());
+  EXPECT_EQ(1u, m_mapping->GetNumSlowWrites());
+}
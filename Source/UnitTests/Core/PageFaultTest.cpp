@@ -3,11 +3,20 @@
 // Refer to the license.txt file included.
 
 #include <chrono>
+#include <memory>
+#include <string>
 
 #include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/FileUtil.h"
 #include "Common/Timer.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
 #include "Core/MemTools.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "UICommon/UICommon.h"
 
 // include order is important
 #include <gtest/gtest.h>  // NOLINT
@@ -76,3 +85,186 @@ TEST(PageFault, PageFault)
   printf("HandleFault->end       %llu ns\n", AS_NS(end - pfjit.m_post_unprotect_time));
   printf("total                  %llu ns\n", AS_NS(end - start));
 }
+
+// Maps the logical view of the faulting BAT page back in, like a JIT would fall back to slowmem.
+class RemapFakeJit : public PageFaultFakeJit
+{
+public:
+  bool HandleFault(uintptr_t access_address, SContext* ctx) override
+  {
+    m_fault_address = access_address;
+    Memory::UpdateLogicalMemory(*m_dbat_table);
+    return true;
+  }
+
+  const PowerPC::BatTable* m_dbat_table;
+  uintptr_t m_fault_address = 0;
+};
+
+class MemoryScopeInit final
+{
+public:
+  MemoryScopeInit() : m_profile_path(File::CreateTempDir())
+  {
+    UICommon::SetUserDirectory(m_profile_path);
+    Config::Init();
+    SConfig::Init();
+    Memory::Init();
+  }
+  ~MemoryScopeInit()
+  {
+    Memory::Shutdown();
+    SConfig::Shutdown();
+    Config::Shutdown();
+    File::DeleteDirRecursively(m_profile_path);
+  }
+
+private:
+  std::string m_profile_path;
+};
+
+static void MapBATPage(PowerPC::BatTable* dbat_table, u32 logical_address, u32 physical_address)
+{
+  (*dbat_table)[logical_address >> PowerPC::BAT_INDEX_SHIFT] =
+      physical_address | PowerPC::BAT_MAPPED_BIT | PowerPC::BAT_PHYSICAL_BIT;
+}
+
+TEST(PageFault, LogicalMemoryRemap)
+{
+  MemoryScopeInit memory_init;
+
+  constexpr u32 PAGE_SIZE = PowerPC::BAT_PAGE_SIZE;
+  constexpr u32 LOGICAL_ADDRESS = 0x80000000;
+  volatile u8* logical = Memory::logical_base + LOGICAL_ADDRESS;
+  Memory::m_pRAM[0] = 0x11;
+  Memory::m_pRAM[PAGE_SIZE] = 0x22;
+
+  // Two adjacent pages mapped in order end up in one view.
+  auto dbat_table = std::make_unique<PowerPC::BatTable>();
+  MapBATPage(dbat_table.get(), LOGICAL_ADDRESS, 0);
+  MapBATPage(dbat_table.get(), LOGICAL_ADDRESS + PAGE_SIZE, PAGE_SIZE);
+  Memory::UpdateLogicalMemory(*dbat_table);
+  EXPECT_EQ(0x11, logical[0]);
+  EXPECT_EQ(0x22, logical[PAGE_SIZE]);
+
+  // Swapping them has to split it up again.
+  MapBATPage(dbat_table.get(), LOGICAL_ADDRESS, PAGE_SIZE);
+  MapBATPage(dbat_table.get(), LOGICAL_ADDRESS + PAGE_SIZE, 0);
+  Memory::UpdateLogicalMemory(*dbat_table);
+  EXPECT_EQ(0x22, logical[0]);
+  EXPECT_EQ(0x11, logical[PAGE_SIZE]);
+  logical[1] = 0x33;
+  EXPECT_EQ(0x33, Memory::m_pRAM[PAGE_SIZE + 1]);
+
+  // Accessing a page after its BAT mapping is gone has to fault.
+  auto unmapped_dbat_table = std::make_unique<PowerPC::BatTable>(*dbat_table);
+  (*unmapped_dbat_table)[(LOGICAL_ADDRESS + PAGE_SIZE) >> PowerPC::BAT_INDEX_SHIFT] = 0;
+  Memory::UpdateLogicalMemory(*unmapped_dbat_table);
+
+  EMM::InstallExceptionHandler();
+  RemapFakeJit rfjit;
+  rfjit.m_dbat_table = dbat_table.get();
+  g_jit = &rfjit;
+  u8 value = logical[PAGE_SIZE];
+  EMM::UninstallExceptionHandler();
+  g_jit = nullptr;
+
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&logical[PAGE_SIZE]), rfjit.m_fault_address);
+  EXPECT_EQ(0x11, value);
+}
+
+TEST(PageFault, CodePageWriteProtection)
+{
+  MemoryScopeInit memory_init;
+
+  constexpr u32 PAGE_ADDRESS = 0x3000;
+  auto dbat_table = std::make_unique<PowerPC::BatTable>();
+  MapBATPage(dbat_table.get(), 0x80000000, 0);
+  Memory::UpdateLogicalMemory(*dbat_table);
+  volatile u8* logical = Memory::logical_base + 0x80000000;
+
+  // Not supported with every host page size.
+  if (!Memory::WriteProtectPhysicalPage(PAGE_ADDRESS, Memory::WRITE_PROTECT_JIT_CODE))
+    return;
+
+  u32 physical_address = 0;
+  u32 owners = 0;
+  EXPECT_TRUE(Memory::IsWriteProtectedHostAddress(
+      reinterpret_cast<uintptr_t>(&logical[PAGE_ADDRESS + 4]), &physical_address, &owners));
+  EXPECT_EQ(PAGE_ADDRESS + 4, physical_address);
+  EXPECT_EQ(Memory::WRITE_PROTECT_JIT_CODE, owners);
+  EXPECT_FALSE(Memory::IsWriteProtectedHostAddress(
+      reinterpret_cast<uintptr_t>(&logical[PAGE_ADDRESS - 4]), &physical_address, &owners));
+
+  // The fault handler only makes the view that faulted writable. Without a JIT, processing the
+  // fault later on just drops the protection everywhere else.
+  EMM::InstallExceptionHandler();
+  logical[PAGE_ADDRESS + 4] = 0x44;
+  EMM::UninstallExceptionHandler();
+
+  EXPECT_EQ(0x44, Memory::m_pRAM[PAGE_ADDRESS + 4]);
+  EXPECT_TRUE(Memory::IsWriteProtectedHostAddress(
+      reinterpret_cast<uintptr_t>(&Memory::m_pRAM[PAGE_ADDRESS]), &physical_address, &owners));
+  Memory::ProcessWriteProtectionFaults();
+  EXPECT_FALSE(Memory::IsWriteProtectedHostAddress(
+      reinterpret_cast<uintptr_t>(&Memory::m_pRAM[PAGE_ADDRESS]), &physical_address, &owners));
+
+  // A fault on a page another thread has unprotected in the meantime is retried, while faults
+  // outside of memory are left to the JIT.
+  EXPECT_TRUE(JitInterface::HandleFault(reinterpret_cast<uintptr_t>(&logical[PAGE_ADDRESS + 4]),
+                                        nullptr));
+  EXPECT_FALSE(JitInterface::HandleFault(
+      reinterpret_cast<uintptr_t>(Memory::physical_base + 0x0C000000), nullptr));
+
+  // Host I/O into the page has to drop the protection up front.
+  ASSERT_TRUE(Memory::WriteProtectPhysicalPage(PAGE_ADDRESS, Memory::WRITE_PROTECT_JIT_CODE));
+  Memory::NotifyPhysicalWrite(PAGE_ADDRESS + 0x800, 0x10);
+  EXPECT_FALSE(Memory::IsWriteProtectedHostAddress(
+      reinterpret_cast<uintptr_t>(&logical[PAGE_ADDRESS]), &physical_address, &owners));
+}
+
+TEST(PageFault, WriteTracking)
+{
+  MemoryScopeInit memory_init;
+
+  constexpr u32 ADDRESS = 0x5010;
+  constexpr u32 SIZE = 0x1800;
+  auto dbat_table = std::make_unique<PowerPC::BatTable>();
+  MapBATPage(dbat_table.get(), 0x80000000, 0);
+  Memory::UpdateLogicalMemory(*dbat_table);
+  volatile u8* logical = Memory::logical_base + 0x80000000;
+
+  // Not supported with every host page size.
+  u64 stamp = Memory::TrackPhysicalWrites(ADDRESS, SIZE);
+  if (stamp == 0)
+    return;
+  EXPECT_FALSE(Memory::WasPhysicalRangeWritten(ADDRESS, SIZE, stamp));
+
+  // Device writes say so up front.
+  const u8 value = 0x55;
+  Memory::CopyToEmu(ADDRESS + 0x1000, &value, sizeof(value));
+  EXPECT_TRUE(Memory::WasPhysicalRangeWritten(ADDRESS, SIZE, stamp));
+  EXPECT_FALSE(Memory::WasPhysicalRangeWritten(ADDRESS, 0x100, stamp));
+
+  // CPU writes fault, even when the page is also protected for the JIT.
+  stamp = Memory::TrackPhysicalWrites(ADDRESS, SIZE);
+  ASSERT_NE(0u, stamp);
+  Memory::WriteProtectPhysicalPage(ADDRESS, Memory::WRITE_PROTECT_JIT_CODE);
+  EMM::InstallExceptionHandler();
+  logical[ADDRESS] = 0x66;
+  EMM::UninstallExceptionHandler();
+
+  // The stamp changes in the fault handler already.
+  EXPECT_EQ(0x66, Memory::m_pRAM[ADDRESS]);
+  EXPECT_TRUE(Memory::WasPhysicalRangeWritten(ADDRESS, SIZE, stamp));
+  EXPECT_FALSE(Memory::WasPhysicalRangeWritten(ADDRESS + 0x1000, 0x100, stamp));
+
+  u32 physical_address = 0;
+  u32 owners = 0;
+  Memory::ProcessWriteProtectionFaults();
+  EXPECT_FALSE(Memory::IsWriteProtectedHostAddress(
+      reinterpret_cast<uintptr_t>(&logical[ADDRESS]), &physical_address, &owners));
+
+  // Memory outside of RAM can't be tracked.
+  EXPECT_EQ(0u, Memory::TrackPhysicalWrites(0xE0000000, 0x100));
+}
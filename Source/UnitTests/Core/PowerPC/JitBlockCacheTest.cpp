@@ -0,0 +1,229 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <set>
+
+#include "Common/CommonTypes.h"
+#include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/JitCommon/JitBlockIndex.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+class BlockCacheFakeJit : public JitBase
+{
+public:
+  // CPUCoreBase methods
+  void Init() override {}
+  void Shutdown() override {}
+  void ClearCache() override {}
+  void Run() override {}
+  void SingleStep() override {}
+  const char* GetName() override { return nullptr; }
+  // JitBase methods
+  JitBaseBlockCache* GetBlockCache() override { return nullptr; }
+  void Jit(u32 em_address) override {}
+  const CommonAsmRoutinesBase* GetAsmRoutines() override { return nullptr; }
+  bool HandleFault(uintptr_t access_address, SContext* ctx) override { return false; }
+};
+
+class CountingBlockCache : public JitBaseBlockCache
+{
+public:
+  using JitBaseBlockCache::JitBaseBlockCache;
+
+  int m_links = 0;
+  int m_unlinks = 0;
+
+private:
+  void WriteLinkBlock(const JitBlock::LinkData& source, const JitBlock* dest) override
+  {
+    if (dest)
+      ++m_links;
+    else
+      ++m_unlinks;
+  }
+};
+
+constexpr u32 BLOCK_BASE = 0x80003000;
+constexpr u32 BLOCK_INSTRUCTIONS = 16;
+
+u32 BlockAddress(u32 i)
+{
+  return BLOCK_BASE + i * BLOCK_INSTRUCTIONS * 4;
+}
+
+// Builds a block covering BLOCK_INSTRUCTIONS instructions which exits to the given addresses.
+JitBlock* BuildBlock(JitBaseBlockCache& cache, u32 address, std::initializer_list<u32> exits)
+{
+  JitBlock* block = cache.AllocateBlock(address);
+  block->checkedEntry = nullptr;
+  block->normalEntry = nullptr;
+  block->codeSize = 0;
+  block->originalSize = BLOCK_INSTRUCTIONS;
+  for (u32 exit : exits)
+    block->linkData.push_back({nullptr, exit, false, false});
+
+  std::set<u32> physical_addresses;
+  for (u32 i = 0; i < BLOCK_INSTRUCTIONS; ++i)
+    physical_addresses.insert(address + i * 4);
+  cache.FinalizeBlock(*block, true, physical_addresses);
+  return block;
+}
+
+struct Fixture
+{
+  Fixture() { cache.Clear(); }
+  BlockCacheFakeJit jit;
+  CountingBlockCache cache{jit};
+};
+}  // namespace
+
+TEST(JitBlockIndex, InsertFindErase)
+{
+  JitBlockIndex index;
+  JitBlock blocks[4];
+
+  // Colliding keys and duplicates must all be kept apart.
+  index.Insert(0x100, &blocks[0]);
+  index.Insert(0x100, &blocks[1]);
+  index.Insert(0x200, &blocks[2]);
+  EXPECT_EQ(3u, index.Size());
+
+  int count = 0;
+  index.ForEach(0x100, [&](JitBlock* block) { ++count; });
+  EXPECT_EQ(2, count);
+  EXPECT_EQ(&blocks[1], index.Find(0x100, [&](const JitBlock& b) { return &b == &blocks[1]; }));
+  EXPECT_EQ(nullptr, index.Find(0x300, [](const JitBlock&) { return true; }));
+
+  EXPECT_TRUE(index.Erase(0x100, &blocks[0]));
+  EXPECT_FALSE(index.Erase(0x100, &blocks[0]));
+  EXPECT_FALSE(index.Erase(0x200, &blocks[3]));
+  EXPECT_EQ(2u, index.Size());
+  EXPECT_EQ(&blocks[1], index.Find(0x100, [](const JitBlock&) { return true; }));
+}
+
+TEST(JitBlockIndex, GrowAndShrinkKeepsEntries)
+{
+  JitBlockIndex index;
+  JitBlock block;
+  constexpr u32 COUNT = 10000;
+
+  for (u32 i = 0; i < COUNT; ++i)
+    index.Insert(i * 0x20, &block);
+  EXPECT_EQ(COUNT, index.Size());
+  EXPECT_GE(index.Capacity(), 2 * COUNT);
+
+  // Erase every other entry; backward-shift deletion must keep the rest reachable.
+  for (u32 i = 0; i < COUNT; i += 2)
+    EXPECT_TRUE(index.Erase(i * 0x20, &block));
+  for (u32 i = 0; i < COUNT; ++i)
+  {
+    const bool found = index.Find(i * 0x20, [](const JitBlock&) { return true; }) != nullptr;
+    EXPECT_EQ(i % 2 == 1, found);
+  }
+}
+
+TEST(JitBlockCache, LookupAndInvalidate)
+{
+  Fixture f;
+  JitBlock* first = BuildBlock(f.cache, BlockAddress(0), {});
+  JitBlock* second = BuildBlock(f.cache, BlockAddress(1), {});
+
+  EXPECT_EQ(first, f.cache.GetBlockFromStartAddress(BlockAddress(0), 0));
+  EXPECT_EQ(second, f.cache.GetBlockFromStartAddress(BlockAddress(1), 0));
+  EXPECT_EQ(nullptr, f.cache.GetBlockFromStartAddress(BlockAddress(0) + 4, 0));
+
+  // Touching the last instruction of the first block must not take down the second one.
+  f.cache.InvalidateICache(BlockAddress(1) - 4, 4, true);
+  EXPECT_EQ(nullptr, f.cache.GetBlockFromStartAddress(BlockAddress(0), 0));
+  EXPECT_EQ(second, f.cache.GetBlockFromStartAddress(BlockAddress(1), 0));
+}
+
+TEST(JitBlockCache, LinkAndUnlink)
+{
+  Fixture f;
+  BuildBlock(f.cache, BlockAddress(0), {BlockAddress(1)});
+  EXPECT_EQ(0, f.cache.m_links);
+
+  // Compiling the destination links the existing exit to it.
+  BuildBlock(f.cache, BlockAddress(1), {BlockAddress(0)});
+  EXPECT_EQ(2, f.cache.m_links);
+
+  // Destroying the destination unlinks both its own exit and the exit pointing at it.
+  f.cache.InvalidateICache(BlockAddress(1), 4, true);
+  EXPECT_EQ(2, f.cache.m_unlinks);
+  EXPECT_EQ(nullptr, f.cache.GetBlockFromStartAddress(BlockAddress(1), 0));
+  EXPECT_NE(nullptr, f.cache.GetBlockFromStartAddress(BlockAddress(0), 0));
+}
+
+TEST(JitBlockCache, EraseCodeRange)
+{
+  Fixture f;
+  static u8 code[2];
+  JitBlock* first = BuildBlock(f.cache, BlockAddress(0), {BlockAddress(1)});
+  JitBlock* second = BuildBlock(f.cache, BlockAddress(1), {BlockAddress(0)});
+  first->checkedEntry = &code[0];
+  second->checkedEntry = &code[1];
+
+  // Only the block whose code is in the range goes away, and it is unlinked both ways.
+  EXPECT_EQ(1u, f.cache.EraseCodeRange(&code[1], &code[2]));
+  EXPECT_EQ(first, f.cache.GetBlockFromStartAddress(BlockAddress(0), 0));
+  EXPECT_EQ(nullptr, f.cache.GetBlockFromStartAddress(BlockAddress(1), 0));
+  EXPECT_EQ(2, f.cache.m_unlinks);
+
+  // The recycled block must not linger in the invalidation index either.
+  f.cache.InvalidateICache(BlockAddress(1), 4, true);
+  EXPECT_EQ(first, f.cache.GetBlockFromStartAddress(BlockAddress(0), 0));
+}
+
+// Not a correctness test: reports how long building, linking and invalidating blocks takes,
+// so that changes to the block cache's data structures can be compared.
+// Run with --gtest_also_run_disabled_tests to print the numbers.
+TEST(JitBlockCache, DISABLED_Benchmark)
+{
+  Fixture f;
+  constexpr u32 NUM_BLOCKS = 20000;
+  constexpr int ROUNDS = 5;
+
+  auto build = [&f](u32 i) {
+    BuildBlock(f.cache, BlockAddress(i),
+               {BlockAddress(i + 1), BlockAddress((i * 7919) % NUM_BLOCKS)});
+  };
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int round = 0; round < ROUNDS; ++round)
+  {
+    f.cache.Clear();
+    for (u32 i = 0; i < NUM_BLOCKS; ++i)
+      build(i);
+  }
+  auto built = std::chrono::high_resolution_clock::now();
+
+  // Simulates an icbi storm: every cache line of every block is invalidated in turn.
+  for (int round = 0; round < ROUNDS; ++round)
+  {
+    for (u32 i = 0; i < NUM_BLOCKS; ++i)
+    {
+      for (u32 offset = 0; offset < BLOCK_INSTRUCTIONS * 4; offset += 32)
+        f.cache.InvalidateICache(BlockAddress(i) + offset, 32, true);
+      build(i);
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+#define AS_NS(diff)                                                                                \
+  ((unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count())
+
+  printf("block cache timing (per block):\n");
+  printf("build+link             %llu ns\n", AS_NS(built - start) / (ROUNDS * NUM_BLOCKS));
+  printf("invalidate+rebuild     %llu ns\n", AS_NS(end - built) / (ROUNDS * NUM_BLOCKS));
+
+  EXPECT_NE(nullptr, f.cache.GetBlockFromStartAddress(BlockAddress(NUM_BLOCKS - 1), 0));
+}
@@ -0,0 +1,166 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+constexpr u32 BLOCK_ADDRESS = 0x80001000;
+
+std::vector<u32> s_code;
+
+PowerPC::TryReadInstResult ReadInstruction(u32 address)
+{
+  const u32 index = (address - BLOCK_ADDRESS) / 4;
+  if (address < BLOCK_ADDRESS || index >= s_code.size())
+    return {false, false, 0, 0};
+  return {true, false, s_code[index], address & 0x1FFFFFFF};
+}
+
+// Analyzes code into buffer and returns the number of instructions in the block.
+u32 Analyze(const std::vector<u32>& code, PPCAnalyst::CodeBuffer* buffer, u32 options)
+{
+  Interpreter::getInstance()->Init();
+  s_code = code;
+
+  PPCAnalyst::BlockStats stats;
+  PPCAnalyst::BlockRegStats gpa;
+  PPCAnalyst::BlockRegStats fpa;
+  PPCAnalyst::CodeBlock block;
+  block.m_stats = &stats;
+  block.m_gpa = &gpa;
+  block.m_fpa = &fpa;
+
+  PPCAnalyst::PPCAnalyzer analyzer;
+  analyzer.SetInstructionReader(ReadInstruction);
+  analyzer.SetOption(static_cast<PPCAnalyst::PPCAnalyzer::AnalystOption>(options));
+  analyzer.Analyze(BLOCK_ADDRESS, &block, buffer, buffer->GetSize());
+  return block.m_num_instructions;
+}
+
+// Analyzes code and returns whether any branch in it was found to close an idle loop.
+bool HasIdleLoop(const std::vector<u32>& code)
+{
+  PPCAnalyst::CodeBuffer buffer(32);
+  const u32 num_instructions =
+      Analyze(code, &buffer, PPCAnalyst::PPCAnalyzer::OPTION_CONDITIONAL_CONTINUE |
+                                 PPCAnalyst::PPCAnalyzer::OPTION_IDLE_LOOP_DETECTION);
+
+  for (u32 i = 0; i < num_instructions; i++)
+  {
+    if (buffer.codebuffer[i].branchIsIdleLoop)
+      return true;
+  }
+  return false;
+}
+}  // namespace
+
+TEST(PPCAnalyst, IdleLoopPollingMemory)
+{
+  EXPECT_TRUE(HasIdleLoop({
+      0x3C808000,  // lis r4, 0x8000
+      0x80640100,  // lwz r3, 0x100(r4)
+      0x2C030000,  // cmpwi r3, 0
+      0x4182FFF4,  // beq -12
+      0x4E800020,  // blr
+  }));
+}
+
+TEST(PPCAnalyst, IdleLoopClosedByUnconditionalBranch)
+{
+  EXPECT_TRUE(HasIdleLoop({
+      0x3C808000,  // lis r4, 0x8000
+      0x80640100,  // lwz r3, 0x100(r4)
+      0x2C030000,  // cmpwi r3, 0
+      0x40820008,  // bne +8
+      0x4BFFFFF0,  // b -16
+  }));
+}
+
+TEST(PPCAnalyst, LoopLoadingFromUnknownAddressIsNotIdle)
+{
+  // r4 could point at MMIO.
+  EXPECT_FALSE(HasIdleLoop({
+      0x80640000,  // lwz r3, 0(r4)
+      0x2C030000,  // cmpwi r3, 0
+      0x4182FFF8,  // beq -8
+      0x4E800020,  // blr
+  }));
+}
+
+TEST(PPCAnalyst, IdleLoopWaitingForTimeBase)
+{
+  EXPECT_TRUE(HasIdleLoop({
+      0x7C6C42E6,  // mftb r3
+      0x7C032000,  // cmpw r3, r4
+      0x4180FFF8,  // blt -8
+      0x4E800020,  // blr
+  }));
+}
+
+TEST(PPCAnalyst, CountingLoopIsNotIdle)
+{
+  EXPECT_FALSE(HasIdleLoop({
+      0x38630001,  // addi r3, r3, 1
+      0x2C030064,  // cmpwi r3, 100
+      0x4180FFF8,  // blt -8
+      0x4E800020,  // blr
+  }));
+}
+
+TEST(PPCAnalyst, LoopWithStoreIsNotIdle)
+{
+  EXPECT_FALSE(HasIdleLoop({
+      0x90640000,  // stw r3, 0(r4)
+      0x80650000,  // lwz r3, 0(r5)
+      0x2C030000,  // cmpwi r3, 0
+      0x4182FFF4,  // beq -12
+      0x4E800020,  // blr
+  }));
+}
+
+TEST(PPCAnalyst, LoopDecrementingCTRIsNotIdle)
+{
+  EXPECT_FALSE(HasIdleLoop({
+      0x80640000,  // lwz r3, 0(r4)
+      0x2C030000,  // cmpwi r3, 0
+      0x4200FFF8,  // bdnz -8
+      0x4E800020,  // blr
+  }));
+}
+
+TEST(PPCAnalyst, CompareBeforeReturnIsLive)
+{
+  // The caller can read CR0, so the compare has to stay.
+  PPCAnalyst::CodeBuffer buffer(32);
+  ASSERT_EQ(2u, Analyze(
+                    {
+                        0x2C030000,  // cmpwi r3, 0
+                        0x4E800020,  // blr
+                    },
+                    &buffer, 0));
+  EXPECT_FALSE(buffer.codebuffer[0].crDiscardable[0]);
+}
+
+TEST(PPCAnalyst, OverwrittenCompareIsDead)
+{
+  PPCAnalyst::CodeBuffer buffer(32);
+  ASSERT_EQ(3u, Analyze(
+                    {
+                        0x2C030000,  // cmpwi r3, 0
+                        0x2C040000,  // cmpwi r4, 0
+                        0x4E800020,  // blr
+                    },
+                    &buffer, 0));
+  EXPECT_TRUE(buffer.codebuffer[0].crDiscardable[0]);
+  EXPECT_FALSE(buffer.codebuffer[1].crDiscardable[0]);
+}